@@ -39,6 +39,7 @@
 #include "libavutil/avutil.h"
 #include "libavutil/bprint.h"
 #include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
 #include "libavutil/display.h"
 #include "libavutil/film_grain_params.h"
 #include "libavutil/hdr_dynamic_metadata.h"
@@ -329,6 +330,8 @@ static const OptionDef *options;
 /* FFprobe context */
 static const char *input_filename;
 static const char *print_input_filename;
+static char *inputs_from;
+static int batch_threads = -1;
 static const AVInputFormat *iformat = NULL;
 static const char *output_filename = NULL;
 
@@ -409,9 +412,11 @@ static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
 
 
 #define print_fmt(k, f, ...) do {              \
-    av_bprint_clear(&pbuf);                    \
-    av_bprintf(&pbuf, f, __VA_ARGS__);         \
-    avtext_print_string(tfc, k, pbuf.str, 0);    \
+    if (avtext_is_entry_shown(tfc, k, 0)) {    \
+        av_bprint_clear(&pbuf);                \
+        av_bprintf(&pbuf, f, __VA_ARGS__);     \
+        avtext_print_string(tfc, k, pbuf.str, 0); \
+    }                                          \
 } while (0)
 
 #define print_list_fmt(k, f, n, m, ...) do {    \
@@ -2365,11 +2370,12 @@ static const AVCodec *get_decoder_for_stream(AVFormatContext *fmt_ctx, AVStream
 }
 
 static int open_input_file(InputFile *ifile, const char *filename,
-                           const char *print_filename)
+                           const char *print_filename, int dump_format)
 {
     int err, i;
     AVFormatContext *fmt_ctx = NULL;
     const AVDictionaryEntry *t = NULL;
+    AVDictionary *fmt_opts = NULL;
     int scan_all_pmts_set = 0;
 
     fmt_ctx = avformat_alloc_context();
@@ -2377,15 +2383,25 @@ static int open_input_file(InputFile *ifile, const char *filename,
         return AVERROR(ENOMEM);
 
     err = set_decoders(fmt_ctx);
-    if (err < 0)
+    if (err < 0) {
+        avformat_free_context(fmt_ctx);
         return err;
-    if (!av_dict_get(format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
-        av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    }
+    /* work on a copy, so that several inputs can be opened concurrently */
+    err = av_dict_copy(&fmt_opts, format_opts, 0);
+    if (err < 0) {
+        av_dict_free(&fmt_opts);
+        avformat_free_context(fmt_ctx);
+        return err;
+    }
+    if (!av_dict_get(fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
+        av_dict_set(&fmt_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
     }
     if ((err = avformat_open_input(&fmt_ctx, filename,
-                                   iformat, &format_opts)) < 0) {
+                                   iformat, &fmt_opts)) < 0) {
         print_error(filename, err);
+        av_dict_free(&fmt_opts);
         return err;
     }
     if (print_filename) {
@@ -2394,9 +2410,10 @@ static int open_input_file(InputFile *ifile, const char *filename,
     }
     ifile->fmt_ctx = fmt_ctx;
     if (scan_all_pmts_set)
-        av_dict_set(&format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
-    while ((t = av_dict_iterate(format_opts, t)))
+        av_dict_set(&fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
+    while ((t = av_dict_iterate(fmt_opts, t)))
         av_log(NULL, AV_LOG_WARNING, "Option %s skipped - not known to demuxer.\n", t->key);
+    av_dict_free(&fmt_opts);
 
     if (find_stream_info) {
         AVDictionary **opts;
@@ -2418,11 +2435,12 @@ static int open_input_file(InputFile *ifile, const char *filename,
         }
     }
 
-    av_dump_format(fmt_ctx, 0, filename, 0);
+    if (dump_format)
+        av_dump_format(fmt_ctx, 0, filename, 0);
 
     ifile->streams = av_calloc(fmt_ctx->nb_streams, sizeof(*ifile->streams));
     if (!ifile->streams)
-        exit(1);
+        return AVERROR(ENOMEM);
     ifile->nb_streams = fmt_ctx->nb_streams;
 
     /* bind a decoder to each input stream */
@@ -2443,15 +2461,19 @@ static int open_input_file(InputFile *ifile, const char *filename,
             err = filter_codec_opts(codec_opts, stream->codecpar->codec_id,
                                     fmt_ctx, stream, codec, &opts, NULL);
             if (err < 0)
-                exit(1);
+                return err;
 
             ist->dec_ctx = avcodec_alloc_context3(codec);
-            if (!ist->dec_ctx)
-                exit(1);
+            if (!ist->dec_ctx) {
+                av_dict_free(&opts);
+                return AVERROR(ENOMEM);
+            }
 
             err = avcodec_parameters_to_context(ist->dec_ctx, stream->codecpar);
-            if (err < 0)
-                exit(1);
+            if (err < 0) {
+                av_dict_free(&opts);
+                return err;
+            }
 
             if (do_show_log) {
                 // For logging it is needed to disable at least frame threads as otherwise
@@ -2464,17 +2486,21 @@ static int open_input_file(InputFile *ifile, const char *filename,
 
             ist->dec_ctx->pkt_timebase = stream->time_base;
 
-            if (avcodec_open2(ist->dec_ctx, codec, &opts) < 0) {
+            err = avcodec_open2(ist->dec_ctx, codec, &opts);
+            if (err < 0) {
                 av_log(NULL, AV_LOG_WARNING, "Could not open codec for input stream %d\n",
                        stream->index);
-                exit(1);
+                av_dict_free(&opts);
+                return err;
             }
 
             if ((t = av_dict_iterate(opts, NULL))) {
                 av_log(NULL, AV_LOG_ERROR, "Option %s for input stream %d not found\n",
                        t->key, stream->index);
+                av_dict_free(&opts);
                 return AVERROR_OPTION_NOT_FOUND;
             }
+            av_dict_free(&opts);
         }
     }
 
@@ -2496,34 +2522,28 @@ static void close_input_file(InputFile *ifile)
     avformat_close_input(&ifile->fmt_ctx);
 }
 
-static int probe_file(AVTextFormatContext *tfc, const char *filename,
-                      const char *print_filename)
+static int probe_input(AVTextFormatContext *tfc, InputFile *ifile)
 {
-    InputFile ifile = { 0 };
-    int ret, i;
+    int ret = 0, i;
     int section_id;
 
     do_analyze_frames = do_analyze_frames && do_show_streams;
     do_read_frames = do_show_frames || do_count_frames || do_analyze_frames;
     do_read_packets = do_show_packets || do_count_packets;
 
-    ret = open_input_file(&ifile, filename, print_filename);
-    if (ret < 0)
-        goto end;
-
 #define CHECK_END if (ret < 0) goto end
 
-    nb_streams = ifile.fmt_ctx->nb_streams;
-    REALLOCZ_ARRAY_STREAM(nb_streams_frames,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(nb_streams_packets,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(selected_streams,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(streams_with_closed_captions,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(streams_with_film_grain,0,ifile.fmt_ctx->nb_streams);
+    nb_streams = ifile->fmt_ctx->nb_streams;
+    REALLOCZ_ARRAY_STREAM(nb_streams_frames,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(nb_streams_packets,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(selected_streams,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(streams_with_closed_captions,0,ifile->fmt_ctx->nb_streams);
+    REALLOCZ_ARRAY_STREAM(streams_with_film_grain,0,ifile->fmt_ctx->nb_streams);
 
-    for (i = 0; i < ifile.fmt_ctx->nb_streams; i++) {
+    for (i = 0; i < ifile->fmt_ctx->nb_streams; i++) {
         if (stream_specifier) {
-            ret = avformat_match_stream_specifier(ifile.fmt_ctx,
-                                                  ifile.fmt_ctx->streams[i],
+            ret = avformat_match_stream_specifier(ifile->fmt_ctx,
+                                                  ifile->fmt_ctx->streams[i],
                                                   stream_specifier);
             CHECK_END;
             else
@@ -2533,7 +2553,7 @@ static int probe_file(AVTextFormatContext *tfc, const char *filename,
             selected_streams[i] = 1;
         }
         if (!selected_streams[i])
-            ifile.fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+            ifile->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
     }
 
     if (do_read_frames || do_read_packets) {
@@ -2546,47 +2566,57 @@ static int probe_file(AVTextFormatContext *tfc, const char *filename,
             section_id = SECTION_ID_FRAMES;
         if (do_show_frames || do_show_packets)
             avtext_print_section_header(tfc, NULL, section_id);
-        ret = read_packets(tfc, &ifile);
+        ret = read_packets(tfc, ifile);
         if (do_show_frames || do_show_packets)
             avtext_print_section_footer(tfc);
         CHECK_END;
     }
 
     if (do_show_programs) {
-        ret = show_programs(tfc, &ifile);
+        ret = show_programs(tfc, ifile);
         CHECK_END;
     }
 
     if (do_show_stream_groups) {
-        ret = show_stream_groups(tfc, &ifile);
+        ret = show_stream_groups(tfc, ifile);
         CHECK_END;
     }
 
     if (do_show_streams) {
-        ret = show_streams(tfc, &ifile);
+        ret = show_streams(tfc, ifile);
         CHECK_END;
     }
     if (do_show_chapters) {
-        ret = show_chapters(tfc, &ifile);
+        ret = show_chapters(tfc, ifile);
         CHECK_END;
     }
     if (do_show_format) {
-        ret = show_format(tfc, &ifile);
+        ret = show_format(tfc, ifile);
         CHECK_END;
     }
 
 end:
-    if (ifile.fmt_ctx)
-        close_input_file(&ifile);
     av_freep(&nb_streams_frames);
     av_freep(&nb_streams_packets);
     av_freep(&selected_streams);
     av_freep(&streams_with_closed_captions);
     av_freep(&streams_with_film_grain);
-    av_freep(&audio_codec_name);
-    av_freep(&data_codec_name);
-    av_freep(&subtitle_codec_name);
-    av_freep(&video_codec_name);
+
+    return ret;
+}
+
+static int probe_file(AVTextFormatContext *tfc, const char *filename,
+                      const char *print_filename)
+{
+    InputFile ifile = { 0 };
+    int ret;
+
+    ret = open_input_file(&ifile, filename, print_filename, 1);
+    if (ret >= 0)
+        ret = probe_input(tfc, &ifile);
+
+    if (ifile.fmt_ctx)
+        close_input_file(&ifile);
 
     return ret;
 }
@@ -2693,6 +2723,285 @@ static void ffprobe_show_pixel_formats(AVTextFormatContext *tfc)
     avtext_print_section_footer(tfc);
 }
 
+static int open_output_context(AVTextFormatContext **ptctx, const AVTextFormatter *f,
+                               AVTextWriterContext *wctx, const char *f_args)
+{
+    AVTextFormatOptions tf_options = {
+        .show_optional_fields = show_optional_fields,
+        .show_value_unit = show_value_unit,
+        .use_value_prefix = use_value_prefix,
+        .use_byte_value_binary_prefix = use_byte_value_binary_prefix,
+        .use_value_sexagesimal_format = use_value_sexagesimal_format,
+    };
+    int ret;
+
+    ret = avtext_context_open(ptctx, f, wctx, f_args, sections, FF_ARRAY_ELEMS(sections), tf_options, show_data_hash);
+    if (ret < 0)
+        return ret;
+
+    if (f == &avtextformatter_xml)
+        (*ptctx)->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
+
+    return 0;
+}
+
+typedef struct BatchInput {
+    char     *filename;
+    InputFile ifile;
+    int       ret;          ///< result of open_input_file()
+    int       opened;       ///< set once open_input_file() returned
+} BatchInput;
+
+typedef struct BatchContext {
+    BatchInput *inputs;
+    int      nb_inputs;
+
+    int      next_input;    ///< index of the next input to be opened by a worker
+    int      cur_input;     ///< index of the input being printed
+    int      max_ahead;     ///< how many inputs may be kept opened ahead of cur_input
+
+#if HAVE_THREADS
+    pthread_t      *workers;
+    int          nb_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+#endif
+} BatchContext;
+
+static int read_batch_inputs(BatchContext *bc, const char *list)
+{
+    char *str, *line, *saveptr = NULL;
+    int ret = 0;
+
+    str = read_file_to_string(strcmp(list, "-") ? list : "fd:");
+    if (!str)
+        return AVERROR(EINVAL);
+
+    for (line = av_strtok(str, "\n", &saveptr); line;
+         line = av_strtok(NULL, "\n", &saveptr)) {
+        size_t len = strlen(line);
+        BatchInput *in;
+
+        if (len && line[len - 1] == '\r')
+            line[--len] = 0;
+        if (!len)
+            continue;
+
+        in = av_dynarray2_add((void **)&bc->inputs, &bc->nb_inputs,
+                              sizeof(*bc->inputs), NULL);
+        if (!in) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        memset(in, 0, sizeof(*in));
+        in->filename = av_strdup(line);
+        if (!in->filename) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+    }
+
+    av_free(str);
+    return ret;
+}
+
+#if HAVE_THREADS
+static void *batch_worker(void *arg)
+{
+    BatchContext *bc = arg;
+
+    pthread_mutex_lock(&bc->lock);
+    while (bc->next_input < bc->nb_inputs) {
+        BatchInput *in;
+
+        if (bc->next_input >= bc->cur_input + bc->max_ahead) {
+            pthread_cond_wait(&bc->cond, &bc->lock);
+            continue;
+        }
+        in = &bc->inputs[bc->next_input++];
+        pthread_mutex_unlock(&bc->lock);
+
+        in->ret = open_input_file(&in->ifile, in->filename, NULL, 0);
+
+        pthread_mutex_lock(&bc->lock);
+        in->opened = 1;
+        pthread_cond_broadcast(&bc->cond);
+    }
+    pthread_mutex_unlock(&bc->lock);
+
+    return NULL;
+}
+#endif
+
+static void batch_wait_input(BatchContext *bc, BatchInput *in)
+{
+#if HAVE_THREADS
+    if (bc->nb_workers) {
+        pthread_mutex_lock(&bc->lock);
+        while (!in->opened)
+            pthread_cond_wait(&bc->cond, &bc->lock);
+        pthread_mutex_unlock(&bc->lock);
+        return;
+    }
+#endif
+    in->ret    = open_input_file(&in->ifile, in->filename, NULL, 0);
+    in->opened = 1;
+}
+
+static void batch_input_done(BatchContext *bc, int idx)
+{
+    BatchInput *in = &bc->inputs[idx];
+
+    if (in->ifile.fmt_ctx)
+        close_input_file(&in->ifile);
+    av_freep(&in->filename);
+
+#if HAVE_THREADS
+    if (bc->nb_workers) {
+        pthread_mutex_lock(&bc->lock);
+        bc->cur_input = idx + 1;
+        pthread_cond_broadcast(&bc->cond);
+        pthread_mutex_unlock(&bc->lock);
+        return;
+    }
+#endif
+    bc->cur_input = idx + 1;
+}
+
+static int batch_start_workers(BatchContext *bc)
+{
+#if HAVE_THREADS
+    int nb_workers = batch_threads < 0 ? av_cpu_count() : batch_threads;
+
+    /* the log would get mixed up between inputs probed at the same time */
+    if (do_show_log)
+        nb_workers = 0;
+    nb_workers = FFMIN(nb_workers, bc->nb_inputs);
+    if (nb_workers <= 0)
+        return 0;
+
+    bc->workers = av_calloc(nb_workers, sizeof(*bc->workers));
+    if (!bc->workers)
+        return AVERROR(ENOMEM);
+    pthread_mutex_init(&bc->lock, NULL);
+    pthread_cond_init(&bc->cond, NULL);
+    bc->max_ahead = 2 * nb_workers;
+
+    for (; bc->nb_workers < nb_workers; bc->nb_workers++) {
+        int ret = pthread_create(&bc->workers[bc->nb_workers], NULL, batch_worker, bc);
+        if (ret) {
+            av_log(NULL, AV_LOG_ERROR, "pthread_create() failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            /* the workers already started can handle all the inputs */
+            if (bc->nb_workers)
+                break;
+            pthread_cond_destroy(&bc->cond);
+            pthread_mutex_destroy(&bc->lock);
+            av_freep(&bc->workers);
+            return 0;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void batch_stop_workers(BatchContext *bc)
+{
+#if HAVE_THREADS
+    if (!bc->nb_workers)
+        return;
+
+    pthread_mutex_lock(&bc->lock);
+    bc->next_input = bc->nb_inputs;
+    pthread_cond_broadcast(&bc->cond);
+    pthread_mutex_unlock(&bc->lock);
+
+    for (int i = 0; i < bc->nb_workers; i++)
+        pthread_join(bc->workers[i], NULL);
+    bc->nb_workers = 0;
+
+    pthread_cond_destroy(&bc->cond);
+    pthread_mutex_destroy(&bc->lock);
+    av_freep(&bc->workers);
+#endif
+}
+
+/**
+ * Probe each input listed in the file inputs_from, and print one document
+ * per input. The inputs are opened and their stream parameters probed by a
+ * pool of worker threads, while the main thread reads the packets and prints
+ * the results in the order of the list. An input failing to be probed does
+ * not stop the processing of the following ones.
+ */
+static int probe_batch(const AVTextFormatter *f, AVTextWriterContext *wctx,
+                       const char *f_args)
+{
+    BatchContext bc = { 0 };
+    int ret, i, input_ret = 0;
+
+    ret = read_batch_inputs(&bc, inputs_from);
+    if (ret < 0)
+        goto end;
+
+    ret = batch_start_workers(&bc);
+    if (ret < 0)
+        goto end;
+
+    for (i = 0; i < bc.nb_inputs; i++) {
+        BatchInput *in = &bc.inputs[i];
+        AVTextFormatContext *tctx;
+
+        batch_wait_input(&bc, in);
+        /* dumped here rather than by the workers, so that the dumps of the
+         * inputs are not mixed up and come in the order of the list */
+        if (in->ret >= 0)
+            av_dump_format(in->ifile.fmt_ctx, 0, in->filename, 0);
+
+        ret = open_output_context(&tctx, f, wctx, f_args);
+        if (ret < 0)
+            break;
+
+        avtext_print_section_header(tctx, NULL, SECTION_ID_ROOT);
+
+        if (do_show_program_version)
+            ffprobe_show_program_version(tctx);
+        if (do_show_library_versions)
+            ffprobe_show_library_versions(tctx);
+        if (do_show_pixel_formats)
+            ffprobe_show_pixel_formats(tctx);
+
+        ret = in->ret;
+        if (ret >= 0)
+            ret = probe_input(tctx, &in->ifile);
+        if (ret < 0) {
+            if (do_show_error)
+                show_error(tctx, ret);
+            input_ret = ret;
+        }
+
+        avtext_print_section_footer(tctx);
+
+        ret = avtext_context_close(&tctx);
+        if (ret < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Writing output failed (closing formatter): %s\n", av_err2str(ret));
+            break;
+        }
+
+        batch_input_done(&bc, i);
+    }
+
+end:
+    batch_stop_workers(&bc);
+    for (i = 0; i < bc.nb_inputs; i++) {
+        if (bc.inputs[i].ifile.fmt_ctx)
+            close_input_file(&bc.inputs[i].ifile);
+        av_freep(&bc.inputs[i].filename);
+    }
+    av_freep(&bc.inputs);
+
+    return ret < 0 ? ret : input_ret;
+}
+
 static int opt_show_optional_fields(void *optctx, const char *opt, const char *arg)
 {
     if      (!av_strcasecmp(arg, "always")) show_optional_fields = SHOW_OPTIONAL_FIELDS_ALWAYS;
@@ -3144,6 +3453,10 @@ static const OptionDef real_options[] = {
     { "i",                     OPT_TYPE_FUNC, OPT_FUNC_ARG, {.func_arg = opt_input_file_i}, "read specified file", "input_file"},
     { "o",                     OPT_TYPE_FUNC, OPT_FUNC_ARG, {.func_arg = opt_output_file_o}, "write to specified output", "output_file"},
     { "print_filename",        OPT_TYPE_FUNC, OPT_FUNC_ARG, {.func_arg = opt_print_filename}, "override the printed input filename", "print_file"},
+    { "inputs_from",           OPT_TYPE_STRING,      0, { &inputs_from }, "probe the inputs listed in the specified file, one per line", "list_file" },
+#if HAVE_THREADS
+    { "batch_threads",         OPT_TYPE_INT,         0, { &batch_threads }, "set the number of threads used to probe the -inputs_from inputs", "number" },
+#endif
     { "find_stream_info",      OPT_TYPE_BOOL, OPT_INPUT | OPT_EXPERT, { &find_stream_info },
         "read and decode the streams to fill missing information with heuristics" },
     { "c",                     OPT_TYPE_FUNC, OPT_FUNC_ARG, { .func_arg = opt_codec}, "force decoder", "decoder_name" },
@@ -3229,6 +3542,13 @@ int main(int argc, char **argv)
     SET_DO_SHOW(STREAM_GROUP_STREAM_TAGS, stream_tags);
     SET_DO_SHOW(PACKET_TAGS, packet_tags);
 
+    if (inputs_from && (input_filename || print_input_filename)) {
+        av_log(NULL, AV_LOG_ERROR,
+               "-inputs_from cannot be combined with an input file or -print_filename\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
     if (do_bitexact && (do_show_program_version || do_show_library_versions)) {
         av_log(NULL, AV_LOG_ERROR,
                "-bitexact and -show_program_version or -show_library_versions "
@@ -3267,18 +3587,15 @@ int main(int argc, char **argv)
     if (ret < 0)
         goto end;
 
-    AVTextFormatOptions tf_options = {
-        .show_optional_fields = show_optional_fields,
-        .show_value_unit = show_value_unit,
-        .use_value_prefix = use_value_prefix,
-        .use_byte_value_binary_prefix = use_byte_value_binary_prefix,
-        .use_value_sexagesimal_format = use_value_sexagesimal_format,
-    };
+    if (inputs_from) {
+        input_ret = probe_batch(f, wctx, f_args);
 
-    if ((ret = avtext_context_open(&tctx, f, wctx, f_args, sections, FF_ARRAY_ELEMS(sections), tf_options, show_data_hash)) >= 0) {
-        if (f == &avtextformatter_xml)
-            tctx->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
+        ret = avtextwriter_context_close(&wctx);
+        if (ret < 0)
+            av_log(NULL, AV_LOG_ERROR, "Writing output failed (closing writer): %s\n", av_err2str(ret));
 
+        ret = FFMIN(ret, input_ret);
+    } else if ((ret = open_output_context(&tctx, f, wctx, f_args)) >= 0) {
         avtext_print_section_header(tctx, NULL, SECTION_ID_ROOT);
 
         if (do_show_program_version)
@@ -3321,7 +3638,12 @@ end:
     av_freep(&output_filename);
     av_freep(&input_filename);
     av_freep(&print_input_filename);
+    av_freep(&inputs_from);
     av_freep(&read_intervals);
+    av_freep(&audio_codec_name);
+    av_freep(&data_codec_name);
+    av_freep(&subtitle_codec_name);
+    av_freep(&video_codec_name);
 
     uninit_opts();
     for (i = 0; i < FF_ARRAY_ELEMS(sections); i++)
@@ -19,6 +19,7 @@
  */
 
 #include <limits.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -287,25 +288,30 @@ void avtext_print_section_footer(AVTextFormatContext *tctx)
     tctx->level--;
 }
 
-void avtext_print_integer(AVTextFormatContext *tctx, const char *key, int64_t val, int flags)
+int avtext_is_entry_shown(AVTextFormatContext *tctx, const char *key, int flags)
 {
     const AVTextFormatSection *section;
 
     av_assert0(tctx);
 
     if (tctx->show_optional_fields == SHOW_OPTIONAL_FIELDS_NEVER)
-        return;
+        return 0;
 
     if (tctx->show_optional_fields == SHOW_OPTIONAL_FIELDS_AUTO
         && (flags & AV_TEXTFORMAT_PRINT_STRING_OPTIONAL)
         && !(tctx->formatter->flags & AV_TEXTFORMAT_FLAG_SUPPORTS_OPTIONAL_FIELDS))
-        return;
+        return 0;
 
     av_assert0(key && tctx->level >= 0 && tctx->level < SECTION_MAX_NB_LEVELS);
 
     section = tctx->section[tctx->level];
 
-    if (section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0)) {
+    return section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0);
+}
+
+void avtext_print_integer(AVTextFormatContext *tctx, const char *key, int64_t val, int flags)
+{
+    if (avtext_is_entry_shown(tctx, key, flags)) {
         tctx->formatter->print_integer(tctx, key, val);
         tctx->nb_item[tctx->level]++;
     }
@@ -377,6 +383,42 @@ struct unit_value {
     const char *unit;
 };
 
+/**
+ * Same as snprintf(buf, buf_size, "%f", d), but avoid the comparatively
+ * slow libc formatting for the common case where rounding to 6 decimals
+ * is unambiguous.
+ */
+static void print_double(char *buf, int buf_size, double d)
+{
+    char tmp[32], *p = tmp + sizeof(tmp);
+    double a = fabs(d) * 1000000, ipart, frac;
+    uint64_t v;
+
+    /* below 1e12 the error of the multiplication is smaller than 1e-3 */
+    if (!(a < 1e12) || buf_size < (int)sizeof(tmp))
+        goto fallback;
+    frac = modf(a, &ipart);
+    if (fabs(frac - 0.5) < 1e-3)
+        goto fallback;
+    v = (uint64_t)ipart + (frac > 0.5);
+
+    *--p = 0;
+    for (int i = 0; i < 6; i++, v /= 10)
+        *--p = '0' + v % 10;
+    *--p = '.';
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    if (signbit(d))
+        *--p = '-';
+    memcpy(buf, p, tmp + sizeof(tmp) - p);
+    return;
+
+fallback:
+    snprintf(buf, buf_size, "%f", d);
+}
+
 static char *value_string(const AVTextFormatContext *tctx, char *buf, int buf_size, struct unit_value uv)
 {
     double vald;
@@ -421,12 +463,13 @@ static char *value_string(const AVTextFormatContext *tctx, char *buf, int buf_si
         }
 
         if (show_float || (tctx->use_value_prefix && vald != (int64_t)vald))
-            snprintf(buf, buf_size, "%f", vald);
+            print_double(buf, buf_size, vald);
         else
             snprintf(buf, buf_size, "%"PRId64, vali);
 
-        av_strlcatf(buf, buf_size, "%s%s%s", *prefix_string || tctx->show_value_unit ? " " : "",
-                    prefix_string, tctx->show_value_unit ? uv.unit : "");
+        if (*prefix_string || tctx->show_value_unit)
+            av_strlcatf(buf, buf_size, " %s%s", prefix_string,
+                        tctx->show_value_unit ? uv.unit : "");
     }
 
     return buf;
@@ -437,6 +480,10 @@ void avtext_print_unit_integer(AVTextFormatContext *tctx, const char *key, int64
 {
     char val_str[128];
     struct unit_value uv;
+
+    if (!avtext_is_entry_shown(tctx, key, 0))
+        return;
+
     uv.val.i = val;
     uv.unit = unit;
     avtext_print_string(tctx, key, value_string(tctx, val_str, sizeof(val_str), uv), 0);
@@ -452,15 +499,7 @@ int avtext_print_string(AVTextFormatContext *tctx, const char *key, const char *
 
     section = tctx->section[tctx->level];
 
-    if (tctx->show_optional_fields == SHOW_OPTIONAL_FIELDS_NEVER)
-        return 0;
-
-    if (tctx->show_optional_fields == SHOW_OPTIONAL_FIELDS_AUTO
-        && (flags & AV_TEXTFORMAT_PRINT_STRING_OPTIONAL)
-        && !(tctx->formatter->flags & AV_TEXTFORMAT_FLAG_SUPPORTS_OPTIONAL_FIELDS))
-        return 0;
-
-    if (section->show_all_entries || av_dict_get(section->entries_to_show, key, NULL, 0)) {
+    if (avtext_is_entry_shown(tctx, key, flags)) {
         if (flags & AV_TEXTFORMAT_PRINT_STRING_VALIDATE) {
             char *key1 = NULL, *val1 = NULL;
             ret = validate_string(tctx, &key1, key);
@@ -488,6 +527,10 @@ int avtext_print_string(AVTextFormatContext *tctx, const char *key, const char *
 void avtext_print_rational(AVTextFormatContext *tctx, const char *key, AVRational q, char sep)
 {
     char buf[44];
+
+    if (!avtext_is_entry_shown(tctx, key, 0))
+        return;
+
     snprintf(buf, sizeof(buf), "%d%c%d", q.num, sep, q.den);
     avtext_print_string(tctx, key, buf, 0);
 }
@@ -499,8 +542,13 @@ void avtext_print_time(AVTextFormatContext *tctx, const char *key,
         avtext_print_string(tctx, key, "N/A", AV_TEXTFORMAT_PRINT_STRING_OPTIONAL);
     } else {
         char buf[128];
-        double d = av_q2d(*time_base) * ts;
+        double d;
         struct unit_value uv;
+
+        if (!avtext_is_entry_shown(tctx, key, 0))
+            return;
+
+        d = av_q2d(*time_base) * ts;
         uv.val.d = d;
         uv.unit = unit_second_str;
         value_string(tctx, buf, sizeof(buf), uv);
@@ -551,7 +599,7 @@ void avtext_print_data_hash(AVTextFormatContext *tctx, const char *key,
     char buf[AV_HASH_MAX_SIZE * 2 + 64] = { 0 };
     int len;
 
-    if (!tctx->hash)
+    if (!tctx->hash || !avtext_is_entry_shown(tctx, key, 0))
         return;
 
     av_hash_init(tctx->hash);
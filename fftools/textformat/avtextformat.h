@@ -165,6 +165,13 @@ void avtext_print_section_header(AVTextFormatContext *tctx, const void *data, in
 
 void avtext_print_section_footer(AVTextFormatContext *tctx);
 
+/**
+ * Check whether an entry with the given key and AV_TEXTFORMAT_PRINT_STRING_*
+ * flags would be printed in the current section, so that callers can skip
+ * formatting values which are not going to be shown.
+ */
+int avtext_is_entry_shown(AVTextFormatContext *tctx, const char *key, int flags);
+
 void avtext_print_integer(AVTextFormatContext *tctx, const char *key, int64_t val, int flags);
 
 int avtext_print_string(AVTextFormatContext *tctx, const char *key, const char *val, int flags);
@@ -91,6 +91,7 @@ typedef struct CompactContext {
     int print_section;
     char *escape_mode_str;
     const char * (*escape_str)(AVBPrint *dst, const char *src, const char sep, void *log_ctx);
+    char escape_chars[8];   ///< characters which make a value need escaping
     int nested_section[SECTION_MAX_NB_LEVELS];
     int has_nested_elems[SECTION_MAX_NB_LEVELS];
     int terminate_line[SECTION_MAX_NB_LEVELS];
@@ -128,8 +129,12 @@ static av_cold int compact_init(AVTextFormatContext *wctx)
         compact->escape_str = none_escape_str;
     } else if (!strcmp(compact->escape_mode_str, "c"   )) {
         compact->escape_str = c_escape_str;
+        snprintf(compact->escape_chars, sizeof(compact->escape_chars),
+                 "\b\f\n\r\\%c", compact->item_sep);
     } else if (!strcmp(compact->escape_mode_str, "csv" )) {
         compact->escape_str = csv_escape_str;
+        snprintf(compact->escape_chars, sizeof(compact->escape_chars),
+                 "\"\n\r%c", compact->item_sep);
     } else {
         av_log(wctx, AV_LOG_ERROR, "Unknown escape mode '%s'\n", compact->escape_mode_str);
         return AVERROR(EINVAL);
@@ -207,16 +212,32 @@ static void compact_print_section_footer(AVTextFormatContext *wctx)
         writer_w8(wctx, '\n');
 }
 
-static void compact_print_str(AVTextFormatContext *wctx, const char *key, const char *value)
+static void compact_print_key(AVTextFormatContext *wctx, const char *key)
 {
     CompactContext *compact = wctx->priv;
-    AVBPrint buf;
 
     if (wctx->nb_item[wctx->level])
         writer_w8(wctx, compact->item_sep);
 
-    if (!compact->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+    if (!compact->nokey) {
+        writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+        writer_put_str(wctx, key);
+        writer_w8(wctx, '=');
+    }
+}
+
+static void compact_print_str(AVTextFormatContext *wctx, const char *key, const char *value)
+{
+    CompactContext *compact = wctx->priv;
+    AVBPrint buf;
+
+    compact_print_key(wctx, key);
+
+    /* most values need no escaping, avoid copying them */
+    if (!value[strcspn(value, compact->escape_chars)]) {
+        writer_put_str(wctx, value);
+        return;
+    }
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
     writer_put_str(wctx, compact->escape_str(&buf, value, compact->item_sep, wctx));
@@ -225,14 +246,7 @@ static void compact_print_str(AVTextFormatContext *wctx, const char *key, const
 
 static void compact_print_int(AVTextFormatContext *wctx, const char *key, int64_t value)
 {
-    CompactContext *compact = wctx->priv;
-
-    if (wctx->nb_item[wctx->level])
-        writer_w8(wctx, compact->item_sep);
-
-    if (!compact->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
-
+    compact_print_key(wctx, key);
     writer_printf(wctx, "%"PRId64, value);
 }
 
@@ -106,21 +106,27 @@ static void default_print_section_footer(AVTextFormatContext *wctx)
         writer_printf(wctx, "[/%s]\n", upcase_string(buf, sizeof(buf), section->name));
 }
 
-static void default_print_str(AVTextFormatContext *wctx, const char *key, const char *value)
+static void default_print_key(AVTextFormatContext *wctx, const char *key)
 {
     DefaultContext *def = wctx->priv;
 
-    if (!def->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    writer_printf(wctx, "%s\n", value);
+    if (!def->nokey) {
+        writer_put_str(wctx, wctx->section_pbuf[wctx->level].str);
+        writer_put_str(wctx, key);
+        writer_w8(wctx, '=');
+    }
 }
 
-static void default_print_int(AVTextFormatContext *wctx, const char *key, int64_t value)
+static void default_print_str(AVTextFormatContext *wctx, const char *key, const char *value)
 {
-    DefaultContext *def = wctx->priv;
+    default_print_key(wctx, key);
+    writer_put_str(wctx, value);
+    writer_w8(wctx, '\n');
+}
 
-    if (!def->nokey)
-        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+static void default_print_int(AVTextFormatContext *wctx, const char *key, int64_t value)
+{
+    default_print_key(wctx, key);
     writer_printf(wctx, "%"PRId64"\n", value);
 }
 
@@ -26,6 +26,7 @@
 
 #include "avtextformat.h"
 #include "libavutil/bprint.h"
+#include "libavutil/common.h"
 #include "libavutil/opt.h"
 #include "tf_internal.h"
 
@@ -70,6 +71,13 @@ static const char *json_escape_str(AVBPrint *dst, const char *src, void *log_ctx
         return NULL;
     }
 
+    /* most strings need no escaping, return them as they are */
+    for (p = src; *p; p++)
+        if (*p == '"' || *p == '\\' || (unsigned char)*p < 32)
+            break;
+    if (!*p)
+        return src;
+
     for (p = src; *p; p++) {
         char *s = strchr(json_escape, *p);
         if (s) {
@@ -84,7 +92,16 @@ static const char *json_escape_str(AVBPrint *dst, const char *src, void *log_ctx
     return dst->str;
 }
 
-#define JSON_INDENT() writer_printf(wctx, "%*c", json->indent_level * 4, ' ')
+static void json_indent(AVTextFormatContext *wctx, int level)
+{
+    static const char spaces[] = "                                                ";
+    /* like printf("%*c", level * 4, ' '), always print at least one space */
+    int n = av_clip(level * 4, 1, sizeof(spaces) - 1);
+
+    writer_put_str(wctx, spaces + sizeof(spaces) - 1 - n);
+}
+
+#define JSON_INDENT() json_indent(wctx, json->indent_level)
 
 static void json_print_section_header(AVTextFormatContext *wctx, const void *data)
 {
@@ -92,6 +109,7 @@ static void json_print_section_header(AVTextFormatContext *wctx, const void *dat
     const AVTextFormatSection *parent_section = tf_get_parent_section(wctx, wctx->level);
     JSONContext *json = wctx->priv;
     AVBPrint buf;
+    const char *name;
 
     if (!section)
         return;
@@ -104,14 +122,14 @@ static void json_print_section_header(AVTextFormatContext *wctx, const void *dat
         json->indent_level++;
     } else {
         av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-        json_escape_str(&buf, section->name, wctx);
+        name = json_escape_str(&buf, section->name, wctx);
         JSON_INDENT();
 
         json->indent_level++;
         if (section->flags & AV_TEXTFORMAT_SECTION_FLAG_IS_ARRAY) {
-            writer_printf(wctx, "\"%s\": [\n", buf.str);
+            writer_printf(wctx, "\"%s\": [\n", name);
         } else if (parent_section && !(parent_section->flags & AV_TEXTFORMAT_SECTION_FLAG_IS_ARRAY)) {
-            writer_printf(wctx, "\"%s\": {%s", buf.str, json->item_start_end);
+            writer_printf(wctx, "\"%s\": {%s", name, json->item_start_end);
         } else {
             writer_printf(wctx, "{%s", json->item_start_end);
 
@@ -158,9 +176,12 @@ static inline void json_print_item_str(AVTextFormatContext *wctx,
     AVBPrint buf;
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    writer_printf(wctx, "\"%s\":", json_escape_str(&buf, key,   wctx));
+    writer_w8(wctx, '"');
+    writer_put_str(wctx, json_escape_str(&buf, key, wctx));
+    writer_put_str(wctx, "\": \"");
     av_bprint_clear(&buf);
-    writer_printf(wctx, " \"%s\"", json_escape_str(&buf, value, wctx));
+    writer_put_str(wctx, json_escape_str(&buf, value, wctx));
+    writer_w8(wctx, '"');
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -196,7 +217,9 @@ static void json_print_int(AVTextFormatContext *wctx, const char *key, int64_t v
         JSON_INDENT();
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    writer_printf(wctx, "\"%s\": %"PRId64, json_escape_str(&buf, key, wctx), value);
+    writer_w8(wctx, '"');
+    writer_put_str(wctx, json_escape_str(&buf, key, wctx));
+    writer_printf(wctx, "\": %"PRId64, value);
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -45,12 +45,12 @@ static const AVClass stdoutwriter_class = {
 
 static inline void stdout_w8(AVTextWriterContext *wctx, int b)
 {
-    printf("%c", b);
+    putchar(b);
 }
 
 static inline void stdout_put_str(AVTextWriterContext *wctx, const char *str)
 {
-    printf("%s", str);
+    fputs(str, stdout);
 }
 
 static inline void stdout_vprintf(AVTextWriterContext *wctx, const char *fmt, va_list vl)
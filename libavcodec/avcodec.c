@@ -442,7 +442,7 @@ av_cold void ff_codec_close(AVCodecContext *avctx)
             ff_frame_thread_encoder_free(avctx);
         }
 #endif
-        if (HAVE_THREADS && avci->thread_ctx)
+        if (HAVE_THREADS && (avci->thread_ctx || avci->slice_thread_ctx))
             ff_thread_free(avctx);
         if (avci->needs_close && ffcodec(avctx->codec)->close)
             ffcodec(avctx->codec)->close(avctx);
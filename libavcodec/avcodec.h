@@ -1930,6 +1930,18 @@ typedef struct AVCodecContext {
      * - decoding: Set by libavcodec
      */
     enum AVAlphaMode alpha_mode;
+
+    /**
+     * Number of slice threads used by each frame thread, for decoders that
+     * support combining frame and slice threading. It is only used when
+     * thread_type contains both FF_THREAD_FRAME and FF_THREAD_SLICE and
+     * frame threading is active; thread_count then sets the number of frame
+     * threads. Values below 2 disable the combination.
+     *
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_slice_threads;
 } AVCodecContext;
 
 /**
@@ -32,6 +32,12 @@
 #include "h264.h"
 #include "sei.h"
 
+typedef struct NALUnitPosition {
+    uint32_t offset;
+    uint32_t size;
+    uint8_t  start_code_size;
+} NALUnitPosition;
+
 typedef struct H264BSFContext {
     uint8_t *sps;
     uint8_t *pps;
@@ -44,6 +50,10 @@ typedef struct H264BSFContext {
     uint8_t  idr_sps_seen;
     uint8_t  idr_pps_seen;
     int      extradata_parsed;
+
+    /* NAL units of the packet being converted in place */
+    NALUnitPosition *nals;
+    unsigned         nals_allocated;
 } H264BSFContext;
 
 enum PsSource {
@@ -274,6 +284,81 @@ static int h264_mp4toannexb_init(AVBSFContext *ctx)
                                     ctx->par_in->extradata_size);
 }
 
+/**
+ * Convert a packet with 4 byte NAL sizes in place, if no parameter sets
+ * have to be inserted. Start codes are never longer than the sizes they
+ * replace, so the output is written backwards, ending where the input ends:
+ * the last NAL units, usually the slices, are not moved.
+ *
+ * @param out_size size of the converted packet computed by the first pass,
+ *                 which also validated the NAL sizes
+ * @return 1 if the packet was converted, 0 if it can't be converted in place,
+ *         <0 on error
+ */
+static int h264_mp4toannexb_in_place(H264BSFContext *s, AVPacket *in, uint64_t out_size)
+{
+    const uint8_t *buf     = in->data;
+    const uint8_t *buf_end = in->data + in->size;
+    uint64_t size = 0;
+    int nb_nals = 0, ret;
+    uint8_t *dst;
+
+    do {
+        uint32_t nal_size = AV_RB32(buf);
+
+        buf += 4;
+        if (nal_size) {
+            uint8_t unit_type = *buf & 0x1f;
+            NALUnitPosition *nal;
+
+            if (nb_nals >= s->nals_allocated / sizeof(*s->nals)) {
+                NALUnitPosition *nals = av_fast_realloc(s->nals, &s->nals_allocated,
+                                                        (nb_nals + 1) * sizeof(*s->nals));
+                if (!nals)
+                    return AVERROR(ENOMEM);
+                s->nals = nals;
+            }
+            nal = &s->nals[nb_nals++];
+            nal->offset = buf - in->data;
+            nal->size   = nal_size;
+            /* same rule as count_or_copy() */
+            nal->start_code_size = !size || unit_type == H264_NAL_SPS ||
+                                   unit_type == H264_NAL_PPS ? 4 : 3;
+            size += nal->start_code_size + nal_size;
+        }
+        buf += nal_size;
+    } while (buf < buf_end);
+
+    /* parameter sets are inserted */
+    if (size != out_size)
+        return 0;
+
+    ret = av_packet_make_writable(in);
+    if (ret < 0)
+        return ret;
+
+    dst = in->data + in->size;
+    for (int i = nb_nals - 1; i >= 0; i--) {
+        const NALUnitPosition *nal = &s->nals[i];
+
+        dst -= nal->size;
+        if (dst != in->data + nal->offset)
+            memmove(dst, in->data + nal->offset, nal->size);
+        dst -= nal->start_code_size;
+        if (nal->start_code_size == 4) {
+            AV_WB32(dst, 1);
+        } else {
+            dst[0] =
+            dst[1] = 0;
+            dst[2] = 1;
+        }
+    }
+    in->size -= dst - in->data;
+    in->data  = dst;
+
+    return 1;
+}
+
 static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
 {
     H264BSFContext *s = ctx->priv_data;
@@ -283,7 +368,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
     const uint8_t *buf_end;
     uint8_t *out;
     uint64_t out_size;
-    int ret;
+    int ret, in_place = 0;
     size_t extradata_size;
     uint8_t *extradata;
 
@@ -314,7 +399,7 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
         goto fail;
 
 #define LOG_ONCE(...) \
-    if (j) \
+    if (!j) \
         av_log(__VA_ARGS__)
     for (int j = 0; j < 2; j++) {
         buf      = in->data;
@@ -415,6 +500,16 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
                 ret = AVERROR_INVALIDDATA;
                 goto fail;
             }
+            if (s->length_size == 4) {
+                ret = h264_mp4toannexb_in_place(s, in, out_size);
+                if (ret < 0)
+                    goto fail;
+                if (ret) {
+                    in_place = 1;
+                    ret = 0;
+                    break;
+                }
+            }
             ret = av_new_packet(opkt, out_size);
             if (ret < 0)
                 goto fail;
@@ -423,15 +518,20 @@ static int h264_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *opkt)
     }
 #undef LOG_ONCE
 
+    if (in_place)
+        av_packet_move_ref(opkt, in);
+
     av_assert1(out_size == opkt->size);
 
     s->new_idr      = new_idr;
     s->idr_sps_seen = sps_seen;
     s->idr_pps_seen = pps_seen;
 
-    ret = av_packet_copy_props(opkt, in);
-    if (ret < 0)
-        goto fail;
+    if (!in_place) {
+        ret = av_packet_copy_props(opkt, in);
+        if (ret < 0)
+            goto fail;
+    }
 
 fail:
     if (ret < 0)
@@ -447,6 +547,7 @@ static void h264_mp4toannexb_close(AVBSFContext *ctx)
 
     av_freep(&s->sps);
     av_freep(&s->pps);
+    av_freep(&s->nals);
 }
 
 static void h264_mp4toannexb_flush(AVBSFContext *ctx)
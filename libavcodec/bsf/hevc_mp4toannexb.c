@@ -119,6 +119,37 @@ static int hevc_mp4toannexb_init(AVBSFContext *ctx)
     return 0;
 }
 
+/**
+ * Replace the 4 byte NAL sizes by start codes in place, for packets that
+ * don't get the extradata prepended.
+ */
+static int hevc_mp4toannexb_in_place(AVPacket *in)
+{
+    uint8_t *buf, *buf_end;
+    int ret;
+
+    ret = av_packet_make_writable(in);
+    if (ret < 0)
+        return ret;
+
+    buf     = in->data;
+    buf_end = in->data + in->size;
+    while (buf < buf_end) {
+        uint32_t nalu_size;
+
+        if (buf_end - buf < 4)
+            return AVERROR_INVALIDDATA;
+        nalu_size = AV_RB32(buf);
+        if (nalu_size < 2 || nalu_size > buf_end - buf - 4)
+            return AVERROR_INVALIDDATA;
+
+        AV_WB32(buf, 1);
+        buf += 4 + nalu_size;
+    }
+
+    return 0;
+}
+
 static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
 {
     HEVCBSFContext *s = ctx->priv_data;
@@ -164,6 +195,16 @@ static int hevc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
         got_ps   |= nalu_type >= HEVC_NAL_VPS && nalu_type <= HEVC_NAL_PPS;
     }
     seen_irap_ps = got_irap && got_ps;
+
+    if (s->length_size == 4 && (!got_irap || !ctx->par_out->extradata_size)) {
+        ret = hevc_mp4toannexb_in_place(in);
+        if (ret < 0)
+            goto fail;
+        av_packet_move_ref(out, in);
+        av_packet_free(&in);
+        return 0;
+    }
+
     got_irap = got_ps = 0;
 
     bytestream2_init(&gb, in->data, in->size);
@@ -87,6 +87,12 @@
  * encoders do.
  */
 #define FF_CODEC_CAP_EOF_FLUSH              (1 << 10)
+/**
+ * The decoder supports slice threading inside each frame thread, see
+ * AVCodecContext.frame_slice_threads. It must then not report frame
+ * progress for parts of a frame that other slice threads are still decoding.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS    (1 << 11)
 
 /**
  * FFCodec.codec_tags termination value
@@ -0,0 +1,150 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/avassert.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/intreadwrite.h"
+
+#include "h2645_lowres.h"
+
+int ff_h2645_lowres_alloc_recon(AVFrame **recon, int format,
+                                int width, int height)
+{
+    AVFrame *f = *recon;
+    int ret;
+
+    if (f && f->format == format && f->width == width && f->height == height)
+        return 0;
+
+    if (!f) {
+        f = *recon = av_frame_alloc();
+        if (!f)
+            return AVERROR(ENOMEM);
+    } else
+        av_frame_unref(f);
+
+    f->format = format;
+    f->width  = width;
+    f->height = height;
+    ret = av_frame_get_buffer(f, 0);
+    if (ret < 0)
+        av_frame_unref(f);
+    return ret;
+}
+
+static av_always_inline void downscale(uint8_t *dst, ptrdiff_t dst_stride,
+                                       const uint8_t *src, ptrdiff_t src_stride,
+                                       int w, int h, int lowres, int high_bd)
+{
+    const int n     = 1 << lowres;
+    const int shift = 2 * lowres;
+
+    for (int y = 0; y < h; y += n) {
+        for (int x = 0; x < w; x += n) {
+            unsigned sum = 0;
+
+            for (int j = 0; j < n; j++) {
+                for (int i = 0; i < n; i++) {
+                    if (high_bd)
+                        sum += AV_RN16(src + j * src_stride + 2 * (x + i));
+                    else
+                        sum += src[j * src_stride + x + i];
+                }
+            }
+            sum = (sum + (1 << (shift - 1))) >> shift;
+            if (high_bd)
+                AV_WN16(dst + 2 * (x >> lowres), sum);
+            else
+                dst[x >> lowres] = sum;
+        }
+        src += n * src_stride;
+        dst += dst_stride;
+    }
+}
+
+static void downscale_edge(uint8_t *dst, ptrdiff_t dst_stride,
+                           const uint8_t *src, ptrdiff_t src_stride,
+                           int w, int h, int lowres, int high_bd)
+{
+    const int n = 1 << lowres;
+
+    for (int y = 0; y < h; y += n) {
+        const int bh = FFMIN(n, h - y);
+
+        for (int x = 0; x < w; x += n) {
+            const int bw    = FFMIN(n, w - x);
+            const int count = bw * bh;
+            unsigned sum = 0;
+
+            for (int j = 0; j < bh; j++) {
+                for (int i = 0; i < bw; i++) {
+                    if (high_bd)
+                        sum += AV_RN16(src + j * src_stride + 2 * (x + i));
+                    else
+                        sum += src[j * src_stride + x + i];
+                }
+            }
+            sum = (sum + count / 2) / count;
+            if (high_bd)
+                AV_WN16(dst + 2 * (x >> lowres), sum);
+            else
+                dst[x >> lowres] = sum;
+        }
+        src += n * src_stride;
+        dst += dst_stride;
+    }
+}
+
+#define DOWNSCALE_FUNCS(lowres)                                               \
+static void downscale8_ ## lowres(uint8_t *dst, ptrdiff_t dst_stride,         \
+                                  const uint8_t *src, ptrdiff_t src_stride,   \
+                                  int w, int h)                               \
+{                                                                             \
+    downscale(dst, dst_stride, src, src_stride, w, h, lowres, 0);             \
+}                                                                             \
+static void downscale16_ ## lowres(uint8_t *dst, ptrdiff_t dst_stride,        \
+                                   const uint8_t *src, ptrdiff_t src_stride,  \
+                                   int w, int h)                              \
+{                                                                             \
+    downscale(dst, dst_stride, src, src_stride, w, h, lowres, 1);             \
+}
+
+DOWNSCALE_FUNCS(1)
+DOWNSCALE_FUNCS(2)
+DOWNSCALE_FUNCS(3)
+
+void ff_h2645_lowres_downscale(uint8_t *dst, ptrdiff_t dst_stride,
+                               const uint8_t *src, ptrdiff_t src_stride,
+                               int w, int h, int lowres, int pixel_shift)
+{
+    static void (* const funcs[2][3])(uint8_t *dst, ptrdiff_t dst_stride,
+                                      const uint8_t *src, ptrdiff_t src_stride,
+                                      int w, int h) = {
+        { downscale8_1,  downscale8_2,  downscale8_3  },
+        { downscale16_1, downscale16_2, downscale16_3 },
+    };
+
+    av_assert2(lowres >= 1 && lowres <= 3);
+
+    if ((w | h) & ((1 << lowres) - 1))
+        downscale_edge(dst, dst_stride, src, src_stride, w, h, lowres, pixel_shift);
+    else
+        funcs[pixel_shift][lowres - 1](dst, dst_stride, src, src_stride, w, h);
+}
@@ -0,0 +1,56 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Reduced resolution (lowres) output helpers shared by the H.264 and
+ * HEVC decoders.
+ */
+
+#ifndef AVCODEC_H2645_LOWRES_H
+#define AVCODEC_H2645_LOWRES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/frame.h"
+
+/**
+ * Allocate (or reallocate on parameter change) the full resolution frame
+ * the decoder reconstructs into when lowres decoding is enabled.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_h2645_lowres_alloc_recon(AVFrame **recon, int format,
+                                int width, int height);
+
+/**
+ * Box-filter a block of a full resolution plane into the lowres output,
+ * averaging each (1 << lowres) x (1 << lowres) group of source pixels
+ * into one destination pixel. Partial groups at the right and bottom
+ * edges of the block are averaged over the pixels that exist.
+ *
+ * @param w          block width in source pixels
+ * @param h          block height in source pixels
+ * @param pixel_shift 0 for 8-bit samples, 1 for 16-bit samples
+ */
+void ff_h2645_lowres_downscale(uint8_t *dst, ptrdiff_t dst_stride,
+                               const uint8_t *src, ptrdiff_t src_stride,
+                               int w, int h, int lowres, int pixel_shift);
+
+#endif /* AVCODEC_H2645_LOWRES_H */
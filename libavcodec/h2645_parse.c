@@ -30,6 +30,7 @@
 #include "bytestream.h"
 #include "h264.h"
 #include "h2645_parse.h"
+#include "startcode.h"
 #include "vvc.h"
 
 #include "hevc/hevc.h"
@@ -41,51 +42,17 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     uint8_t *dst;
 
     nal->skipped_bytes = 0;
-#define STARTCODE_TEST                                                  \
-        if (i + 2 < length && src[i + 1] == 0 &&                        \
-           (src[i + 2] == 3 || src[i + 2] == 1)) {                      \
-            if (src[i + 2] == 1) {                                      \
-                /* startcode, so we must be past the end */             \
-                length = i;                                             \
-            }                                                           \
-            break;                                                      \
+    for (i = 0; i + 1 < length; i++) {
+        i += ff_startcode_find_candidate_c(src + i, length - i);
+        if (i + 2 < length && src[i + 1] == 0 &&
+           (src[i + 2] == 3 || src[i + 2] == 1)) {
+            if (src[i + 2] == 1) {
+                /* startcode, so we must be past the end */
+                length = i;
+            }
+            break;
         }
-#if HAVE_FAST_UNALIGNED
-#define FIND_FIRST_ZERO                                                 \
-        if (i > 0 && !src[i])                                           \
-            i--;                                                        \
-        while (src[i])                                                  \
-            i++
-#if HAVE_FAST_64BIT
-    for (i = 0; i + 1 < length; i += 9) {
-        if (!((~AV_RN64(src + i) &
-               (AV_RN64(src + i) - 0x0100010001000101ULL)) &
-              0x8000800080008080ULL))
-            continue;
-        FIND_FIRST_ZERO;
-        STARTCODE_TEST;
-        i -= 7;
-    }
-#else
-    for (i = 0; i + 1 < length; i += 5) {
-        if (!((~AV_RN32(src + i) &
-               (AV_RN32(src + i) - 0x01000101U)) &
-              0x80008080U))
-            continue;
-        FIND_FIRST_ZERO;
-        STARTCODE_TEST;
-        i -= 3;
-    }
-#endif /* HAVE_FAST_64BIT */
-#else
-    for (i = 0; i + 1 < length; i += 2) {
-        if (src[i])
-            continue;
-        if (i > 0 && src[i - 1] == 0)
-            i--;
-        STARTCODE_TEST;
     }
-#endif /* HAVE_FAST_UNALIGNED */
 
     if (i >= length - 1 && small_padding) { // no escaped 0
         nal->data     =
@@ -102,10 +69,15 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     si = di = i;
     while (si + 2 < length) {
         // remove escapes (very rare 1:2^22)
-        if (src[si + 2] > 3) {
-            dst[di++] = src[si++];
-            dst[di++] = src[si++];
-        } else if (src[si] == 0 && src[si + 1] == 0 && src[si + 2] != 0) {
+        if (src[si]) {
+            /* copy up to the next zero byte in one go */
+            int run = FFMIN(ff_startcode_find_candidate_c(src + si, length - 2 - si),
+                            length - 2 - si);
+            memcpy(dst + di, src + si, run);
+            si += run;
+            di += run;
+            continue;
+        } else if (src[si + 1] == 0 && src[si + 2] && src[si + 2] <= 3) {
             if (src[si + 2] == 3) { // escape
                 dst[di++] = 0;
                 dst[di++] = 0;
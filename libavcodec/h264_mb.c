@@ -33,6 +33,7 @@
 #include "avcodec.h"
 #include "h264dec.h"
 #include "h264_ps.h"
+#include "h2645_lowres.h"
 #include "qpeldsp.h"
 #include "rectangle.h"
 #include "threadframe.h"
@@ -797,6 +798,53 @@ static av_always_inline void hl_decode_mb_idct_luma(const H264Context *h, H264Sl
 #define SIMPLE 0
 #include "h264_mb_template.c"
 
+/**
+ * Box-filter the MB just reconstructed into h->lowres_recon into the
+ * reduced resolution output picture.
+ *
+ * Field MB pairs of MBAFF frames are downscaled as frame rows once their
+ * bottom MB is reconstructed. The fields of field pictures are decoded
+ * separately, possibly by different threads, so each one is downscaled on
+ * its own into the output rows of its parity.
+ */
+static void hl_output_mb_lowres(const H264Context *h, const H264SliceContext *sl)
+{
+    const AVFrame *src = h->lowres_recon;
+    const AVFrame *dst = h->cur_pic.f;
+    const int lowres   = h->avctx->lowres;
+    const int planes   = CONFIG_GRAY && (h->flags & AV_CODEC_FLAG_GRAY) ? 1 : 3;
+    const int pair     = MB_FIELD(sl) && !FIELD_PICTURE(h);
+
+    if (pair && !(sl->mb_y & 1))
+        return;
+
+    for (int p = 0; p < planes; p++) {
+        const int bw = p ? 16 >> h->chroma_x_shift : 16;
+        int       bh = p ? 16 >> h->chroma_y_shift : 16;
+        ptrdiff_t src_stride = src->linesize[p];
+        ptrdiff_t dst_stride = dst->linesize[p];
+        const uint8_t *s = src->data[p] + (sl->mb_x * bw << h->pixel_shift) +
+                           sl->mb_y * bh * src_stride;
+        uint8_t *d       = dst->data[p] + ((sl->mb_x * bw >> lowres) << h->pixel_shift) +
+                           sl->mb_y * (bh >> lowres) * dst_stride;
+
+        if (pair) {
+            s  -= src_stride * bh;
+            d  -= dst_stride * (bh >> lowres);
+            bh *= 2;
+        } else if (MB_FIELD(sl)) {
+            if (sl->mb_y & 1) {
+                s -= src_stride * (bh - 1);
+                d -= dst_stride * ((bh >> lowres) - 1);
+            }
+            src_stride *= 2;
+            dst_stride *= 2;
+        }
+        ff_h2645_lowres_downscale(d, dst_stride, s, src_stride, bw, bh,
+                                  lowres, h->pixel_shift);
+    }
+}
+
 void ff_h264_hl_decode_mb(const H264Context *h, H264SliceContext *sl)
 {
     const int mb_xy   = sl->mb_xy;
@@ -815,4 +863,7 @@ void ff_h264_hl_decode_mb(const H264Context *h, H264SliceContext *sl)
         hl_decode_mb_simple_16(h, sl);
     } else
         hl_decode_mb_simple_8(h, sl);
+
+    if (h->avctx->lowres)
+        hl_output_mb_lowres(h, sl);
 }
@@ -41,6 +41,7 @@
 #include "h264data.h"
 #include "h264chroma.h"
 #include "h264_ps.h"
+#include "h2645_lowres.h"
 #include "golomb.h"
 #include "mathops.h"
 #include "mpegutils.h"
@@ -482,6 +483,7 @@ int ff_h264_update_thread_context_for_user(AVCodecContext *dst,
 static int h264_frame_start(H264Context *h)
 {
     H264Picture *pic;
+    AVFrame *recon;
     int i, ret;
     const int pixel_shift = h->pixel_shift;
 
@@ -516,10 +518,23 @@ static int h264_frame_start(H264Context *h)
 
     pic->f->pict_type = h->slice_ctx[0].slice_type;
 
-    pic->f->crop_left   = h->crop_left;
-    pic->f->crop_right  = h->crop_right;
-    pic->f->crop_top    = h->crop_top;
-    pic->f->crop_bottom = h->crop_bottom;
+    if (h->avctx->lowres) {
+        const int lowres = h->avctx->lowres;
+        const int width  = h->width  - h->crop_left - h->crop_right;
+        const int height = h->height - h->crop_top  - h->crop_bottom;
+
+        pic->f->crop_left   = h->crop_left >> lowres;
+        pic->f->crop_top    = h->crop_top  >> lowres;
+        pic->f->crop_right  = AV_CEIL_RSHIFT(h->width,  lowres) - pic->f->crop_left -
+                              AV_CEIL_RSHIFT(width,     lowres);
+        pic->f->crop_bottom = AV_CEIL_RSHIFT(h->height, lowres) - pic->f->crop_top -
+                              AV_CEIL_RSHIFT(height,    lowres);
+    } else {
+        pic->f->crop_left   = h->crop_left;
+        pic->f->crop_right  = h->crop_right;
+        pic->f->crop_top    = h->crop_top;
+        pic->f->crop_bottom = h->crop_bottom;
+    }
 
     pic->needs_fg =
         h->sei.common.film_grain_characteristics &&
@@ -530,6 +545,17 @@ static int h264_frame_start(H264Context *h)
     if ((ret = alloc_picture(h, pic)) < 0)
         return ret;
 
+    /* With lowres, pictures are reconstructed at full resolution into a
+     * private frame and box-filtered into the output picture per MB. */
+    if (h->avctx->lowres) {
+        ret = ff_h2645_lowres_alloc_recon(&h->lowres_recon, pic->f->format,
+                                          h->width, h->height);
+        if (ret < 0)
+            return ret;
+        recon = h->lowres_recon;
+    } else
+        recon = pic->f;
+
     h->cur_pic_ptr = pic;
     ff_h264_unref_picture(&h->cur_pic);
     if (CONFIG_ERROR_RESILIENCE) {
@@ -540,8 +566,8 @@ static int h264_frame_start(H264Context *h)
         return ret;
 
     for (i = 0; i < h->nb_slice_ctx; i++) {
-        h->slice_ctx[i].linesize   = h->cur_pic_ptr->f->linesize[0];
-        h->slice_ctx[i].uvlinesize = h->cur_pic_ptr->f->linesize[1];
+        h->slice_ctx[i].linesize   = recon->linesize[0];
+        h->slice_ctx[i].uvlinesize = recon->linesize[1];
     }
 
     if (CONFIG_ERROR_RESILIENCE && h->enable_er) {
@@ -551,14 +577,14 @@ static int h264_frame_start(H264Context *h)
     }
 
     for (i = 0; i < 16; i++) {
-        h->block_offset[i]           = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 4 * pic->f->linesize[0] * ((scan8[i] - scan8[0]) >> 3);
-        h->block_offset[48 + i]      = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 8 * pic->f->linesize[0] * ((scan8[i] - scan8[0]) >> 3);
+        h->block_offset[i]           = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 4 * recon->linesize[0] * ((scan8[i] - scan8[0]) >> 3);
+        h->block_offset[48 + i]      = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 8 * recon->linesize[0] * ((scan8[i] - scan8[0]) >> 3);
     }
     for (i = 0; i < 16; i++) {
         h->block_offset[16 + i]      =
-        h->block_offset[32 + i]      = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 4 * pic->f->linesize[1] * ((scan8[i] - scan8[0]) >> 3);
+        h->block_offset[32 + i]      = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 4 * recon->linesize[1] * ((scan8[i] - scan8[0]) >> 3);
         h->block_offset[48 + 16 + i] =
-        h->block_offset[48 + 32 + i] = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 8 * pic->f->linesize[1] * ((scan8[i] - scan8[0]) >> 3);
+        h->block_offset[48 + 32 + i] = (4 * ((scan8[i] - scan8[0]) & 7) << pixel_shift) + 8 * recon->linesize[1] * ((scan8[i] - scan8[0]) >> 3);
     }
 
     /* We mark the current picture as non-reference after allocating it, so
@@ -912,6 +938,12 @@ static enum AVPixelFormat get_pixel_format(H264Context *h, int force_callback)
         return AVERROR_INVALIDDATA;
     }
 
+    /* The software format is always listed last; hwaccels cannot do lowres. */
+    if (h->avctx->lowres) {
+        pix_fmts[0] = fmt[-1];
+        fmt = pix_fmts + 1;
+    }
+
     *fmt = AV_PIX_FMT_NONE;
 
     for (int i = 0; pix_fmts[i] != AV_PIX_FMT_NONE; i++)
@@ -953,8 +985,8 @@ static void init_dimensions(H264Context *h)
 
     h->avctx->coded_width  = h->width;
     h->avctx->coded_height = h->height;
-    h->avctx->width        = width;
-    h->avctx->height       = height;
+    h->avctx->width        = AV_CEIL_RSHIFT(width,  h->avctx->lowres);
+    h->avctx->height       = AV_CEIL_RSHIFT(height, h->avctx->lowres);
     h->crop_right          = cr;
     h->crop_left           = cl;
     h->crop_top            = ct;
@@ -1952,7 +1984,8 @@ static int h264_slice_init(H264Context *h, H264SliceContext *sl,
     if (!h->setup_finished)
         ff_h264_direct_ref_list_init(h, sl);
 
-    if (h->avctx->skip_loop_filter >= AVDISCARD_ALL ||
+    if (h->avctx->lowres ||
+        h->avctx->skip_loop_filter >= AVDISCARD_ALL ||
         (h->avctx->skip_loop_filter >= AVDISCARD_NONKEY &&
          h->nal_unit_type != H264_NAL_IDR_SLICE) ||
         (h->avctx->skip_loop_filter >= AVDISCARD_NONINTRA &&
@@ -2135,6 +2168,7 @@ int ff_h264_queue_decode_slice(H264Context *h, const H2645NAL *nal)
             (h->avctx->skip_frame >= AVDISCARD_NONREF && !h->nal_ref_idc) ||
             (h->avctx->skip_frame >= AVDISCARD_BIDIR  && sl->slice_type_nos == AV_PICTURE_TYPE_B) ||
             (h->avctx->skip_frame >= AVDISCARD_NONINTRA && sl->slice_type_nos != AV_PICTURE_TYPE_I) ||
+            (h->avctx->lowres && sl->slice_type_nos != AV_PICTURE_TYPE_I) ||
             (h->avctx->skip_frame >= AVDISCARD_NONKEY && h->nal_unit_type != H264_NAL_IDR_SLICE && h->sei.recovery_point.recovery_frame_cnt < 0) ||
             h->avctx->skip_frame >= AVDISCARD_ALL) {
             return 0;
@@ -2180,6 +2214,14 @@ int ff_h264_queue_decode_slice(H264Context *h, const H2645NAL *nal)
     if (ret < 0)
         return ret;
 
+    /* Inter slices cannot be predicted from downscaled references. If the
+     * second field of a frame is skipped, have the first one fill it in. */
+    if (h->avctx->lowres && sl->slice_type_nos != AV_PICTURE_TYPE_I) {
+        if (FIELD_PICTURE(h) && !h->first_field)
+            h->cur_pic_ptr->field_poc[h->picture_structure == PICT_BOTTOM_FIELD] = INT_MAX;
+        return 0;
+    }
+
     h->nb_slice_ctx_queued++;
 
     return 0;
@@ -2510,11 +2552,15 @@ static void predict_field_decoding_flag(const H264Context *h, H264SliceContext *
 }
 
 /**
- * Draw edges and report progress for the last MB row.
+ * Compute the lines of the picture that are final once the MB row mb_y
+ * has been decoded and filtered.
+ *
+ * @return 0 if there are no such lines
  */
-static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
+static int finished_row_lines(const H264Context *h, const H264SliceContext *sl,
+                              int mb_y, int *top_out, int *height_out)
 {
-    int top            = 16 * (sl->mb_y      >> FIELD_PICTURE(h));
+    int top            = 16 * (mb_y         >> FIELD_PICTURE(h));
     int pic_height     = 16 *  h->mb_height >> FIELD_PICTURE(h);
     int height         =  16      << FRAME_MBAFF(h);
     int deblock_border = (16 + 4) << FRAME_MBAFF(h);
@@ -2526,7 +2572,7 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
     }
 
     if (top >= pic_height || (top + height) < 0)
-        return;
+        return 0;
 
     height = FFMIN(height, pic_height - top);
     if (top < 0) {
@@ -2534,9 +2580,27 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
         top    = 0;
     }
 
+    *top_out    = top;
+    *height_out = height;
+    return 1;
+}
+
+/**
+ * Draw edges and report progress for the last MB row.
+ */
+static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
+{
+    int top, height;
+
+    if (!finished_row_lines(h, sl, sl->mb_y, &top, &height))
+        return;
+
     ff_h264_draw_horiz_band(h, sl, top, height);
 
-    if (h->droppable || h->er.error_occurred)
+    /* When several slices are decoded in parallel, the rows above this one
+     * may still be in progress; ff_h264_execute_decode_slices() reports
+     * progress once all of them are done. */
+    if (h->droppable || h->er.error_occurred || h->nb_slice_ctx_queued > 1)
         return;
 
     ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
@@ -2563,8 +2627,8 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     int orig_deblock = sl->deblocking_filter;
     int ret;
 
-    sl->linesize   = h->cur_pic_ptr->f->linesize[0];
-    sl->uvlinesize = h->cur_pic_ptr->f->linesize[1];
+    sl->linesize   = h->avctx->lowres ? h->lowres_recon->linesize[0] : h->cur_pic_ptr->f->linesize[0];
+    sl->uvlinesize = h->avctx->lowres ? h->lowres_recon->linesize[1] : h->cur_pic_ptr->f->linesize[1];
 
     ret = alloc_scratch_buffers(sl, sl->linesize);
     if (ret < 0)
@@ -2770,8 +2834,9 @@ finish:
 int ff_h264_execute_decode_slices(H264Context *h)
 {
     AVCodecContext *const avctx = h->avctx;
-    H264SliceContext *sl;
+    H264SliceContext *sl, *last_sl;
     int context_count = h->nb_slice_ctx_queued;
+    int last_mb_y;
     int ret = 0;
     int i, j;
 
@@ -2815,6 +2880,16 @@ int ff_h264_execute_decode_slices(H264Context *h)
         avctx->execute(avctx, decode_slice, h->slice_ctx,
                        NULL, context_count, sizeof(h->slice_ctx[0]));
 
+        /* the slice furthest down the picture ends the decoded area */
+        last_sl = &h->slice_ctx[0];
+        for (i = 1; i < context_count; i++) {
+            sl = &h->slice_ctx[i];
+            if (sl->resync_mb_y * h->mb_width + sl->resync_mb_x >
+                last_sl->resync_mb_y * h->mb_width + last_sl->resync_mb_x)
+                last_sl = sl;
+        }
+        last_mb_y = last_sl->mb_y;
+
         /* pull back stuff from slices to master context */
         sl                   = &h->slice_ctx[context_count - 1];
         h->mb_y              = sl->mb_y;
@@ -2836,6 +2911,20 @@ int ff_h264_execute_decode_slices(H264Context *h)
                 }
             }
         }
+
+        /* with slice threads inside frame threads, the rows finished by
+         * this batch of slices become visible to other frame threads only
+         * now that all of them are decoded and filtered */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            !h->droppable && !h->er.error_occurred) {
+            int top, height;
+
+            if (finished_row_lines(h, last_sl,
+                                   last_mb_y - 1 - FIELD_OR_MBAFF_PICTURE(h),
+                                   &top, &height))
+                ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
+                                          h->picture_structure == PICT_BOTTOM_FIELD);
+        }
     }
 
 finish:
@@ -122,6 +122,8 @@ void ff_h264_draw_horiz_band(const H264Context *h, H264SliceContext *sl,
         y      <<= 1;
     }
 
+    y      >>= avctx->lowres;
+    height >>= avctx->lowres;
     height = FFMIN(height, avctx->height - y);
 
     desc   = av_pix_fmt_desc_get(avctx->pix_fmt);
@@ -377,6 +379,7 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
 
     h264_free_pic(h, &h->cur_pic);
     h264_free_pic(h, &h->last_pic_for_ec);
+    av_frame_free(&h->lowres_recon);
 
     return 0;
 }
@@ -425,6 +428,11 @@ static av_cold int h264_decode_init(AVCodecContext *avctx)
     if (h->enable_er < 0 && (avctx->active_thread_type & FF_THREAD_SLICE))
         h->enable_er = 0;
 
+    /* Error concealment works on the output picture, which does not hold
+     * the full resolution reconstruction in lowres mode. */
+    if (avctx->lowres)
+        h->enable_er = 0;
+
     if (h->enable_er && (avctx->active_thread_type & FF_THREAD_SLICE)) {
         av_log(avctx, AV_LOG_WARNING,
                "Error resilience with slice threads is enabled. It is unsafe and unsupported and may crash. "
@@ -1060,7 +1068,7 @@ static int h264_decode_frame(AVCodecContext *avctx, AVFrame *pict,
     }
 
     if (!(avctx->flags2 & AV_CODEC_FLAG2_CHUNKS) && (!h->cur_pic_ptr || !h->has_slice)) {
-        if (avctx->skip_frame >= AVDISCARD_NONREF ||
+        if (avctx->skip_frame >= AVDISCARD_NONREF || avctx->lowres ||
             buf_size >= 4 && !memcmp("Q264", buf, 4))
             return buf_size;
         av_log(avctx, AV_LOG_ERROR, "no frame!\n");
@@ -1119,6 +1127,7 @@ const FFCodec ff_h264_decoder = {
     .p.capabilities        = AV_CODEC_CAP_DR1 |
                              AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
                              AV_CODEC_CAP_FRAME_THREADS,
+    .p.max_lowres          = 3,
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_H264_DXVA2_HWACCEL
                                HWACCEL_DXVA2(h264),
@@ -1150,6 +1159,7 @@ const FFCodec ff_h264_decoder = {
                                NULL
                            },
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
+                             FF_CODEC_CAP_FRAME_SLICE_THREADS |
                              FF_CODEC_CAP_INIT_CLEANUP,
     .flush                 = h264_decode_flush,
     UPDATE_THREAD_CONTEXT(ff_h264_update_thread_context),
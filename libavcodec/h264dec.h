@@ -347,6 +347,11 @@ typedef struct H264Context {
     H264Picture *cur_pic_ptr;
     H264Picture cur_pic;
     H264Picture last_pic_for_ec;
+    /**
+     * Full resolution reconstruction target when lowres decoding is used;
+     * the output picture only receives the downscaled MBs.
+     */
+    AVFrame *lowres_recon;
 
     H264SliceContext *slice_ctx;
     int            nb_slice_ctx;
@@ -1003,11 +1003,11 @@ void ff_hevc_hls_residual_coding(HEVCLocalContext *lc, const HEVCPPS *pps,
 
     const uint8_t *scan_x_cg, *scan_y_cg, *scan_x_off, *scan_y_off;
 
-    ptrdiff_t stride = s->cur_frame->f->linesize[c_idx];
+    ptrdiff_t stride = ff_hevc_recon_frame(s)->linesize[c_idx];
     int hshift = sps->hshift[c_idx];
     int vshift = sps->vshift[c_idx];
-    uint8_t *dst = &s->cur_frame->f->data[c_idx][(y0 >> vshift) * stride +
-                                          ((x0 >> hshift) << sps->pixel_shift)];
+    uint8_t *dst = &ff_hevc_recon_frame(s)->data[c_idx][(y0 >> vshift) * stride +
+                                                        ((x0 >> hshift) << sps->pixel_shift)];
     int16_t *coeffs = (int16_t*)(c_idx ? lc->edge_emu_buffer2 : lc->edge_emu_buffer);
     uint8_t significant_coeff_group_flag[8][8] = {{0}};
     int explicit_rdpcm_flag = 0;
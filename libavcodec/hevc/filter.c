@@ -922,3 +922,26 @@ void ff_hevc_hls_filters(HEVCLocalContext *lc, const HEVCLayerContext *l,
     if (x_ctb && y_end)
         ff_hevc_hls_filter(lc, l, pps, x_ctb - ctb_size, y_ctb, ctb_size);
 }
+
+void ff_hevc_deblock_ctb_row(const HEVCContext *s, const HEVCLayerContext *l,
+                             const HEVCPPS *pps, int ry)
+{
+    const HEVCSPS *const sps = pps->sps;
+    const int ctb_size = 1 << sps->log2_ctb_size;
+
+    for (int x = 0; x < sps->width; x += ctb_size)
+        deblocking_filter_CTB(s, l, pps, sps, x, ry << sps->log2_ctb_size);
+}
+
+void ff_hevc_sao_ctb_row(HEVCLocalContext *lc, const HEVCContext *s,
+                         const HEVCLayerContext *l, const HEVCPPS *pps, int ry)
+{
+    const HEVCSPS *const sps = pps->sps;
+    const int ctb_size = 1 << sps->log2_ctb_size;
+
+    if (!sps->sao_enabled)
+        return;
+
+    for (int x = 0; x < sps->width; x += ctb_size)
+        sao_filter_CTB(lc, l, s, pps, sps, x, ry << sps->log2_ctb_size);
+}
@@ -45,6 +45,7 @@
 #include "codec_internal.h"
 #include "decode.h"
 #include "golomb.h"
+#include "h2645_lowres.h"
 #include "h274.h"
 #include "hevc.h"
 #include "parse.h"
@@ -333,13 +334,15 @@ static void export_stream_params(HEVCContext *s, const HEVCSPS *sps)
     AVCodecContext *avctx = s->avctx;
     const HEVCVPS    *vps = sps->vps;
     const HEVCWindow *ow = &sps->output_window;
+    int width  = sps->width  - ow->left_offset - ow->right_offset;
+    int height = sps->height - ow->top_offset  - ow->bottom_offset;
     unsigned int num = 0, den = 0;
 
     avctx->pix_fmt             = sps->pix_fmt;
     avctx->coded_width         = sps->width;
     avctx->coded_height        = sps->height;
-    avctx->width               = sps->width  - ow->left_offset - ow->right_offset;
-    avctx->height              = sps->height - ow->top_offset  - ow->bottom_offset;
+    avctx->width               = AV_CEIL_RSHIFT(width,  avctx->lowres);
+    avctx->height              = AV_CEIL_RSHIFT(height, avctx->lowres);
     avctx->has_b_frames        = sps->temporal_layer[sps->max_sub_layers - 1].num_reorder_pics;
     avctx->profile             = sps->ptl.general_ptl.profile_idc;
     avctx->level               = sps->ptl.general_ptl.level_idc;
@@ -712,6 +715,10 @@ static enum AVPixelFormat get_format(HEVCContext *s, const HEVCSPS *sps)
         break;
     }
 
+    // hwaccels cannot output lowres pictures
+    if (s->avctx->lowres)
+        fmt = pix_fmts;
+
     if (alpha_fmt != AV_PIX_FMT_NONE)
         *fmt++ = alpha_fmt;
     *fmt++ = sps->pix_fmt;
@@ -1408,15 +1415,15 @@ static int hls_transform_unit(HEVCLocalContext *lc,
                                                 log2_trafo_size_c, scan_idx_c, 1);
                 else
                     if (lc->tu.cross_pf) {
-                        ptrdiff_t stride = s->cur_frame->f->linesize[1];
+                        ptrdiff_t stride = ff_hevc_recon_frame(s)->linesize[1];
                         int hshift = sps->hshift[1];
                         int vshift = sps->vshift[1];
                         const int16_t *coeffs_y = (int16_t*)lc->edge_emu_buffer;
                         int16_t *coeffs   = (int16_t*)lc->edge_emu_buffer2;
                         int size = 1 << log2_trafo_size_c;
 
-                        uint8_t *dst = &s->cur_frame->f->data[1][(y0 >> vshift) * stride +
-                                                              ((x0 >> hshift) << sps->pixel_shift)];
+                        uint8_t *dst = &ff_hevc_recon_frame(s)->data[1][(y0 >> vshift) * stride +
+                                                                        ((x0 >> hshift) << sps->pixel_shift)];
                         for (i = 0; i < (size * size); i++) {
                             coeffs[i] = ((lc->tu.res_scale_val * coeffs_y[i]) >> 3);
                         }
@@ -1438,15 +1445,15 @@ static int hls_transform_unit(HEVCLocalContext *lc,
                                                 log2_trafo_size_c, scan_idx_c, 2);
                 else
                     if (lc->tu.cross_pf) {
-                        ptrdiff_t stride = s->cur_frame->f->linesize[2];
+                        ptrdiff_t stride = ff_hevc_recon_frame(s)->linesize[2];
                         int hshift = sps->hshift[2];
                         int vshift = sps->vshift[2];
                         const int16_t *coeffs_y = (int16_t*)lc->edge_emu_buffer;
                         int16_t *coeffs   = (int16_t*)lc->edge_emu_buffer2;
                         int size = 1 << log2_trafo_size_c;
 
-                        uint8_t *dst = &s->cur_frame->f->data[2][(y0 >> vshift) * stride +
-                                                          ((x0 >> hshift) << sps->pixel_shift)];
+                        uint8_t *dst = &ff_hevc_recon_frame(s)->data[2][(y0 >> vshift) * stride +
+                                                                        ((x0 >> hshift) << sps->pixel_shift)];
                         for (i = 0; i < (size * size); i++) {
                             coeffs[i] = ((lc->tu.res_scale_val * coeffs_y[i]) >> 3);
                         }
@@ -1661,12 +1668,12 @@ static int hls_pcm_sample(HEVCLocalContext *lc, const HEVCLayerContext *l,
     const HEVCSPS   *const sps = pps->sps;
     GetBitContext gb;
     int cb_size   = 1 << log2_cb_size;
-    ptrdiff_t stride0 = s->cur_frame->f->linesize[0];
-    ptrdiff_t stride1 = s->cur_frame->f->linesize[1];
-    ptrdiff_t stride2 = s->cur_frame->f->linesize[2];
-    uint8_t *dst0 = &s->cur_frame->f->data[0][y0 * stride0 + (x0 << sps->pixel_shift)];
-    uint8_t *dst1 = &s->cur_frame->f->data[1][(y0 >> sps->vshift[1]) * stride1 + ((x0 >> sps->hshift[1]) << sps->pixel_shift)];
-    uint8_t *dst2 = &s->cur_frame->f->data[2][(y0 >> sps->vshift[2]) * stride2 + ((x0 >> sps->hshift[2]) << sps->pixel_shift)];
+    ptrdiff_t stride0 = ff_hevc_recon_frame(s)->linesize[0];
+    ptrdiff_t stride1 = ff_hevc_recon_frame(s)->linesize[1];
+    ptrdiff_t stride2 = ff_hevc_recon_frame(s)->linesize[2];
+    uint8_t *dst0 = &ff_hevc_recon_frame(s)->data[0][y0 * stride0 + (x0 << sps->pixel_shift)];
+    uint8_t *dst1 = &ff_hevc_recon_frame(s)->data[1][(y0 >> sps->vshift[1]) * stride1 + ((x0 >> sps->hshift[1]) << sps->pixel_shift)];
+    uint8_t *dst2 = &ff_hevc_recon_frame(s)->data[2][(y0 >> sps->vshift[2]) * stride2 + ((x0 >> sps->hshift[2]) << sps->pixel_shift)];
 
     int length         = cb_size * cb_size * sps->pcm.bit_depth +
                          (((cb_size >> sps->hshift[1]) * (cb_size >> sps->vshift[1])) +
@@ -2037,7 +2044,7 @@ static void chroma_mc_bi(HEVCLocalContext *lc,
 static void hevc_await_progress(const HEVCContext *s, const HEVCFrame *ref,
                                 const Mv *mv, int y0, int height)
 {
-    if (s->avctx->active_thread_type == FF_THREAD_FRAME ) {
+    if (s->avctx->active_thread_type & FF_THREAD_FRAME) {
         int y = FFMAX(0, (mv->y >> 2) + y0 + height + 9);
 
         ff_progress_frame_await(&ref->tf, y);
@@ -2747,6 +2754,35 @@ static void hls_decode_neighbour(HEVCLocalContext *lc,
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= sps->ctb_width) && (pps->tile_id[ctb_addr_ts] == pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - sps->ctb_width]]));
 }
 
+/**
+ * Box-filter a reconstructed CTB from s->lowres_recon into the reduced
+ * resolution output frame.
+ */
+static void hls_output_ctb_lowres(const HEVCContext *s, const HEVCSPS *sps,
+                                  int x_ctb, int y_ctb, int ctb_size)
+{
+    const AVFrame *src = s->lowres_recon;
+    const AVFrame *dst = s->cur_frame->f;
+    const int lowres   = s->avctx->lowres;
+    const int width    = FFMIN(ctb_size, sps->width  - x_ctb);
+    const int height   = FFMIN(ctb_size, sps->height - y_ctb);
+
+    for (int c_idx = 0; c_idx < (sps->chroma_format_idc ? 3 : 1); c_idx++) {
+        const int x = x_ctb >> sps->hshift[c_idx];
+        const int y = y_ctb >> sps->vshift[c_idx];
+
+        ff_h2645_lowres_downscale(dst->data[c_idx] + (y >> lowres) * dst->linesize[c_idx] +
+                                  ((x >> lowres) << sps->pixel_shift),
+                                  dst->linesize[c_idx],
+                                  src->data[c_idx] + y * src->linesize[c_idx] +
+                                  (x << sps->pixel_shift),
+                                  src->linesize[c_idx],
+                                  AV_CEIL_RSHIFT(width,  sps->hshift[c_idx]),
+                                  AV_CEIL_RSHIFT(height, sps->vshift[c_idx]),
+                                  lowres, sps->pixel_shift);
+    }
+}
+
 static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
 {
     HEVCLocalContext *const lc = &s->local_ctx[0];
@@ -2791,11 +2827,17 @@ static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
 
         ctb_addr_ts++;
         ff_hevc_save_states(lc, pps, ctb_addr_ts);
-        ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
+        if (s->avctx->lowres)
+            hls_output_ctb_lowres(s, sps, x_ctb, y_ctb, ctb_size);
+        else if (s->pipeline_active) {
+            if (x_ctb + ctb_size >= sps->width)
+                ff_hevc_pipeline_row_done(s->pipeline, y_ctb >> sps->log2_ctb_size);
+        } else
+            ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
     }
 
     if (x_ctb + ctb_size >= sps->width &&
-        y_ctb + ctb_size >= sps->height)
+        y_ctb + ctb_size >= sps->height && !s->avctx->lowres && !s->pipeline_active)
         ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
 
     return ctb_addr_ts;
@@ -2864,7 +2906,10 @@ static int hls_decode_entry_wpp(AVCodecContext *avctx, void *hevc_lclist,
 
         ff_hevc_save_states(lc, pps, ctb_addr_ts);
         ff_thread_progress_report(&s->wpp_progress[ctb_row], ++progress);
-        ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
+        if (s->avctx->lowres)
+            hls_output_ctb_lowres(s, sps, x_ctb, y_ctb, ctb_size);
+        else
+            ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
 
         if (!more_data && (x_ctb+ctb_size) < sps->width && ctb_row != s->sh.num_entry_point_offsets) {
             /* Casting const away here is safe, because it is an atomic operation. */
@@ -2874,7 +2919,8 @@ static int hls_decode_entry_wpp(AVCodecContext *avctx, void *hevc_lclist,
         }
 
         if ((x_ctb+ctb_size) >= sps->width && (y_ctb+ctb_size) >= sps->height ) {
-            ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
+            if (!s->avctx->lowres)
+                ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
             ff_thread_progress_report(&s->wpp_progress[ctb_row], INT_MAX);
             return ctb_addr_ts;
         }
@@ -3070,7 +3116,7 @@ static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
     s->local_ctx[0].tu.cu_qp_offset_cb = 0;
     s->local_ctx[0].tu.cu_qp_offset_cr = 0;
 
-    if (s->avctx->active_thread_type == FF_THREAD_SLICE  &&
+    if (s->avctx->active_thread_type & FF_THREAD_SLICE   &&
         s->sh.num_entry_point_offsets > 0                &&
         pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
         return hls_slice_data_wpp(s, nal);
@@ -3335,6 +3381,13 @@ static int hevc_frame_start(HEVCContext *s, HEVCLayerContext *l,
     if (ret < 0)
         goto fail;
 
+    if (s->avctx->lowres) {
+        ret = ff_h2645_lowres_alloc_recon(&s->lowres_recon, s->cur_frame->f->format,
+                                          sps->width, sps->height);
+        if (ret < 0)
+            goto fail;
+    }
+
     ret = ff_hevc_frame_rps(s, l);
     if (ret < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "Error constructing the frame RPS.\n");
@@ -3404,6 +3457,16 @@ static int hevc_frame_start(HEVCContext *s, HEVCLayerContext *l,
     if (nal_idx >= s->finish_setup_nal_idx)
         ff_thread_finish_setup(s->avctx);
 
+    // the pipeline filters whole CTB rows behind the raster scan order decoding
+    if (s->pipeline && !s->avctx->hwaccel && !s->avctx->lowres &&
+        s->avctx->skip_loop_filter < AVDISCARD_NONREF &&
+        pps->num_tile_columns == 1 && !pps->pps_curr_pic_ref_enabled_flag &&
+        !(s->avctx->active_thread_type & FF_THREAD_SLICE &&
+          pps->entropy_coding_sync_enabled_flag)) {
+        ff_hevc_pipeline_start(s->pipeline, s, l);
+        s->pipeline_active = 1;
+    }
+
     return 0;
 
 fail:
@@ -3515,7 +3578,7 @@ static int hevc_frame_end(HEVCContext *s, HEVCLayerContext *l)
         }
     } else {
         if (s->avctx->err_recognition & AV_EF_CRCCHECK &&
-            s->sei.picture_hash.is_md5) {
+            s->sei.picture_hash.is_md5 && !s->avctx->lowres) {
             ret = verify_md5(s, out->f);
             if (ret < 0 && s->avctx->err_recognition & AV_EF_EXPLODE)
                 return ret;
@@ -3529,6 +3592,14 @@ static int hevc_frame_end(HEVCContext *s, HEVCLayerContext *l)
     return 0;
 }
 
+static void pipeline_finish(HEVCContext *s)
+{
+    if (s->pipeline_active) {
+        ff_hevc_pipeline_finish(s->pipeline);
+        s->pipeline_active = 0;
+    }
+}
+
 static int decode_slice(HEVCContext *s, unsigned nal_idx, GetBitContext *gb)
 {
     const int layer_idx = s->vps ? s->vps->layer_idx[s->nuh_layer_id] : 0;
@@ -3553,6 +3624,8 @@ static int decode_slice(HEVCContext *s, unsigned nal_idx, GetBitContext *gb)
 
     if ((s->avctx->skip_frame >= AVDISCARD_BIDIR && s->sh.slice_type == HEVC_SLICE_B) ||
         (s->avctx->skip_frame >= AVDISCARD_NONINTRA && s->sh.slice_type != HEVC_SLICE_I) ||
+        // inter slices cannot be predicted from lowres references
+        (s->avctx->lowres && s->sh.slice_type != HEVC_SLICE_I) ||
         (s->avctx->skip_frame >= AVDISCARD_NONKEY && !IS_IRAP(s)) ||
         ((s->nal_unit_type == HEVC_NAL_RASL_R || s->nal_unit_type == HEVC_NAL_RASL_N) &&
          s->no_rasl_output_flag)) {
@@ -3561,9 +3634,11 @@ static int decode_slice(HEVCContext *s, unsigned nal_idx, GetBitContext *gb)
 
     // switching to a new layer, mark previous layer's frame (if any) as done
     if (s->cur_layer != layer_idx &&
-        s->layers[s->cur_layer].cur_frame &&
-        s->avctx->active_thread_type == FF_THREAD_FRAME)
-        ff_progress_frame_report(&s->layers[s->cur_layer].cur_frame->tf, INT_MAX);
+        s->layers[s->cur_layer].cur_frame) {
+        pipeline_finish(s);
+        if (s->avctx->active_thread_type & FF_THREAD_FRAME)
+            ff_progress_frame_report(&s->layers[s->cur_layer].cur_frame->tf, INT_MAX);
+    }
 
     s->cur_layer = layer_idx;
     l = &s->layers[s->cur_layer];
@@ -3781,6 +3856,8 @@ static int decode_nal_units(HEVCContext *s, const uint8_t *buf, int length)
     }
 
 fail:
+    pipeline_finish(s);
+
     for (int i = 0; i < FF_ARRAY_ELEMS(s->layers); i++) {
         HEVCLayerContext *l = &s->layers[i];
 
@@ -3790,7 +3867,7 @@ fail:
         if (ret >= 0)
             ret = hevc_frame_end(s, l);
 
-        if (s->avctx->active_thread_type == FF_THREAD_FRAME)
+        if (s->avctx->active_thread_type & FF_THREAD_FRAME)
             ff_progress_frame_report(&l->cur_frame->tf, INT_MAX);
     }
 
@@ -3938,6 +4015,9 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     av_buffer_unref(&s->rpu_buf);
 
     av_freep(&s->md5_ctx);
+    av_frame_free(&s->lowres_recon);
+
+    ff_hevc_pipeline_free(&s->pipeline);
 
     av_container_fifo_free(&s->output_fifo);
 
@@ -4000,6 +4080,12 @@ static av_cold int hevc_init_context(AVCodecContext *avctx)
     if (!s->md5_ctx)
         return AVERROR(ENOMEM);
 
+    if (s->filter_pipeline) {
+        int ret = ff_hevc_pipeline_alloc(&s->pipeline);
+        if (ret < 0)
+            return ret;
+    }
+
     ff_bswapdsp_init(&s->bdsp);
 
     s->dovi_ctx.logctx = avctx;
@@ -4210,6 +4296,8 @@ static const AVOption options[] = {
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
     { "strict-displaywin", "strictly apply default display window size", OFFSET(apply_defdispwin),
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "filter_pipeline", "Run the in-loop filters on separate threads, pipelined by CTB row", OFFSET(filter_pipeline),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
     { "view_ids", "Array of view IDs that should be decoded and output; a single -1 to decode all views",
         .offset = OFFSET(view_ids), .type = AV_OPT_TYPE_INT | AV_OPT_TYPE_FLAG_ARRAY,
         .min = -1, .max = INT_MAX, .flags = PAR },
@@ -4247,8 +4335,10 @@ const FFCodec ff_hevc_decoder = {
     UPDATE_THREAD_CONTEXT(hevc_update_thread_context),
     .p.capabilities        = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
+    .p.max_lowres          = 3,
     .caps_internal         = FF_CODEC_CAP_EXPORTS_CROPPING |
                              FF_CODEC_CAP_USES_PROGRESSFRAMES |
+                             FF_CODEC_CAP_FRAME_SLICE_THREADS |
                              FF_CODEC_CAP_INIT_CLEANUP,
     .p.profiles            = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
@@ -487,6 +487,8 @@ typedef struct HEVCLayerContext {
     struct AVRefStructPool *rpl_tab_pool;
 } HEVCLayerContext;
 
+typedef struct HEVCPipeline HEVCPipeline;
+
 typedef struct HEVCContext {
     const AVClass *c;  // needed by private avoptions
     AVCodecContext *avctx;
@@ -521,6 +523,8 @@ typedef struct HEVCContext {
     int temporal_id;  ///< temporal_id_plus1 - 1
     HEVCFrame *cur_frame;
     HEVCFrame *collocated_ref;
+    /// full resolution reconstruction target used with lowres decoding
+    AVFrame *lowres_recon;
     int poc;
     int poc_tid0;
     int slice_idx; ///< number of the slice being currently decoded
@@ -548,6 +552,10 @@ typedef struct HEVCContext {
 
     atomic_int wpp_err;
 
+    HEVCPipeline *pipeline;
+    // the in-loop filters of the current picture run on the pipeline
+    int pipeline_active;
+
     const uint8_t *data;
 
     H2645Packet pkt;
@@ -560,6 +568,7 @@ typedef struct HEVCContext {
     int is_nalff;           ///< this flag is != 0 if bitstream is encapsulated
                             ///< as a format defined in 14496-15
     int apply_defdispwin;
+    int filter_pipeline;
 
     // multi-layer AVOptions
     int         *view_ids;
@@ -650,6 +659,16 @@ int ff_hevc_frame_nb_refs(const SliceHeader *sh, const HEVCPPS *pps,
 
 int ff_hevc_set_new_ref(HEVCContext *s, HEVCLayerContext *l, int poc);
 
+/**
+ * Get the frame the current picture is reconstructed into. This is the
+ * output frame, except in lowres mode, where CTBs are reconstructed at full
+ * resolution and downscaled into the output frame once complete.
+ */
+static av_always_inline AVFrame *ff_hevc_recon_frame(const HEVCContext *s)
+{
+    return s->avctx->lowres ? s->lowres_recon : s->cur_frame->f;
+}
+
 static av_always_inline int ff_hevc_nal_is_nonref(enum HEVCNALUnitType type)
 {
     switch (type) {
@@ -700,6 +719,10 @@ void ff_hevc_hls_filter(HEVCLocalContext *lc, const HEVCLayerContext *l,
 void ff_hevc_hls_filters(HEVCLocalContext *lc, const HEVCLayerContext *l,
                          const HEVCPPS *pps,
                          int x_ctb, int y_ctb, int ctb_size);
+void ff_hevc_deblock_ctb_row(const HEVCContext *s, const HEVCLayerContext *l,
+                             const HEVCPPS *pps, int ry);
+void ff_hevc_sao_ctb_row(HEVCLocalContext *lc, const HEVCContext *s,
+                         const HEVCLayerContext *l, const HEVCPPS *pps, int ry);
 void ff_hevc_set_qPy(HEVCLocalContext *lc,
                      const HEVCLayerContext *l, const HEVCPPS *pps,
                      int xBase, int yBase, int log2_cb_size);
@@ -719,6 +742,22 @@ void ff_hevc_hls_mvd_coding(HEVCLocalContext *lc, int x0, int y0, int log2_cb_si
 
 int ff_hevc_is_alpha_video(const HEVCContext *s);
 
+int  ff_hevc_pipeline_alloc(HEVCPipeline **pp);
+void ff_hevc_pipeline_free(HEVCPipeline **pp);
+/**
+ * Start filtering the picture currently being decoded, s->cur_frame in layer l.
+ */
+void ff_hevc_pipeline_start(HEVCPipeline *p, const HEVCContext *s,
+                            const HEVCLayerContext *l);
+/**
+ * Signal that CTB row ry of the current picture is fully reconstructed.
+ */
+void ff_hevc_pipeline_row_done(HEVCPipeline *p, int ry);
+/**
+ * Filter the remaining reconstructed rows and wait until they are done.
+ */
+void ff_hevc_pipeline_finish(HEVCPipeline *p);
+
 extern const uint8_t ff_hevc_qpel_extra_before[4];
 extern const uint8_t ff_hevc_qpel_extra_after[4];
 extern const uint8_t ff_hevc_qpel_extra[4];
@@ -0,0 +1,235 @@
+/*
+ * HEVC in-loop filter pipeline
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "libavcodec/executor.h"
+#include "libavcodec/progressframe.h"
+
+#include "hevcdec.h"
+
+/*
+ * Deblocking and SAO run on executor threads one CTB row at a time, behind
+ * the parsing and reconstruction done by the decoding thread. Each stage is
+ * processed in row order by a single task, so a stage never runs two rows at
+ * once; what differs between the stages is only how far they lag behind.
+ */
+enum PipelineStage {
+    STAGE_DEBLOCK,
+    STAGE_SAO,
+    STAGE_NB,
+};
+
+typedef struct PipelineTask {
+    FFTask task;
+    enum PipelineStage stage;
+    int ry;
+} PipelineTask;
+
+struct HEVCPipeline {
+    FFExecutor *executor;
+
+    AVMutex lock;
+    AVCond  cond;
+
+    PipelineTask tasks[STAGE_NB];
+
+    // the picture being filtered, constant between start and finish
+    const HEVCContext      *s;
+    const HEVCLayerContext *l;
+    const HEVCPPS          *pps;
+
+    // the following fields are protected by lock
+    int nb_rows;
+    int recon_rows;         ///< number of fully reconstructed CTB rows
+    int rows[STAGE_NB];     ///< number of CTB rows done by each stage
+    int busy[STAGE_NB];
+};
+
+/**
+ * Mark the stages that can process their next row as busy.
+ * Must be called with the lock held.
+ *
+ * @return a mask of the stages whose task must be submitted
+ */
+static unsigned pipeline_ready(HEVCPipeline *p)
+{
+    unsigned ready = 0;
+
+    for (int stage = 0; stage < STAGE_NB; stage++) {
+        const int row  = p->rows[stage];
+        const int prev = stage ? p->rows[stage - 1] : p->recon_rows;
+
+        if (p->busy[stage] || row >= p->nb_rows)
+            continue;
+
+        /* Deblocking a row modifies its last lines, which intra prediction
+         * of the next row still reads unfiltered; SAO of a row reads the
+         * first line of the next one, which the deblocking of that next row
+         * finalizes. */
+        if (prev >= row + 2 || prev == p->nb_rows) {
+            p->busy[stage]     = 1;
+            p->tasks[stage].ry = row;
+            ready |= 1 << stage;
+        }
+    }
+
+    return ready;
+}
+
+static void pipeline_submit(HEVCPipeline *p, unsigned ready)
+{
+    for (int stage = 0; stage < STAGE_NB; stage++)
+        if (ready & (1 << stage))
+            ff_executor_execute(p->executor, &p->tasks[stage].task);
+}
+
+static int pipeline_task_run(FFTask *_t, void *local_context, void *user_data)
+{
+    PipelineTask *t      = (PipelineTask *)_t;
+    HEVCPipeline *p      = user_data;
+    HEVCLocalContext *lc = local_context;
+    const HEVCContext *s = p->s;
+    const enum PipelineStage stage = t->stage;
+    const int ry         = t->ry;
+    unsigned ready;
+
+    if (stage == STAGE_DEBLOCK) {
+        ff_hevc_deblock_ctb_row(s, p->l, p->pps, ry);
+    } else {
+        const HEVCSPS *const sps = p->pps->sps;
+
+        ff_hevc_sao_ctb_row(lc, s, p->l, p->pps, ry);
+        if (s->avctx->active_thread_type & FF_THREAD_FRAME)
+            ff_progress_frame_report(&s->cur_frame->tf,
+                                     FFMIN((ry + 1) << sps->log2_ctb_size, sps->height));
+    }
+
+    ff_mutex_lock(&p->lock);
+    p->rows[stage]++;
+    p->busy[stage] = 0;
+    ready = pipeline_ready(p);
+    if (p->rows[STAGE_SAO] == p->nb_rows)
+        ff_cond_broadcast(&p->cond);
+    ff_mutex_unlock(&p->lock);
+
+    pipeline_submit(p, ready);
+
+    return 0;
+}
+
+av_cold int ff_hevc_pipeline_alloc(HEVCPipeline **pp)
+{
+    HEVCPipeline *p;
+    FFTaskCallbacks callbacks = {
+        NULL,
+        sizeof(HEVCLocalContext),
+        1,
+        pipeline_task_run,
+    };
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+
+    for (int stage = 0; stage < STAGE_NB; stage++)
+        p->tasks[stage].stage = stage;
+
+    if ((ret = ff_cond_init(&p->cond, NULL))) {
+        av_free(p);
+        return AVERROR(ret);
+    }
+    if ((ret = ff_mutex_init(&p->lock, NULL))) {
+        ff_cond_destroy(&p->cond);
+        av_free(p);
+        return AVERROR(ret);
+    }
+
+    callbacks.user_data = p;
+    p->executor = ff_executor_alloc(&callbacks, STAGE_NB);
+    if (!p->executor) {
+        ff_hevc_pipeline_free(&p);
+        return AVERROR(ENOMEM);
+    }
+
+    *pp = p;
+    return 0;
+}
+
+av_cold void ff_hevc_pipeline_free(HEVCPipeline **pp)
+{
+    HEVCPipeline *p = *pp;
+
+    if (!p)
+        return;
+
+    ff_executor_free(&p->executor);
+    ff_mutex_destroy(&p->lock);
+    ff_cond_destroy(&p->cond);
+    av_freep(pp);
+}
+
+void ff_hevc_pipeline_start(HEVCPipeline *p, const HEVCContext *s,
+                            const HEVCLayerContext *l)
+{
+    ff_mutex_lock(&p->lock);
+    p->s          = s;
+    p->l          = l;
+    p->pps        = s->pps;
+    p->nb_rows    = s->pps->sps->ctb_height;
+    p->recon_rows = 0;
+    for (int stage = 0; stage < STAGE_NB; stage++) {
+        p->rows[stage] = 0;
+        p->busy[stage] = 0;
+    }
+    ff_mutex_unlock(&p->lock);
+}
+
+void ff_hevc_pipeline_row_done(HEVCPipeline *p, int ry)
+{
+    unsigned ready;
+
+    ff_mutex_lock(&p->lock);
+    p->recon_rows = FFMAX(p->recon_rows, ry + 1);
+    ready = pipeline_ready(p);
+    ff_mutex_unlock(&p->lock);
+
+    pipeline_submit(p, ready);
+}
+
+void ff_hevc_pipeline_finish(HEVCPipeline *p)
+{
+    unsigned ready;
+
+    ff_mutex_lock(&p->lock);
+    // rows past the last reconstructed one were not decoded, leave them as is
+    p->nb_rows = p->recon_rows;
+    ready = pipeline_ready(p);
+    ff_mutex_unlock(&p->lock);
+
+    pipeline_submit(p, ready);
+
+    ff_mutex_lock(&p->lock);
+    while (p->rows[STAGE_SAO] < p->nb_rows)
+        ff_cond_wait(&p->cond, &p->lock);
+    ff_mutex_unlock(&p->lock);
+}
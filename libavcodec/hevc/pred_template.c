@@ -90,8 +90,8 @@ do {                                  \
 
     int cur_tb_addr = MIN_TB_ADDR_ZS(x_tb, y_tb);
 
-    ptrdiff_t stride = s->cur_frame->f->linesize[c_idx] / sizeof(pixel);
-    pixel *src = (pixel*)s->cur_frame->f->data[c_idx] + x + y * stride;
+    ptrdiff_t stride = ff_hevc_recon_frame(s)->linesize[c_idx] / sizeof(pixel);
+    pixel *src = (pixel*)ff_hevc_recon_frame(s)->data[c_idx] + x + y * stride;
 
     int min_pu_width = sps->min_pu_width;
 
@@ -244,10 +244,24 @@ int ff_hevc_set_new_ref(HEVCContext *s, HEVCLayerContext *l, int poc)
         ref->flags = HEVC_FRAME_FLAG_SHORT_REF;
 
     ref->poc      = poc;
-    ref->f->crop_left   = l->sps->output_window.left_offset;
-    ref->f->crop_right  = l->sps->output_window.right_offset;
-    ref->f->crop_top    = l->sps->output_window.top_offset;
-    ref->f->crop_bottom = l->sps->output_window.bottom_offset;
+    if (s->avctx->lowres) {
+        const HEVCWindow *ow = &l->sps->output_window;
+        const int lowres = s->avctx->lowres;
+        const int width  = l->sps->width  - ow->left_offset - ow->right_offset;
+        const int height = l->sps->height - ow->top_offset  - ow->bottom_offset;
+
+        ref->f->crop_left   = ow->left_offset >> lowres;
+        ref->f->crop_top    = ow->top_offset  >> lowres;
+        ref->f->crop_right  = AV_CEIL_RSHIFT(l->sps->width,  lowres) - ref->f->crop_left -
+                              AV_CEIL_RSHIFT(width,          lowres);
+        ref->f->crop_bottom = AV_CEIL_RSHIFT(l->sps->height, lowres) - ref->f->crop_top -
+                              AV_CEIL_RSHIFT(height,         lowres);
+    } else {
+        ref->f->crop_left   = l->sps->output_window.left_offset;
+        ref->f->crop_right  = l->sps->output_window.right_offset;
+        ref->f->crop_top    = l->sps->output_window.top_offset;
+        ref->f->crop_bottom = l->sps->output_window.bottom_offset;
+    }
 
     return 0;
 }
@@ -473,13 +487,13 @@ static HEVCFrame *generate_missing_ref(HEVCContext *s, HEVCLayerContext *l, int
         if (!l->sps->pixel_shift) {
             for (i = 0; frame->f->data[i]; i++)
                 memset(frame->f->data[i], 1 << (l->sps->bit_depth - 1),
-                       frame->f->linesize[i] * AV_CEIL_RSHIFT(l->sps->height, l->sps->vshift[i]));
+                       frame->f->linesize[i] * AV_CEIL_RSHIFT(frame->f->height, l->sps->vshift[i]));
         } else {
             for (i = 0; frame->f->data[i]; i++)
-                for (y = 0; y < (l->sps->height >> l->sps->vshift[i]); y++) {
+                for (y = 0; y < (frame->f->height >> l->sps->vshift[i]); y++) {
                     uint8_t *dst = frame->f->data[i] + y * frame->f->linesize[i];
                     AV_WN16(dst, 1 << (l->sps->bit_depth - 1));
-                    av_memcpy_backptr(dst + 2, 2, 2*(l->sps->width >> l->sps->hshift[i]) - 2);
+                    av_memcpy_backptr(dst + 2, 2, 2*(frame->f->width >> l->sps->hshift[i]) - 2);
                 }
         }
     }
@@ -487,7 +501,7 @@ static HEVCFrame *generate_missing_ref(HEVCContext *s, HEVCLayerContext *l, int
     frame->poc      = poc;
     frame->flags    = HEVC_FRAME_FLAG_UNAVAILABLE;
 
-    if (s->avctx->active_thread_type == FF_THREAD_FRAME)
+    if (s->avctx->active_thread_type & FF_THREAD_FRAME)
         ff_progress_frame_report(&frame->tf, INT_MAX);
 
     return frame;
@@ -72,6 +72,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context. With frame threading, this is set on the
+     * worker-thread contexts when they are given their own slice threads.
+     */
+    void *slice_thread_ctx;
+
     /**
      * This packet is used to hold the packet given to decoders
      * implementing the .decode API; it is unused by the generic
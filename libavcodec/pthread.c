@@ -43,6 +43,7 @@
  * Threading requires more than one thread.
  * Frame threading requires entire frames to be passed to the codec,
  * and introduces extra decoding delay, so is incompatible with low_delay.
+ * Codecs may additionally support slice threading within each frame thread.
  *
  * @param avctx The context.
  */
@@ -55,6 +56,10 @@ static av_cold void validate_thread_parameters(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
     } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
         avctx->active_thread_type = FF_THREAD_FRAME;
+        if (avctx->frame_slice_threads > 1 && avctx->thread_type & FF_THREAD_SLICE &&
+            avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
+            ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS)
+            avctx->active_thread_type |= FF_THREAD_SLICE;
     } else if (avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS &&
                avctx->thread_type & FF_THREAD_SLICE) {
         avctx->active_thread_type = FF_THREAD_SLICE;
@@ -73,10 +78,10 @@ av_cold int ff_thread_init(AVCodecContext *avctx)
 {
     validate_thread_parameters(avctx);
 
-    if (avctx->active_thread_type&FF_THREAD_SLICE)
-        return ff_slice_thread_init(avctx);
-    else if (avctx->active_thread_type&FF_THREAD_FRAME)
+    if (avctx->active_thread_type&FF_THREAD_FRAME)
         return ff_frame_thread_init(avctx);
+    else if (avctx->active_thread_type&FF_THREAD_SLICE)
+        return ff_slice_thread_init(avctx);
 
     return 0;
 }
@@ -554,7 +554,7 @@ static int submit_packet(PerThreadContext *p, AVCodecContext *user_avctx,
     pthread_mutex_unlock(&p->mutex);
 
     fctx->prev_thread = p;
-    fctx->next_decoding = (fctx->next_decoding + 1) % p->avctx->thread_count;
+    fctx->next_decoding = (fctx->next_decoding + 1) % user_avctx->thread_count;
 
     return 0;
 }
@@ -763,6 +763,8 @@ av_cold void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 
                 pthread_join(p->thread, NULL);
             }
+            if (ctx->internal->slice_thread_ctx)
+                ff_slice_thread_free(ctx);
             if (codec->close && p->thread_init != UNINITIALIZED)
                 codec->close(ctx);
 
@@ -874,6 +876,15 @@ static av_cold int init_thread(PerThreadContext *p, int *threads_to_free,
     if (!copy->internal->last_pkt_props)
         return AVERROR(ENOMEM);
 
+    /* Each frame thread gets its own slice threads, which the codec sees
+     * as plain slice threading. */
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        copy->thread_count = avctx->frame_slice_threads;
+        err = ff_slice_thread_init(copy);
+        if (err < 0)
+            return err;
+    }
+
     if (codec->init) {
         err = codec->init(copy);
         if (err < 0) {
@@ -32,8 +32,10 @@
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/log.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 #include "url.h"
 #include <stdint.h>
 
@@ -44,15 +46,30 @@
 #define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define RANGE_CACHE_CAPACITY    (8 * 1024 * 1024)
+/* seconds of input the read-ahead buffer should hold at the measured read rate */
+#define READ_AHEAD_TIME         2
 
 typedef struct RingBuffer
 {
     AVFifo       *fifo;
+    int           capacity;
     int           read_back_capacity;
 
     int           read_pos;
 } RingBuffer;
 
+/**
+ * Copy of the ring contents from before a long seek, restored if a later
+ * seek lands inside it again.
+ */
+typedef struct BufferedRange {
+    int64_t       pos;
+    uint8_t      *data;
+    int           size;
+    int           eof;
+} BufferedRange;
+
 typedef struct AsyncContext {
     AVClass        *class;
     URLContext     *inner;
@@ -71,6 +88,22 @@ typedef struct AsyncContext {
     int64_t         logical_size;
     RingBuffer      ring;
 
+    /* position the inner protocol must be moved to before filling the ring */
+    int64_t         inner_seek_pos;
+
+    BufferedRange  *ranges;
+    int             nb_ranges;
+    int64_t         ranges_size;
+
+    int64_t         bytes_read;
+    int64_t         rate_start;
+    int64_t         rate_bytes;
+    int64_t         read_rate;
+
+    int             nb_seeks;
+    int             nb_buffer_hits;
+    int             nb_range_hits;
+
     pthread_cond_t  cond_wakeup_main;
     pthread_cond_t  cond_wakeup_background;
     pthread_mutex_t mutex;
@@ -78,6 +111,10 @@ typedef struct AsyncContext {
 
     int             abort_request;
     AVIOInterruptCB interrupt_callback;
+
+    int             read_ahead_size;
+    int             max_read_ahead_size;
+    int             range_cache_size;
 } AsyncContext;
 
 static int ring_init(RingBuffer *ring, unsigned int capacity, int read_back_capacity)
@@ -87,10 +124,21 @@ static int ring_init(RingBuffer *ring, unsigned int capacity, int read_back_capa
     if (!ring->fifo)
         return AVERROR(ENOMEM);
 
+    ring->capacity           = capacity;
     ring->read_back_capacity = read_back_capacity;
     return 0;
 }
 
+static int ring_grow(RingBuffer *ring, int capacity)
+{
+    int ret = av_fifo_grow2(ring->fifo, capacity - ring->capacity);
+    if (ret < 0)
+        return ret;
+
+    ring->capacity = capacity;
+    return 0;
+}
+
 static void ring_destroy(RingBuffer *ring)
 {
     av_fifo_freep2(&ring->fifo);
@@ -167,6 +215,110 @@ static int ring_drain(RingBuffer *ring, int offset)
     return 0;
 }
 
+static void range_remove(AsyncContext *c, int idx)
+{
+    c->ranges_size -= c->ranges[idx].size;
+    av_freep(&c->ranges[idx].data);
+    memmove(&c->ranges[idx], &c->ranges[idx + 1],
+            (c->nb_ranges - idx - 1) * sizeof(*c->ranges));
+    c->nb_ranges--;
+}
+
+static void ranges_free(AsyncContext *c)
+{
+    while (c->nb_ranges)
+        range_remove(c, c->nb_ranges - 1);
+    av_freep(&c->ranges);
+}
+
+static int range_find(AsyncContext *c, int64_t pos)
+{
+    for (int i = c->nb_ranges - 1; i >= 0; i--)
+        if (pos >= c->ranges[i].pos && pos < c->ranges[i].pos + c->ranges[i].size)
+            return i;
+    return -1;
+}
+
+/**
+ * Keep a copy of the ring contents before a long seek discards them,
+ * evicting the oldest ranges to stay within range_cache_size.
+ */
+static void range_save(AsyncContext *c)
+{
+    RingBuffer    *ring = &c->ring;
+    BufferedRange *ranges, *r;
+    int64_t        pos  = c->logical_pos - ring_size_of_read_back(ring);
+    int            size = FFMIN(av_fifo_can_read(ring->fifo), c->range_cache_size);
+    uint8_t       *data;
+
+    if (size <= 0)
+        return;
+
+    for (int i = c->nb_ranges - 1; i >= 0; i--)
+        if (c->ranges[i].pos >= pos &&
+            c->ranges[i].pos + c->ranges[i].size <= pos + size)
+            range_remove(c, i);
+    while (c->nb_ranges && c->ranges_size + size > c->range_cache_size)
+        range_remove(c, 0);
+
+    data = av_malloc(size);
+    if (!data)
+        return;
+    ranges = av_realloc_array(c->ranges, c->nb_ranges + 1, sizeof(*c->ranges));
+    if (!ranges) {
+        av_free(data);
+        return;
+    }
+    c->ranges = ranges;
+
+    r       = &c->ranges[c->nb_ranges++];
+    r->pos  = pos;
+    r->data = data;
+    r->size = size;
+    r->eof  = size == av_fifo_can_read(ring->fifo) && c->io_eof_reached && !c->io_error;
+    av_fifo_peek(ring->fifo, r->data, size, 0);
+    c->ranges_size += size;
+}
+
+/**
+ * Refill the ring from a retained range and position it at pos. The inner
+ * protocol is moved to the end of the range later, by the buffer thread.
+ */
+static void range_restore(AsyncContext *c, const BufferedRange *r, int64_t pos)
+{
+    RingBuffer *ring = &c->ring;
+
+    ring_reset(ring);
+    av_fifo_write(ring->fifo, r->data, r->size);
+    ring_read(ring, NULL, pos - r->pos);
+
+    c->io_eof_reached = r->eof;
+    c->io_error       = 0;
+    c->inner_seek_pos = r->eof ? -1 : r->pos + r->size;
+}
+
+/**
+ * Grow the read-ahead buffer while it holds less than READ_AHEAD_TIME
+ * seconds of input at the rate the reader consumes it.
+ */
+static void ring_adapt(URLContext *h)
+{
+    AsyncContext *c    = h->priv_data;
+    RingBuffer   *ring = &c->ring;
+    int64_t     target = c->read_rate * READ_AHEAD_TIME;
+    int       capacity;
+
+    if (ring->capacity >= c->max_read_ahead_size || target <= ring->capacity)
+        return;
+
+    capacity = FFMIN(FFMAX(target, 2LL * ring->capacity), c->max_read_ahead_size);
+    if (ring_grow(ring, capacity) < 0)
+        return;
+
+    av_log(h, AV_LOG_DEBUG, "read-ahead buffer grown to %d bytes at %"PRId64" bytes/s\n",
+           capacity, c->read_rate);
+}
+
 static int async_check_interrupt(void *arg)
 {
     URLContext *h   = arg;
@@ -204,11 +356,28 @@ static void *async_buffer_task(void *arg)
         }
 
         if (c->seek_request) {
-            seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
-            if (seek_ret >= 0) {
-                c->io_eof_reached = 0;
-                c->io_error       = 0;
-                ring_reset(ring);
+            int idx = range_find(c, c->seek_pos);
+
+            if (idx >= 0) {
+                BufferedRange r = c->ranges[idx];
+
+                c->ranges[idx].data = NULL;
+                range_remove(c, idx);
+                range_save(c);
+                range_restore(c, &r, c->seek_pos);
+                av_free(r.data);
+
+                seek_ret = c->seek_pos;
+                c->nb_range_hits++;
+            } else {
+                seek_ret = ffurl_seek(c->inner, c->seek_pos, c->seek_whence);
+                if (seek_ret >= 0) {
+                    range_save(c);
+                    c->io_eof_reached = 0;
+                    c->io_error       = 0;
+                    c->inner_seek_pos = -1;
+                    ring_reset(ring);
+                }
             }
 
             c->seek_completed = 1;
@@ -221,7 +390,27 @@ static void *async_buffer_task(void *arg)
             continue;
         }
 
+        if (c->inner_seek_pos >= 0) {
+            int64_t pos = c->inner_seek_pos;
+
+            c->inner_seek_pos = -1;
+            pthread_mutex_unlock(&c->mutex);
+            seek_ret = ffurl_seek(c->inner, pos, SEEK_SET);
+            pthread_mutex_lock(&c->mutex);
+            if (seek_ret < 0 && !c->seek_request) {
+                c->io_eof_reached = 1;
+                c->io_error       = seek_ret;
+            }
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+
         fifo_space = ring_space(ring);
+        if (fifo_space <= 0 && !c->io_eof_reached) {
+            ring_adapt(h);
+            fifo_space = ring_space(ring);
+        }
         if (c->io_eof_reached || fifo_space <= 0) {
             pthread_cond_signal(&c->cond_wakeup_main);
             pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
@@ -255,9 +444,11 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
+    ret = ring_init(&c->ring, c->read_ahead_size, READ_BACK_CAPACITY);
     if (ret < 0)
         goto fifo_fail;
+    c->inner_seek_pos = -1;
+    c->rate_start     = av_gettime_relative();
 
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
@@ -328,11 +519,19 @@ static int async_close(URLContext *h)
     if (ret != 0)
         av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(ret));
 
+    if (c->nb_seeks)
+        av_log(h, AV_LOG_VERBOSE, "%d seeks, %d served from the read-ahead buffer and "
+               "%d from retained ranges (%.1f%% hit rate), read-ahead buffer %d bytes\n",
+               c->nb_seeks, c->nb_buffer_hits, c->nb_range_hits,
+               100.0 * (c->nb_buffer_hits + c->nb_range_hits) / c->nb_seeks,
+               c->ring.capacity);
+
     pthread_cond_destroy(&c->cond_wakeup_background);
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
     ffurl_closep(&c->inner);
     ring_destroy(&c->ring);
+    ranges_free(c);
 
     return 0;
 }
@@ -378,6 +577,17 @@ static int async_read_internal(URLContext *h, void *dest, int size)
         pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
     }
 
+    if (ret > 0 && !read_complete) {
+        int64_t now = av_gettime_relative();
+
+        c->bytes_read += ret;
+        if (now - c->rate_start >= 1000000) {
+            c->read_rate  = (c->bytes_read - c->rate_bytes) * 1000000 / (now - c->rate_start);
+            c->rate_bytes = c->bytes_read;
+            c->rate_start = now;
+        }
+    }
+
     pthread_cond_signal(&c->cond_wakeup_background);
     pthread_mutex_unlock(&c->mutex);
 
@@ -413,10 +623,13 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
     if (new_logical_pos < 0)
         return AVERROR(EINVAL);
 
+    pthread_mutex_lock(&c->mutex);
+
     fifo_size = ring_size(ring);
     fifo_size_of_read_back = ring_size_of_read_back(ring);
     if (new_logical_pos == c->logical_pos) {
         /* current position */
+        pthread_mutex_unlock(&c->mutex);
         return c->logical_pos;
     } else if ((new_logical_pos >= (c->logical_pos - fifo_size_of_read_back)) &&
                (new_logical_pos < (c->logical_pos + fifo_size + SHORT_SEEK_THRESHOLD))) {
@@ -426,26 +639,31 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
                 new_logical_pos, (int)c->logical_pos,
                 (int)(new_logical_pos - c->logical_pos), fifo_size);
 
+        c->nb_seeks++;
+        c->nb_buffer_hits++;
         if (pos_delta > 0) {
             // fast seek forwards
+            pthread_mutex_unlock(&c->mutex);
             async_read_internal(h, NULL, pos_delta);
         } else {
             // fast seek backwards
             ring_drain(ring, pos_delta);
             c->logical_pos = new_logical_pos;
+            pthread_mutex_unlock(&c->mutex);
         }
 
         return c->logical_pos;
     } else if (c->logical_size <= 0) {
         /* can not seek */
+        pthread_mutex_unlock(&c->mutex);
         return AVERROR(EINVAL);
     } else if (new_logical_pos > c->logical_size) {
         /* beyond end */
+        pthread_mutex_unlock(&c->mutex);
         return AVERROR(EINVAL);
     }
 
-    pthread_mutex_lock(&c->mutex);
-
+    c->nb_seeks++;
     c->seek_request   = 1;
     c->seek_pos       = new_logical_pos;
     c->seek_whence    = SEEK_SET;
@@ -476,6 +694,12 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 #define D AV_OPT_FLAG_DECODING_PARAM
 
 static const AVOption options[] = {
+    { "read_ahead_size", "initial size of the read-ahead buffer",
+        OFFSET(read_ahead_size), AV_OPT_TYPE_INT, { .i64 = BUFFER_CAPACITY }, 4096, INT_MAX - READ_BACK_CAPACITY, D },
+    { "max_read_ahead_size", "size the read-ahead buffer may grow to when the input is consumed quickly",
+        OFFSET(max_read_ahead_size), AV_OPT_TYPE_INT, { .i64 = 4 * BUFFER_CAPACITY }, 0, INT_MAX - READ_BACK_CAPACITY, D },
+    { "range_cache_size", "amount of previously buffered data kept for seeks back into it, 0 to disable",
+        OFFSET(range_cache_size), AV_OPT_TYPE_INT, { .i64 = RANGE_CACHE_CAPACITY }, 0, INT_MAX, D },
     {NULL},
 };
 
@@ -182,7 +182,15 @@ void avformat_free_context(AVFormatContext *s)
     av_dict_free(&si->id3v2_meta);
     av_packet_free(&si->pkt);
     av_packet_free(&si->parse_pkt);
+    ff_packet_pool_free(&si->packet_pool);
     avpriv_packet_list_free(&si->packet_buffer);
+    if (s->oformat) {
+        while (fci->free_packet_entries) {
+            PacketListEntry *pktl = fci->free_packet_entries;
+            fci->free_packet_entries = pktl->next;
+            av_free(pktl);
+        }
+    }
     av_freep(&s->streams);
     av_freep(&s->stream_groups);
     if (s->iformat)
@@ -1435,6 +1435,13 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_SORT_DTS    0x10000 ///< try to interleave outputted packets by dts (using this flag can slow demuxing down)
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+/**
+ * When demuxing, allocate the payloads read with av_get_packet() and the
+ * frames output by the parsers from size-classed buffer pools, instead of
+ * allocating and freeing a buffer for each packet. Buffers are kept for
+ * reuse until the context is closed.
+ */
+#define AVFMT_FLAG_PACKET_POOL 0x400000
 
     /**
      * Maximum number of bytes read from input in order to determine stream
@@ -53,6 +53,41 @@ typedef struct FormatContextInternal {
              */
             int nb_interleaved_streams;
 
+            /**
+             * Number of streams that max_interleave_delta may skip
+             * while they have no packets queued, see
+             * interleave_delta_may_skip().
+             * Muxing only.
+             */
+            int nb_skippable_streams;
+
+            /**
+             * Number of streams with packets in packet_buffer and how
+             * many of them are skippable. Maintained by
+             * ff_interleave_add_packet() for ff_interleave_packet_per_dts(),
+             * so that the latter need not scan all streams per packet.
+             * Muxing only.
+             */
+            int nb_buffered_streams;
+            int nb_buffered_skippable_streams;
+
+            /**
+             * Largest last_in_packet_buffer_dts of the non-subtitle streams
+             * with packets in packet_buffer, for the max_interleave_delta
+             * check. Only meaningful while last_dts_max_valid is set; it is
+             * recomputed when the stream holding it runs out of packets.
+             * Muxing only.
+             */
+            int64_t last_dts_max;
+            int last_dts_max_valid;
+
+            /**
+             * Entries of packet_buffer returned by
+             * ff_interleave_packet_per_dts(), kept for reuse.
+             * Muxing only.
+             */
+            PacketListEntry *free_packet_entries;
+
             /**
              * The interleavement function in use. Always set.
              */
@@ -115,6 +115,38 @@ URLContext *ffio_geturlcontext(AVIOContext *s)
         return NULL;
 }
 
+int ffio_read_mapped(AVIOContext *s, AVBufferRef **buf, uint8_t **data, int size)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    URLContext *h = ffio_geturlcontext(s);
+    int short_seek = ctx->short_seek_threshold;
+    int64_t pos, ret;
+
+    if (!h || !h->prot->url_map || s->write_flag || s->update_checksum ||
+        !(s->seekable & AVIO_SEEKABLE_NORMAL))
+        return AVERROR(ENOSYS);
+    /* Otherwise avio_skip() reads the data into the buffer anyway. */
+    if (ctx->short_seek_get)
+        short_seek = FFMAX(short_seek, ctx->short_seek_get(s->opaque));
+    if (size - (s->buf_end - s->buf_ptr) <= short_seek)
+        return AVERROR(ENOSYS);
+
+    pos = avio_tell(s);
+    if (pos < 0)
+        return AVERROR(ENOSYS);
+    ret = h->prot->url_map(h, pos, size, AV_INPUT_BUFFER_PADDING_SIZE, buf, data);
+    if (ret < 0)
+        return ret;
+
+    ret = avio_skip(s, size);
+    if (ret < 0) {
+        av_buffer_unref(buf);
+        *data = NULL;
+        return ret;
+    }
+    return size;
+}
+
 static int url_alloc_for_protocol(URLContext **puc, const URLProtocol *up,
                                   const char *filename, int flags,
                                   const AVIOInterruptCB *int_cb)
@@ -21,6 +21,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 
 extern const AVClass ff_avio_class;
@@ -76,6 +77,12 @@ typedef struct FFIOContext {
      * is updated each time a successful writeout ends up further position-wise
      */
     int64_t written_output_size;
+
+    /**
+     * Pools used by av_get_packet() for the packet payloads, owned by the
+     * demuxing context using this AVIOContext.
+     */
+    struct FFPacketPool *packet_pool;
 } FFIOContext;
 
 static av_always_inline FFIOContext *ffiocontext(AVIOContext *ctx)
@@ -222,6 +229,23 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size);
  */
 struct URLContext *ffio_geturlcontext(AVIOContext *s);
 
+/**
+ * Read the next size bytes of s without copying them, if the underlying
+ * protocol can map them into memory (see URLProtocol.url_map).
+ *
+ * This is only attempted if skipping the data avoids reading it, i.e. for
+ * seekable inputs and sizes above the short seek threshold, including the
+ * one returned by short_seek_get.
+ *
+ * @param buf  set to a new reference to a buffer containing the data
+ * @param data set to the start of the data, which is followed by
+ *             AV_INPUT_BUFFER_PADDING_SIZE zero bytes
+ * @return size on success, AVERROR(ENOSYS) if the data was not mapped
+ *         (nothing was read then), or another negative AVERROR code
+ */
+int ffio_read_mapped(AVIOContext *s, AVBufferRef **buf,
+                     uint8_t **data, int size);
+
 /**
  * Create and initialize a AVIOContext for accessing the
  * resource referenced by the URLContext h.
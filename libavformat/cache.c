@@ -23,17 +23,23 @@
 
 /**
  * @TODO
- *      support keeping files
  *      support filling with a background thread
  */
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/dict.h"
 #include "libavutil/file_open.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/sha.h"
 #include "libavutil/tree.h"
 #include "avio.h"
+#include "internal.h"
+#if HAVE_DIRENT_H
+#include <dirent.h>
+#endif
 #include <fcntl.h>
 #if HAVE_IO_H
 #include <io.h>
@@ -43,9 +49,17 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <time.h>
+#if HAVE_UTIME
+#include <utime.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
+#ifndef O_BINARY
+#   define O_BINARY 0
+#endif
+
 typedef struct CacheEntry {
     int64_t logical_pos;
     int64_t physical_pos;
@@ -65,6 +79,22 @@ typedef struct CacheContext {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+
+    /* persistent cache, see cache_read_persistent() */
+    char *cache_dir;
+    int chunk_size;
+    int64_t max_cache_size;
+    char *chunk_prefix;
+    uint8_t *chunk;
+    int64_t chunk_index;
+    int chunk_len;
+    int chunk_complete;
+    int64_t chunk_hit, chunk_miss;
+    int64_t bytes_miss;
+    int64_t inner_size;
+    char *inner_url;
+    int inner_flags;
+    AVDictionary *inner_options;
 } CacheContext;
 
 static int cmp(const void *key, const void *node)
@@ -72,6 +102,161 @@ static int cmp(const void *key, const void *node)
     return FFDIFFSIGN(*(const int64_t *)key, ((const CacheEntry *) node)->logical_pos);
 }
 
+typedef struct ChunkFile {
+    char *name;
+    int64_t size;
+    time_t mtime;
+} ChunkFile;
+
+static int cmp_mtime(const void *a, const void *b)
+{
+    const ChunkFile *fa = a, *fb = b;
+    return FFDIFFSIGN(fa->mtime, fb->mtime);
+}
+
+/* temporary chunk files older than this were left by interrupted writes */
+#define TMP_CHUNK_MAX_AGE 3600
+
+/**
+ * Return the length of the chunk name name starts with, 0 if none.
+ */
+static size_t chunk_name_len(const char *name)
+{
+    size_t len;
+
+    if (strlen(name) <= 65 || strspn(name, "0123456789abcdef") != 64 ||
+        name[64] != '-')
+        return 0;
+    len = strspn(name + 65, "0123456789");
+    return len ? 65 + len : 0;
+}
+
+/**
+ * Check if name is a temporary chunk file written by chunk_store().
+ */
+static int is_tmp_chunk_name(const char *name, size_t len)
+{
+    return name[len] == '.' && strspn(name + len + 1, "0123456789abcdef") == 8 &&
+           !strcmp(name + len + 9, ".tmp");
+}
+
+/**
+ * Delete the temporary chunk files left by interrupted writes in cache_dir,
+ * and the least recently used chunks of all resources until their total
+ * size is at most max_cache_size.
+ */
+static void cache_prune(URLContext *h)
+{
+#if HAVE_DIRENT_H
+    CacheContext *c = h->priv_data;
+    ChunkFile *files = NULL;
+    unsigned nb_files = 0, files_size = 0;
+    int64_t total = 0;
+    time_t now = time(NULL);
+    struct dirent *de;
+    DIR *dir;
+
+    if (!(dir = opendir(c->cache_dir)))
+        return;
+
+    while ((de = readdir(dir))) {
+        size_t len = chunk_name_len(de->d_name);
+        struct stat st;
+        int is_tmp;
+        char *name;
+
+        if (!len)
+            continue;
+        is_tmp = is_tmp_chunk_name(de->d_name, len);
+        if (!is_tmp && (de->d_name[len] || c->max_cache_size <= 0))
+            continue;
+        name = av_asprintf("%s/%s", c->cache_dir, de->d_name);
+        if (!name)
+            break;
+        if (stat(name, &st) < 0 || !S_ISREG(st.st_mode)) {
+            av_free(name);
+            continue;
+        }
+        if (is_tmp) {
+            /* other processes may still be writing recent ones */
+            if (now - st.st_mtime > TMP_CHUNK_MAX_AGE && unlink(name) >= 0)
+                av_log(h, AV_LOG_VERBOSE, "Deleted stale %s\n", name);
+            av_free(name);
+            continue;
+        }
+        if (nb_files >= files_size) {
+            ChunkFile *tmp = av_realloc_array(files, 2 * files_size + 64, sizeof(*files));
+            if (!tmp) {
+                av_free(name);
+                break;
+            }
+            files      = tmp;
+            files_size = 2 * files_size + 64;
+        }
+        files[nb_files].name  = name;
+        files[nb_files].size  = st.st_size;
+        files[nb_files].mtime = st.st_mtime;
+        nb_files++;
+        total += st.st_size;
+    }
+    closedir(dir);
+
+    if (total > c->max_cache_size) {
+        qsort(files, nb_files, sizeof(*files), cmp_mtime);
+        for (unsigned i = 0; i < nb_files && total > c->max_cache_size; i++) {
+            /* may race with other processes pruning the same directory */
+            if (unlink(files[i].name) >= 0 || errno == ENOENT)
+                total -= files[i].size;
+        }
+    }
+
+    for (unsigned i = 0; i < nb_files; i++)
+        av_free(files[i].name);
+    av_free(files);
+#endif
+}
+
+static int cache_open_persistent(URLContext *h, const char *url)
+{
+    CacheContext *c = h->priv_data;
+    char key[2 * 32 + 1];
+    uint8_t digest[32];
+    struct AVSHA *sha;
+    struct stat st;
+    char *id;
+
+    if (stat(c->cache_dir, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        av_log(h, AV_LOG_ERROR, "Cache directory %s does not exist\n", c->cache_dir);
+        return AVERROR(ENOENT);
+    }
+
+    /* chunks written with a different chunk size are not reusable */
+    id  = av_asprintf("%d:%s", c->chunk_size, url);
+    sha = av_sha_alloc();
+    if (!id || !sha) {
+        av_free(id);
+        av_free(sha);
+        return AVERROR(ENOMEM);
+    }
+    av_sha_init(sha, 256);
+    av_sha_update(sha, id, strlen(id));
+    av_sha_final(sha, digest);
+    av_free(sha);
+    av_free(id);
+    ff_data_to_hex(key, digest, sizeof(digest), 1);
+    key[sizeof(key) - 1] = 0;
+
+    c->chunk_prefix = av_asprintf("%s/%s-", c->cache_dir, key);
+    c->chunk        = av_malloc(c->chunk_size);
+    if (!c->chunk_prefix || !c->chunk)
+        return AVERROR(ENOMEM);
+    c->chunk_index = -1;
+    c->fd          = -1;
+
+    cache_prune(h);
+    return 0;
+}
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     CacheContext *c = h->priv_data;
@@ -80,6 +265,31 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "cache:", &arg);
 
+    if (c->cache_dir) {
+        ret = cache_open_persistent(h, arg);
+        if (ret < 0) {
+            av_freep(&c->chunk);
+            av_freep(&c->chunk_prefix);
+            return ret;
+        }
+        /* The inner protocol is only opened on the first chunk miss, see
+         * cache_open_inner(); its options are kept until then. */
+        c->inner_url   = av_strdup(arg);
+        c->inner_flags = flags;
+        c->inner_size  = -1;
+        if (!c->inner_url ||
+            (options && av_dict_copy(&c->inner_options, *options, 0) < 0)) {
+            av_freep(&c->inner_url);
+            av_dict_free(&c->inner_options);
+            av_freep(&c->chunk);
+            av_freep(&c->chunk_prefix);
+            return AVERROR(ENOMEM);
+        }
+        if (options)
+            av_dict_free(options);
+        return 0;
+    }
+
     c->fd = avpriv_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
@@ -160,12 +370,212 @@ fail:
     return ret;
 }
 
+static void chunk_store(URLContext *h)
+{
+    CacheContext *c = h->priv_data;
+    char *path = av_asprintf("%s%"PRId64, c->chunk_prefix, c->chunk_index);
+    char *tmp  = av_asprintf("%s.%08"PRIx32".tmp", path ? path : "", av_get_random_seed());
+    int fd = -1, ret = AVERROR(ENOMEM);
+
+    if (!path || !tmp)
+        goto fail;
+
+    /* Write to a temporary file first, so that other processes only ever
+     * see complete chunks. */
+    fd = avpriv_open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0666);
+    if (fd < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    for (int pos = 0; pos < c->chunk_len; pos += ret) {
+        ret = write(fd, c->chunk + pos, c->chunk_len - pos);
+        if (ret < 0) {
+            ret = AVERROR(errno);
+            goto fail;
+        }
+    }
+    ret = close(fd);
+    fd  = -1;
+    if (ret < 0 || rename(tmp, path) < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    av_free(path);
+    av_free(tmp);
+    return;
+fail:
+    av_log(h, AV_LOG_WARNING, "Could not store chunk %"PRId64": %s\n",
+           c->chunk_index, av_err2str(ret));
+    if (fd >= 0)
+        close(fd);
+    if (tmp)
+        unlink(tmp);
+    av_free(path);
+    av_free(tmp);
+}
+
+static int chunk_load(URLContext *h, int64_t index)
+{
+    CacheContext *c = h->priv_data;
+    char *path = av_asprintf("%s%"PRId64, c->chunk_prefix, index);
+    int fd, len = 0, ret = 0;
+
+    if (!path)
+        return AVERROR(ENOMEM);
+
+    c->chunk_index    = index;
+    c->chunk_len      = 0;
+    c->chunk_complete = 0;
+
+    fd = avpriv_open(path, O_RDONLY | O_BINARY);
+    if (fd >= 0) {
+        while (len < c->chunk_size &&
+               (ret = read(fd, c->chunk + len, c->chunk_size - len)) > 0)
+            len += ret;
+        close(fd);
+#if HAVE_UTIME
+        /* mark as recently used for cache_prune() */
+        if (ret >= 0)
+            utime(path, NULL);
+#endif
+    }
+    av_free(path);
+    if (fd < 0 || ret < 0) {
+        c->chunk_miss++;
+        return 0;
+    }
+
+    c->chunk_len      = len;
+    c->chunk_complete = 1;
+    c->chunk_hit++;
+    /* only the last chunk of a resource is short */
+    if (len < c->chunk_size) {
+        c->is_true_eof = 1;
+        c->end = index * c->chunk_size + len;
+    }
+    return 0;
+}
+
+static int cache_open_inner(URLContext *h)
+{
+    CacheContext *c = h->priv_data;
+    const AVDictionaryEntry *e = NULL;
+    int ret;
+
+    if (c->inner)
+        return 0;
+
+    ret = ffurl_open_whitelist(&c->inner, c->inner_url, c->inner_flags,
+                               &h->interrupt_callback, &c->inner_options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (ret < 0)
+        return ret;
+    while ((e = av_dict_iterate(c->inner_options, e)))
+        av_log(h, AV_LOG_WARNING, "Option %s not used by %s\n", e->key, c->inner_url);
+    av_dict_free(&c->inner_options);
+
+    c->inner_pos  = 0;
+    /* lets the last chunk be stored without reading until EOF */
+    c->inner_size = ffurl_seek(c->inner, 0, AVSEEK_SIZE);
+    if (c->inner_size < 0)
+        return 0;
+    if (c->is_true_eof && c->end != c->inner_size)
+        av_log(h, AV_LOG_WARNING, "Size of %s changed from %"PRId64" to %"PRId64
+               ", chunks in the cache may be stale\n", c->inner_url, c->end, c->inner_size);
+    c->is_true_eof = 1;
+    c->end         = c->inner_size;
+    return 0;
+}
+
+static int chunk_fill(URLContext *h)
+{
+    CacheContext *c = h->priv_data;
+    int64_t pos = c->chunk_index * c->chunk_size + c->chunk_len;
+    int64_t r;
+
+    r = cache_open_inner(h);
+    if (r < 0)
+        return r;
+
+    if (c->inner_pos != pos) {
+        r = ffurl_seek(c->inner, pos, SEEK_SET);
+        if (r < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to perform internal seek\n");
+            return r;
+        }
+        c->inner_pos = r;
+    }
+
+    r = ffurl_read(c->inner, c->chunk + c->chunk_len, c->chunk_size - c->chunk_len);
+    if (r == AVERROR_EOF || r == 0) {
+        /* don't store a truncated resource for good */
+        if (c->inner_size > pos) {
+            av_log(h, AV_LOG_WARNING, "Unexpected end of input at %"PRId64"\n", pos);
+            return AVERROR_EOF;
+        }
+        c->is_true_eof = 1;
+        c->end = FFMAX(c->end, pos);
+        c->chunk_complete = 1;
+        chunk_store(h);
+        return 0;
+    }
+    if (r < 0)
+        return r;
+    c->inner_pos  += r;
+    c->chunk_len  += r;
+    c->bytes_miss += r;
+    if (c->chunk_len == c->chunk_size || pos + r == c->inner_size) {
+        c->chunk_complete = 1;
+        chunk_store(h);
+    }
+    return 0;
+}
+
+/**
+ * Read through the current chunk, which is loaded from cache_dir if another
+ * process or an earlier run stored it, or otherwise filled from the inner
+ * protocol and stored once complete.
+ */
+static int cache_read_persistent(URLContext *h, unsigned char *buf, int size)
+{
+    CacheContext *c = h->priv_data;
+    int64_t index = c->logical_pos / c->chunk_size;
+    int offset    = c->logical_pos % c->chunk_size;
+    int ret;
+
+    if (c->is_true_eof && c->logical_pos >= c->end)
+        return AVERROR_EOF;
+
+    if (index != c->chunk_index) {
+        ret = chunk_load(h, index);
+        if (ret < 0)
+            return ret;
+    }
+
+    while (offset >= c->chunk_len) {
+        if (c->chunk_complete)
+            return AVERROR_EOF;
+        ret = chunk_fill(h);
+        if (ret < 0)
+            return ret;
+    }
+
+    size = FFMIN(size, c->chunk_len - offset);
+    memcpy(buf, c->chunk + offset, size);
+    c->logical_pos += size;
+    c->end = FFMAX(c->end, c->logical_pos);
+    return size;
+}
+
 static int cache_read(URLContext *h, unsigned char *buf, int size)
 {
     CacheContext *c = h->priv_data;
     CacheEntry *entry, *next[2] = {NULL, NULL};
     int64_t r;
 
+    if (c->cache_dir)
+        return cache_read_persistent(h, buf, size);
+
     entry = av_tree_find(c->root, &c->logical_pos, cmp, (void**)next);
 
     if (!entry)
@@ -225,11 +635,50 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
     return r;
 }
 
+/**
+ * Seek within the resource cached in cache_dir. Positions are served from
+ * the chunk index; the inner protocol is only opened when the size of the
+ * resource is needed and no stored chunk has revealed it yet.
+ */
+static int64_t cache_seek_persistent(URLContext *h, int64_t pos, int whence)
+{
+    CacheContext *c = h->priv_data;
+    int ret;
+
+    if (whence == SEEK_CUR) {
+        whence = SEEK_SET;
+        pos += c->logical_pos;
+    }
+
+    if (whence != SEEK_SET && !c->is_true_eof) {
+        ret = cache_open_inner(h);
+        if (ret < 0)
+            return ret;
+        if (!c->is_true_eof)
+            return c->inner_size;
+    }
+
+    if (whence == AVSEEK_SIZE)
+        return c->end;
+    if (whence == SEEK_END)
+        pos += c->end;
+    else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+
+    if (pos < 0)
+        return AVERROR(EINVAL);
+    c->logical_pos = pos;
+    return pos;
+}
+
 static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
 {
     CacheContext *c = h->priv_data;
     int64_t ret;
 
+    if (c->cache_dir)
+        return cache_seek_persistent(h, pos, whence);
+
     if (whence == AVSEEK_SIZE) {
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
@@ -284,6 +733,7 @@ resolve_eof:
 
     if (ret >= 0) {
         c->logical_pos = ret;
+        c->inner_pos   = ret;
         c->end = FFMAX(c->end, ret);
     }
 
@@ -301,6 +751,18 @@ static int cache_close(URLContext *h)
     CacheContext *c = h->priv_data;
     int ret;
 
+    if (c->cache_dir) {
+        av_log(h, AV_LOG_INFO, "Statistics, chunk hits:%"PRId64" chunk misses:%"PRId64
+               " bytes fetched:%"PRId64"\n", c->chunk_hit, c->chunk_miss, c->bytes_miss);
+        ffurl_closep(&c->inner);
+        av_freep(&c->inner_url);
+        av_dict_free(&c->inner_options);
+        av_freep(&c->chunk);
+        av_freep(&c->chunk_prefix);
+        cache_prune(h);
+        return 0;
+    }
+
     av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
            c->cache_hit, c->cache_miss);
 
@@ -323,6 +785,9 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "cache_dir", "Directory to keep a persistent cache shared between processes in", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { "cache_chunk_size", "Size of the chunks stored in cache_dir", OFFSET(chunk_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, INT_MAX / 2, D },
+    { "max_cache_size", "Maximum total size of cache_dir in bytes, 0 for unlimited", OFFSET(max_cache_size), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D },
     {NULL},
 };
 
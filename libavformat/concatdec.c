@@ -18,6 +18,10 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#include <stdatomic.h>
+
 #include "libavutil/avstring.h"
 #include "libavutil/avassert.h"
 #include "libavutil/bprint.h"
@@ -25,6 +29,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "libavutil/timestamp.h"
 #include "libavcodec/codec_desc.h"
 #include "libavcodec/bsf.h"
@@ -39,6 +44,12 @@ typedef enum ConcatMatchMode {
     MATCH_EXACT_ID,
 } ConcatMatchMode;
 
+enum ConcatPreopenState {
+    PREOPEN_NONE,
+    PREOPEN_BUSY,
+    PREOPEN_DONE,
+};
+
 typedef struct ConcatStream {
     AVBSFContext *bsf;
     int out_stream_index;
@@ -58,6 +69,9 @@ typedef struct {
     AVDictionary *metadata;
     AVDictionary *options;
     int nb_streams;
+    AVFormatContext *preopened;
+    int preopen_ret;
+    enum ConcatPreopenState preopen_state;
 } ConcatFile;
 
 typedef struct {
@@ -72,6 +86,16 @@ typedef struct {
     ConcatMatchMode stream_match_mode;
     unsigned auto_convert;
     int segment_time_metadata;
+    int preopen;
+#if HAVE_THREADS
+    pthread_t preopen_thread;
+    pthread_mutex_t preopen_mutex;
+    pthread_cond_t preopen_cond;
+    int preopen_thread_started;
+    atomic_int preopen_exit;
+    unsigned preopen_next;
+    unsigned preopen_end;
+#endif
 } ConcatContext;
 
 static int concat_probe(const AVProbeData *probe)
@@ -332,35 +356,36 @@ static int64_t get_best_effort_duration(ConcatFile *file, AVFormatContext *avf)
     return AV_NOPTS_VALUE;
 }
 
-static int open_file(AVFormatContext *avf, unsigned fileno)
+/**
+ * Open and probe a file of the list. Only reads the shared context, so that
+ * it can also run on the preopen thread.
+ */
+static int open_input(AVFormatContext *avf, ConcatFile *file,
+                      const AVIOInterruptCB *interrupt_callback,
+                      AVFormatContext **pavf)
 {
-    ConcatContext *cat = avf->priv_data;
-    ConcatFile *file = &cat->files[fileno];
+    AVFormatContext *s;
     AVDictionary *options = NULL;
     int ret;
 
-    if (cat->avf)
-        avformat_close_input(&cat->avf);
-
-    cat->avf = avformat_alloc_context();
-    if (!cat->avf)
+    s = avformat_alloc_context();
+    if (!s)
         return AVERROR(ENOMEM);
 
-    cat->avf->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
-    cat->avf->interrupt_callback = avf->interrupt_callback;
+    s->flags |= avf->flags & ~AVFMT_FLAG_CUSTOM_IO;
+    s->interrupt_callback = *interrupt_callback;
 
-    if ((ret = ff_copy_whiteblacklists(cat->avf, avf)) < 0)
-        return ret;
-
-    ret = av_dict_copy(&options, file->options, 0);
-    if (ret < 0)
+    if ((ret = ff_copy_whiteblacklists(s, avf)) < 0 ||
+        (ret = av_dict_copy(&options, file->options, 0)) < 0) {
+        avformat_free_context(s);
         return ret;
+    }
 
-    if ((ret = avformat_open_input(&cat->avf, file->url, NULL, &options)) < 0 ||
-        (ret = avformat_find_stream_info(cat->avf, NULL)) < 0) {
+    if ((ret = avformat_open_input(&s, file->url, NULL, &options)) < 0 ||
+        (ret = avformat_find_stream_info(s, NULL)) < 0) {
         av_log(avf, AV_LOG_ERROR, "Impossible to open '%s'\n", file->url);
         av_dict_free(&options);
-        avformat_close_input(&cat->avf);
+        avformat_close_input(&s);
         return ret;
     }
     if (options) {
@@ -368,6 +393,171 @@ static int open_file(AVFormatContext *avf, unsigned fileno)
         /* TODO log unused options once we have a proper string API */
         av_dict_free(&options);
     }
+    *pavf = s;
+    return 0;
+}
+
+#if HAVE_THREADS
+static int preopen_interrupt_cb(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+
+    return atomic_load(&cat->preopen_exit) ||
+           ff_check_interrupt(&avf->interrupt_callback);
+}
+
+static void *preopen_thread(void *arg)
+{
+    AVFormatContext *avf = arg;
+    ConcatContext *cat = avf->priv_data;
+    const AVIOInterruptCB interrupt_callback = { preopen_interrupt_cb, avf };
+
+    ff_thread_setname("concat-preopen");
+
+    pthread_mutex_lock(&cat->preopen_mutex);
+    while (!atomic_load(&cat->preopen_exit)) {
+        AVFormatContext *s = NULL;
+        ConcatFile *file;
+        int ret;
+
+        while (cat->preopen_next < cat->preopen_end &&
+               cat->files[cat->preopen_next].preopen_state != PREOPEN_NONE)
+            cat->preopen_next++;
+        if (cat->preopen_next >= cat->preopen_end) {
+            pthread_cond_wait(&cat->preopen_cond, &cat->preopen_mutex);
+            continue;
+        }
+
+        file = &cat->files[cat->preopen_next++];
+        file->preopen_state = PREOPEN_BUSY;
+        pthread_mutex_unlock(&cat->preopen_mutex);
+
+        ret = open_input(avf, file, &interrupt_callback, &s);
+
+        pthread_mutex_lock(&cat->preopen_mutex);
+        file->preopened     = s;
+        file->preopen_ret   = ret;
+        file->preopen_state = PREOPEN_DONE;
+        pthread_cond_broadcast(&cat->preopen_cond);
+    }
+    pthread_mutex_unlock(&cat->preopen_mutex);
+
+    return NULL;
+}
+
+static int preopen_init(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+    int ret;
+
+    if ((ret = pthread_mutex_init(&cat->preopen_mutex, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&cat->preopen_cond, NULL))) {
+        pthread_mutex_destroy(&cat->preopen_mutex);
+        return AVERROR(ret);
+    }
+    atomic_init(&cat->preopen_exit, 0);
+    if ((ret = pthread_create(&cat->preopen_thread, NULL, preopen_thread, avf))) {
+        pthread_cond_destroy(&cat->preopen_cond);
+        pthread_mutex_destroy(&cat->preopen_mutex);
+        return AVERROR(ret);
+    }
+    cat->preopen_thread_started = 1;
+    return 0;
+}
+
+static void preopen_uninit(AVFormatContext *avf)
+{
+    ConcatContext *cat = avf->priv_data;
+
+    if (!cat->preopen_thread_started)
+        return;
+
+    pthread_mutex_lock(&cat->preopen_mutex);
+    atomic_store(&cat->preopen_exit, 1);
+    pthread_cond_broadcast(&cat->preopen_cond);
+    pthread_mutex_unlock(&cat->preopen_mutex);
+    pthread_join(cat->preopen_thread, NULL);
+
+    pthread_cond_destroy(&cat->preopen_cond);
+    pthread_mutex_destroy(&cat->preopen_mutex);
+    cat->preopen_thread_started = 0;
+}
+
+/**
+ * Take the context opened in advance for fileno, if any, and queue the
+ * files following it. Contexts opened for files that are not among those
+ * any more, e.g. after seeking, are dropped.
+ */
+static int preopen_get(AVFormatContext *avf, unsigned fileno, AVFormatContext **pavf)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    unsigned end = fileno + 1 + FFMIN(cat->preopen, cat->nb_files - fileno - 1);
+    int ret = 0;
+
+    if (!cat->preopen_thread_started)
+        return 0;
+
+    pthread_mutex_lock(&cat->preopen_mutex);
+    while (file->preopen_state == PREOPEN_BUSY)
+        pthread_cond_wait(&cat->preopen_cond, &cat->preopen_mutex);
+    if (file->preopen_state == PREOPEN_DONE) {
+        *pavf = file->preopened;
+        file->preopened     = NULL;
+        file->preopen_state = PREOPEN_NONE;
+        ret = file->preopen_ret;
+        av_log(avf, AV_LOG_DEBUG, "Using preopened '%s'\n", file->url);
+    }
+
+    for (unsigned i = 0; i < cat->nb_files; i++) {
+        if ((i <= fileno || i >= end) && cat->files[i].preopen_state == PREOPEN_DONE) {
+            avformat_close_input(&cat->files[i].preopened);
+            cat->files[i].preopen_state = PREOPEN_NONE;
+        }
+    }
+
+    if (cat->preopen_next <= fileno || cat->preopen_next > end)
+        cat->preopen_next = fileno + 1;
+    cat->preopen_end = end;
+    pthread_cond_broadcast(&cat->preopen_cond);
+    pthread_mutex_unlock(&cat->preopen_mutex);
+
+    return ret;
+}
+#else
+static int preopen_init(AVFormatContext *avf)
+{
+    av_log(avf, AV_LOG_WARNING, "preopen requires threads, opening files when needed.\n");
+    return 0;
+}
+
+static void preopen_uninit(AVFormatContext *avf)
+{
+}
+
+static int preopen_get(AVFormatContext *avf, unsigned fileno, AVFormatContext **pavf)
+{
+    return 0;
+}
+#endif
+
+static int open_file(AVFormatContext *avf, unsigned fileno)
+{
+    ConcatContext *cat = avf->priv_data;
+    ConcatFile *file = &cat->files[fileno];
+    int ret;
+
+    if (cat->avf)
+        avformat_close_input(&cat->avf);
+
+    if ((ret = preopen_get(avf, fileno, &cat->avf)) < 0)
+        return ret;
+    if (!cat->avf &&
+        (ret = open_input(avf, file, &avf->interrupt_callback, &cat->avf)) < 0)
+        return ret;
+
     cat->cur_file = file;
     file->start_time = !fileno ? 0 :
                        cat->files[fileno - 1].start_time +
@@ -396,7 +586,10 @@ static int concat_read_close(AVFormatContext *avf)
     ConcatContext *cat = avf->priv_data;
     unsigned i, j;
 
+    preopen_uninit(avf);
+
     for (i = 0; i < cat->nb_files; i++) {
+        avformat_close_input(&cat->files[i].preopened);
         av_freep(&cat->files[i].url);
         for (j = 0; j < cat->files[i].nb_streams; j++) {
             if (cat->files[i].streams[j].bsf)
@@ -696,6 +889,8 @@ static int concat_read_header(AVFormatContext *avf)
 
     cat->stream_match_mode = avf->nb_streams ? MATCH_EXACT_ID :
                                                MATCH_ONE_TO_ONE;
+    if (cat->preopen && cat->nb_files > 1 && (ret = preopen_init(avf)) < 0)
+        return ret;
     if ((ret = open_file(avf, 0)) < 0)
         return ret;
 
@@ -939,6 +1134,8 @@ static const AVOption options[] = {
       OFFSET(auto_convert), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, DEC },
     { "segment_time_metadata", "output file segment start time and duration as packet metadata",
       OFFSET(segment_time_metadata), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
+    { "preopen", "number of following files to open and probe in a background thread",
+      OFFSET(preopen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, DEC },
     { NULL }
 };
 
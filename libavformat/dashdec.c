@@ -154,6 +154,7 @@ typedef struct DASHContext {
     AVDictionary *avio_opts;
     int max_url_size;
     char *cenc_decryption_key;
+    int http_connection_pool;
 
     /* Flags for init section*/
     int is_init_section_common_video;
@@ -446,6 +447,9 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     av_freep(pb);
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
+    /* manifests and segments are usually fetched from the same servers */
+    if (c->http_connection_pool && av_strstart(proto_name, "http", NULL))
+        av_dict_set(&tmp, "connection_pool", "1", AV_DICT_DONT_OVERWRITE);
     ret = ffio_open_whitelist(pb, url, AVIO_FLAG_READ, c->interrupt_callback, &tmp, s->protocol_whitelist, s->protocol_blacklist);
     if (ret >= 0) {
         // update cookies on http response with setcookies.
@@ -2367,6 +2371,7 @@ static const AVOption dash_options[] = {
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
     { "cenc_decryption_key", "Media decryption key (hex)", OFFSET(cenc_decryption_key), AV_OPT_TYPE_STRING, {.str = NULL}, INT_MIN, INT_MAX, .flags = FLAGS },
+    { "http_connection_pool", "Share idle persistent HTTP connections with other requests", OFFSET(http_connection_pool), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
     {NULL}
 };
 
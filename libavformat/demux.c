@@ -257,6 +257,15 @@ int avformat_open_input(AVFormatContext **ps, const char *filename,
         goto fail;
     s->probe_score = ret;
 
+    if (s->flags & AVFMT_FLAG_PACKET_POOL) {
+        if (!(si->packet_pool = ff_packet_pool_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (s->pb)
+            ffiocontext(s->pb)->packet_pool = si->packet_pool;
+    }
+
     if (!s->protocol_whitelist && s->pb && s->pb->protocol_whitelist) {
         s->protocol_whitelist = av_strdup(s->pb->protocol_whitelist);
         if (!s->protocol_whitelist) {
@@ -357,6 +366,8 @@ close:
 fail:
     ff_id3v2_free_extra_meta(&id3v2_extra_meta);
     av_dict_free(&tmp);
+    if (s->pb)
+        ffiocontext(s->pb)->packet_pool = NULL;
     if (s->pb && !(s->flags & AVFMT_FLAG_CUSTOM_IO))
         avio_closep(&s->pb);
     avformat_free_context(s);
@@ -375,6 +386,10 @@ void avformat_close_input(AVFormatContext **ps)
     s  = *ps;
     pb = s->pb;
 
+    /* a custom AVIOContext may outlive the pools */
+    if (pb)
+        ffiocontext(pb)->packet_pool = NULL;
+
     if ((s->iformat && strcmp(s->iformat->name, "image2") && s->iformat->flags & AVFMT_NOFILE) ||
         (s->flags & AVFMT_FLAG_CUSTOM_IO))
         pb = NULL;
@@ -1228,6 +1243,12 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
                 ret = AVERROR(ENOMEM);
                 goto fail;
             }
+        } else if (si->packet_pool) {
+            const uint8_t *data = out_pkt->data;
+            ret = ff_packet_pool_get(si->packet_pool, out_pkt, out_pkt->size);
+            if (ret < 0)
+                goto fail;
+            memcpy(out_pkt->data, data, out_pkt->size);
         } else {
             ret = av_packet_make_refcounted(out_pkt);
             if (ret < 0)
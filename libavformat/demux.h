@@ -343,4 +343,24 @@ int ff_find_stream_index(const AVFormatContext *s, int id);
 
 int ff_buffer_packet(AVFormatContext *s, AVPacket *pkt);
 
+typedef struct FFPacketPool FFPacketPool;
+
+FFPacketPool *ff_packet_pool_alloc(void);
+
+/**
+ * Free the pools. Buffers still referenced are freed when they are
+ * unreferenced.
+ */
+void ff_packet_pool_free(FFPacketPool **ppool);
+
+/**
+ * Allocate a padded payload of the given size for a packet without buffer,
+ * from the pool of the size class of size. Sizes too large for the pools
+ * are allocated directly.
+ * Sets pkt->buf, pkt->data and pkt->size.
+ *
+ * @return >= 0 if OK, AVERROR_xxx on error
+ */
+int ff_packet_pool_get(FFPacketPool *pool, AVPacket *pkt, int size);
+
 #endif /* AVFORMAT_DEMUX_H */
@@ -346,3 +346,59 @@ int ff_find_stream_index(const AVFormatContext *s, int id)
             return i;
     return -1;
 }
+
+/* the pools hold buffers of 2 << index bytes, from 256 bytes to 16 MiB */
+#define PACKET_POOL_MIN_INDEX  7
+#define PACKET_POOL_MAX_INDEX 23
+
+struct FFPacketPool {
+    AVBufferPool *pools[PACKET_POOL_MAX_INDEX + 1];
+};
+
+FFPacketPool *ff_packet_pool_alloc(void)
+{
+    return av_mallocz(sizeof(FFPacketPool));
+}
+
+void ff_packet_pool_free(FFPacketPool **ppool)
+{
+    FFPacketPool *pool = *ppool;
+
+    if (!pool)
+        return;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++)
+        av_buffer_pool_uninit(&pool->pools[i]);
+    av_freep(ppool);
+}
+
+int ff_packet_pool_get(FFPacketPool *pool, AVPacket *pkt, int size)
+{
+    AVBufferRef *buf;
+    int index;
+
+    av_assert1(!pkt->buf);
+
+    if ((unsigned)size >= INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+
+    index = FFMAX(av_log2(size + AV_INPUT_BUFFER_PADDING_SIZE), PACKET_POOL_MIN_INDEX);
+    if (index > PACKET_POOL_MAX_INDEX) {
+        buf = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    } else {
+        if (!pool->pools[index]) {
+            pool->pools[index] = av_buffer_pool_init(2 << index, NULL);
+            if (!pool->pools[index])
+                return AVERROR(ENOMEM);
+        }
+        buf = av_buffer_pool_get(pool->pools[index]);
+    }
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt->buf  = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    return 0;
+}
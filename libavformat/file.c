@@ -19,9 +19,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* Needed for syscall(), MAP_ANONYMOUS, MAP_POPULATE and O_DIRECT */
+#endif
+
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
@@ -42,6 +47,22 @@
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if HAVE_LINUX_IO_URING_H && HAVE_MMAP
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+#if HAVE_LINUX_IO_URING_H && HAVE_MMAP && defined(__NR_io_uring_setup)
+#define FILE_URING 1
+#else
+#define FILE_URING 0
+#endif
+
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
 #  ifdef S_IFIFO
@@ -89,6 +110,37 @@
 
 /* standard file protocol */
 
+#define URING_MAX_DEPTH 64
+#define URING_ALIGN     4096
+
+#if FILE_URING
+typedef struct URingRequest {
+    uint8_t *buf;
+    struct iovec iov;
+    int64_t pos;        ///< file offset of buf
+    int size;           ///< number of bytes requested
+    int result;         ///< bytes transferred or negative errno once completed
+    int pending;        ///< submitted and not yet completed
+} URingRequest;
+
+typedef struct URing {
+    int fd;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    struct io_uring_cqe *cqes;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+} URing;
+#endif
+
+typedef struct FileMapWindow {
+    AVBufferRef *buf;
+    int64_t start;          ///< file offset of the window
+    int64_t dirty;          ///< end of the padding zeroed in the window
+} FileMapWindow;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -97,9 +149,31 @@ typedef struct FileContext {
     int pkt_size;
     int follow;
     int seekable;
+    int io_uring;
+    int io_depth;
+    int direct;
+    int use_mmap;
+    int64_t map_size;
+    size_t page_size;
+    FileMapWindow map[2];   ///< see file_map()
+    int map_last;           ///< window of the last mapped packet
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if FILE_URING
+    URing ring;
+    int ring_active;
+    int is_write;
+    int chunk_size;
+    uint8_t *req_mem;
+    size_t req_mem_size;
+    URingRequest req[URING_MAX_DEPTH];
+    int head;           ///< oldest request (read-ahead queue or write slot)
+    int nb_queued;      ///< number of read-ahead requests, in file order
+    int64_t pos;        ///< logical file position
+    int64_t ahead_pos;  ///< file offset of the next read-ahead request
+    int io_error;       ///< first error of an asynchronous write
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -108,6 +182,10 @@ static const AVOption file_options[] = {
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
     { "pkt_size", "Maximum packet size", offsetof(FileContext, pkt_size), AV_OPT_TYPE_INT, { .i64 = 262144 }, 1, INT_MAX, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_uring", "Use io_uring for read-ahead and write-behind", offsetof(FileContext, io_uring), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_depth", "Number of io_uring requests in flight", offsetof(FileContext, io_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, URING_MAX_DEPTH, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "direct", "Bypass the page cache (O_DIRECT) with io_uring", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "Map large packets into memory instead of copying them", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -138,11 +216,440 @@ static const AVClass fd_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if FILE_URING
+static void uring_uninit(URing *r)
+{
+    if (r->sqes && r->sqes != MAP_FAILED)
+        munmap(r->sqes, r->sqes_size);
+    if (r->cq_ring && r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_size);
+    if (r->sq_ring && r->sq_ring != MAP_FAILED)
+        munmap(r->sq_ring, r->sq_ring_size);
+    if (r->fd >= 0)
+        close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+static int uring_init(URing *r, unsigned entries)
+{
+    struct io_uring_params p = { 0 };
+    int single_mmap = 0;
+    int ret;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) {
+        ret = AVERROR(errno);
+        r->fd = -1;
+        return ret;
+    }
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->sq_ring_size = r->cq_ring_size = FFMAX(r->sq_ring_size, r->cq_ring_size);
+        single_mmap = 1;
+    }
+#endif
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED)
+        goto fail;
+    r->cq_ring = single_mmap ? r->sq_ring :
+                 mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ring == MAP_FAILED)
+        goto fail;
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        goto fail;
+
+    r->sq_tail  = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)((uint8_t *)r->sq_ring + p.sq_off.array);
+    r->cq_head  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.head);
+    r->cq_tail  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)((uint8_t *)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)((uint8_t *)r->cq_ring + p.cq_off.cqes);
+    return 0;
+
+fail:
+    ret = AVERROR(errno);
+    uring_uninit(r);
+    return ret;
+}
+
+/**
+ * Queue a single vectored read or write and submit it to the kernel.
+ */
+static int uring_submit(URing *r, int opcode, int fd,
+                        const struct iovec *iov, int64_t pos, int id)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned idx  = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    int ret;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->addr      = (uintptr_t)iov;
+    sqe->len       = 1;
+    sqe->off       = pos;
+    sqe->user_data = id;
+    r->sq_array[idx] = idx;
+    atomic_store_explicit((atomic_uint *)r->sq_tail, tail + 1, memory_order_release);
+
+    do {
+        ret = syscall(__NR_io_uring_enter, r->fd, 1, 0, 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret > 0)
+        return 0;
+
+    /* The entry was not consumed, e.g. with EAGAIN or EBUSY when the kernel
+     * is short of resources or the completion queue is full. Take it back,
+     * the caller decides how to continue. */
+    ret = ret < 0 ? AVERROR(errno) : AVERROR(EAGAIN);
+    atomic_store_explicit((atomic_uint *)r->sq_tail, tail, memory_order_release);
+    return ret;
+}
+
+/**
+ * Wait for the next completion and return its request id and result.
+ */
+static int uring_wait(URing *r, int *id, int *res)
+{
+    for (;;) {
+        unsigned head = *r->cq_head;
+        unsigned tail = atomic_load_explicit((atomic_uint *)r->cq_tail, memory_order_acquire);
+
+        if (head != tail) {
+            const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            *id  = cqe->user_data;
+            *res = cqe->res;
+            atomic_store_explicit((atomic_uint *)r->cq_head, head + 1, memory_order_release);
+            return 0;
+        }
+        if (syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+            errno != EINTR)
+            return AVERROR(errno);
+    }
+}
+
+static int file_uring_submit(FileContext *c, URingRequest *req, int64_t pos, int size)
+{
+    int ret;
+
+    req->pos         = pos;
+    req->size        = size;
+    req->iov.iov_base = req->buf;
+    req->iov.iov_len  = size;
+    ret = uring_submit(&c->ring, c->is_write ? IORING_OP_WRITEV : IORING_OP_READV,
+                       c->fd, &req->iov, pos, req - c->req);
+    if (ret < 0)
+        return ret;
+    req->pending = 1;
+    return 0;
+}
+
+/**
+ * Reap one completion. Short writes are completed synchronously, write
+ * errors are kept in io_error until the caller can report them.
+ */
+static int file_uring_reap(FileContext *c)
+{
+    URingRequest *req;
+    int id, res, ret;
+
+    ret = uring_wait(&c->ring, &id, &res);
+    if (ret < 0)
+        return ret;
+    if (id < 0 || id >= c->io_depth)
+        return AVERROR_BUG;
+    req = &c->req[id];
+    req->pending = 0;
+    req->result  = res;
+
+    if (c->is_write) {
+        while (res >= 0 && res < req->size) {
+            ret = pwrite(c->fd, req->buf + res, req->size - res, req->pos + res);
+            if (ret <= 0) {
+                res = ret < 0 ? -errno : -EIO;
+                break;
+            }
+            res += ret;
+        }
+        if (res < 0 && !c->io_error)
+            c->io_error = AVERROR(-res);
+    }
+    return 0;
+}
+
+static int file_uring_drain(FileContext *c)
+{
+    for (int i = 0; i < c->io_depth; i++) {
+        while (c->req[i].pending) {
+            int ret = file_uring_reap(c);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    c->nb_queued = 0;
+    return 0;
+}
+
+static void file_uring_close(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+
+    if (file_uring_drain(c) < 0 && !c->io_error)
+        c->io_error = AVERROR(EIO);
+    uring_uninit(&c->ring);
+    if (c->req_mem)
+        munmap(c->req_mem, c->req_mem_size);
+    c->req_mem     = NULL;
+    c->ring_active = 0;
+}
+
+/**
+ * Stop using io_uring after a failed submission and continue with plain
+ * I/O at the current position, once the requests in flight are completed.
+ */
+static int file_uring_fallback(URLContext *h, int err)
+{
+    FileContext *c = h->priv_data;
+    int64_t pos = c->pos;
+
+    av_log(h, AV_LOG_WARNING, "io_uring submission failed (%s), using plain I/O\n",
+           av_err2str(err));
+    file_uring_close(h);
+    if (c->io_error)
+        return c->io_error;
+#ifdef O_DIRECT
+    if (c->direct) {
+        int fl = fcntl(c->fd, F_GETFL);
+        if (fl < 0 || fcntl(c->fd, F_SETFL, fl & ~O_DIRECT) < 0)
+            return AVERROR(errno);
+        c->direct = 0;
+    }
+#endif
+    if (lseek(c->fd, pos, SEEK_SET) < 0)
+        return AVERROR(errno);
+    return 0;
+}
+
+static void file_uring_open(URLContext *h, int flags)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    int ret;
+
+    if ((flags & AVIO_FLAG_READ) && (flags & AVIO_FLAG_WRITE))
+        return;
+    if (fstat(c->fd, &st) < 0 || !(S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)))
+        return;
+
+    ret = uring_init(&c->ring, c->io_depth);
+    if (ret < 0) {
+        av_log(h, AV_LOG_VERBOSE, "io_uring not available (%s), using plain I/O\n",
+               av_err2str(ret));
+        return;
+    }
+
+    c->is_write   = !!(flags & AVIO_FLAG_WRITE);
+    c->chunk_size = FFALIGN(FFMIN(c->pkt_size, c->blocksize), URING_ALIGN);
+    c->req_mem_size = (size_t)c->chunk_size * c->io_depth;
+    c->req_mem = mmap(NULL, c->req_mem_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (c->req_mem == MAP_FAILED) {
+        c->req_mem = NULL;
+        uring_uninit(&c->ring);
+        return;
+    }
+    for (int i = 0; i < c->io_depth; i++)
+        c->req[i] = (URingRequest){ .buf = c->req_mem + (size_t)i * c->chunk_size };
+
+#ifdef O_DIRECT
+    if (c->direct) {
+        int fl = fcntl(c->fd, F_GETFL);
+        if (fl < 0 || fcntl(c->fd, F_SETFL, fl | O_DIRECT) < 0) {
+            av_log(h, AV_LOG_VERBOSE, "O_DIRECT not supported, using buffered I/O\n");
+            c->direct = 0;
+        }
+    }
+#else
+    c->direct = 0;
+#endif
+
+    c->head        = 0;
+    c->nb_queued   = 0;
+    c->pos         = 0;
+    c->io_error    = 0;
+    c->ring_active = 1;
+    av_log(h, AV_LOG_DEBUG, "Using io_uring with %d requests of %d bytes%s\n",
+           c->io_depth, c->chunk_size, c->direct ? ", O_DIRECT" : "");
+}
+
+/**
+ * Queue read-ahead requests up to io_depth. Failing to submit more is
+ * only an error if nothing is queued.
+ */
+static int file_uring_fill(FileContext *c)
+{
+    while (c->nb_queued < c->io_depth) {
+        URingRequest *req = &c->req[(c->head + c->nb_queued) % c->io_depth];
+        int ret = file_uring_submit(c, req, c->ahead_pos, c->chunk_size);
+        if (ret < 0)
+            return c->nb_queued ? 0 : ret;
+        c->ahead_pos += c->chunk_size;
+        c->nb_queued++;
+    }
+    return 0;
+}
+
+/**
+ * @return the number of bytes read, a negative AVERROR code, or 0 if
+ *         io_uring was given up and plain I/O must be used
+ */
+static int file_uring_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    int ret;
+
+    /* Keep the read-ahead window if the position is still inside it. */
+    if (c->nb_queued && (c->pos < c->req[c->head].pos || c->pos >= c->ahead_pos)) {
+        if ((ret = file_uring_drain(c)) < 0)
+            return ret;
+    }
+
+    for (;;) {
+        URingRequest *req;
+        int64_t end;
+
+        if (!c->nb_queued) {
+            c->ahead_pos = c->direct ? c->pos & ~(int64_t)(URING_ALIGN - 1) : c->pos;
+            c->head = 0;
+        }
+        if ((ret = file_uring_fill(c)) < 0)
+            return file_uring_fallback(h, ret);
+
+        req = &c->req[c->head];
+        while (req->pending) {
+            if ((ret = file_uring_reap(c)) < 0)
+                return ret;
+        }
+        if (req->result < 0) {
+            ret = AVERROR(-req->result);
+            file_uring_drain(c);
+            return ret;
+        }
+
+        end = req->pos + req->result;
+        if (c->pos < end) {
+            int len = FFMIN(size, end - c->pos);
+            memcpy(buf, req->buf + (c->pos - req->pos), len);
+            c->pos += len;
+            return len;
+        }
+
+        if (c->pos < req->pos + req->size) {
+            /* The request covering the position came back short, this is
+             * the end of the file for now. */
+            if ((ret = file_uring_drain(c)) < 0)
+                return ret;
+            return c->follow ? AVERROR(EAGAIN) : AVERROR_EOF;
+        }
+        c->head = (c->head + 1) % c->io_depth;
+        c->nb_queued--;
+    }
+}
+
+/**
+ * @return the number of bytes queued, a negative AVERROR code, or 0 if
+ *         io_uring was given up and plain I/O must be used
+ */
+static int file_uring_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    URingRequest *req = &c->req[c->head];
+    int ret;
+
+    while (req->pending) {
+        if ((ret = file_uring_reap(c)) < 0)
+            return ret;
+    }
+    if (c->io_error)
+        return c->io_error;
+
+    size = FFMIN(size, c->chunk_size);
+#ifdef O_DIRECT
+    if (c->direct && ((c->pos | size) & (URING_ALIGN - 1))) {
+        /* Unaligned writes are not possible with O_DIRECT, which usually
+         * happens at flushes. Continue with buffered writes. */
+        int fl;
+        if ((ret = file_uring_drain(c)) < 0)
+            return ret;
+        fl = fcntl(c->fd, F_GETFL);
+        if (fl >= 0)
+            fcntl(c->fd, F_SETFL, fl & ~O_DIRECT);
+        c->direct = 0;
+        av_log(h, AV_LOG_VERBOSE, "Unaligned write, disabling O_DIRECT\n");
+    }
+#endif
+
+    memcpy(req->buf, buf, size);
+    if ((ret = file_uring_submit(c, req, c->pos, size)) < 0)
+        return file_uring_fallback(h, ret);
+    c->pos += size;
+    c->head = (c->head + 1) % c->io_depth;
+    return size;
+}
+
+static int64_t file_uring_seek(URLContext *h, int64_t pos, int whence)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    int ret;
+
+    /* Pending writes must land before the size is queried or a region is
+     * rewritten; pending reads are kept if the new position is in range. */
+    if (c->is_write) {
+        if ((ret = file_uring_drain(c)) < 0)
+            return ret;
+        if (c->io_error)
+            return c->io_error;
+    }
+
+    if (whence == AVSEEK_SIZE || whence == SEEK_END) {
+        if (fstat(c->fd, &st) < 0)
+            return AVERROR(errno);
+        if (whence == AVSEEK_SIZE)
+            return st.st_size;
+        pos += st.st_size;
+    } else if (whence == SEEK_CUR) {
+        pos += c->pos;
+    } else if (whence != SEEK_SET) {
+        return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+    return c->pos = pos;
+}
+#endif
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if FILE_URING
+    if (c->ring_active && (ret = file_uring_read(h, buf, size)))
+        return ret;
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -156,6 +663,10 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if FILE_URING
+    if (c->ring_active && (ret = file_uring_write(h, buf, size)))
+        return ret;
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -223,8 +734,17 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
-    return (ret == -1) ? AVERROR(errno) : 0;
+    int ret, err = 0;
+#if FILE_URING
+    if (c->ring_active) {
+        file_uring_close(h);
+        err = c->io_error;
+    }
+#endif
+    av_buffer_unref(&c->map[0].buf);
+    av_buffer_unref(&c->map[1].buf);
+    ret = close(c->fd);
+    return (ret == -1) ? AVERROR(errno) : err;
 }
 
 /* XXX: use llseek */
@@ -233,6 +753,11 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if FILE_URING
+    if (c->ring_active)
+        return file_uring_seek(h, pos, whence);
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -246,6 +771,110 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_MMAP
+/* size of the windows file_map() maps packets from */
+#define MAP_WINDOW_SIZE (64 << 20)
+
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    munmap(data, (size_t)(uintptr_t)opaque);
+}
+
+static void file_map_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+
+    if (fstat(c->fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return;
+#if HAVE_SYSCONF && defined(_SC_PAGESIZE)
+    c->page_size = sysconf(_SC_PAGESIZE);
+#else
+    c->page_size = 4096;
+#endif
+    c->map_size = st.st_size;
+}
+
+/**
+ * Map a new window w of the file starting at the page holding pos and
+ * covering at least len bytes, but usually much more so that it can be
+ * reused for the following packets.
+ */
+static int file_map_window(URLContext *h, FileMapWindow *w, int64_t pos, int64_t len)
+{
+    FileContext *c = h->priv_data;
+    const int64_t file_end = FFALIGN(c->map_size, c->page_size);
+    int64_t start = pos - pos % c->page_size;
+    size_t size;
+    uint8_t *ptr;
+
+    /* Pages entirely past the end of the file must not be touched, the
+     * tail of the last page reads as zeros. */
+    if (pos + len > file_end)
+        return AVERROR(ENOSYS);
+    size = FFMIN(FFMAX(MAP_WINDOW_SIZE, FFALIGN(pos + len - start, c->page_size)),
+                 file_end - start);
+
+    av_buffer_unref(&w->buf);
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, start);
+    if (ptr == MAP_FAILED) {
+        av_log(h, AV_LOG_VERBOSE, "mmap() failed: %s\n", av_err2str(AVERROR(errno)));
+        c->map_size = 0;
+        return AVERROR(ENOSYS);
+    }
+    w->buf = av_buffer_create(ptr, size, file_unmap, (void *)(uintptr_t)size, 0);
+    if (!w->buf) {
+        munmap(ptr, size);
+        return AVERROR(ENOMEM);
+    }
+    w->start = start;
+    w->dirty = start;
+    return 0;
+}
+
+/**
+ * Packets reference one of two windows mapping large parts of the file,
+ * which are only replaced when a packet does not fit into them. The mappings
+ * are private, so zeroing the padding of a packet only copies the page
+ * holding it and does not change the file. It does change the data following
+ * the packet in its window though, usually the start of the next packet, so
+ * consecutive packets alternate between the two windows.
+ */
+static int file_map(URLContext *h, int64_t pos, int size, int padding,
+                    AVBufferRef **buf, uint8_t **data)
+{
+    FileContext *c = h->priv_data;
+    FileMapWindow *w = NULL;
+    int ret;
+
+    if (!c->map_size || pos < 0 || size <= 0 || pos > c->map_size - size)
+        return AVERROR(ENOSYS);
+    for (int i = 0; i < FF_ARRAY_ELEMS(c->map); i++) {
+        FileMapWindow *cur = &c->map[(c->map_last + 1 + i) % FF_ARRAY_ELEMS(c->map)];
+        if (cur->buf && pos >= cur->dirty &&
+            pos + size + padding <= cur->start + cur->buf->size) {
+            w = cur;
+            break;
+        }
+    }
+    if (!w) {
+        w = &c->map[!c->map_last];
+        ret = file_map_window(h, w, pos, size + padding);
+        if (ret < 0)
+            return ret;
+    }
+    c->map_last = w - c->map;
+
+    *buf = av_buffer_ref(w->buf);
+    if (!*buf)
+        return AVERROR(ENOMEM);
+    *data = w->buf->data + (pos - w->start);
+    memset(*data + size, 0, padding);
+    w->dirty = pos + size + padding;
+    return 0;
+}
+#endif
+
 static int file_delete(URLContext *h)
 {
 #if HAVE_UNISTD_H
@@ -320,6 +949,22 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE))
+        file_map_init(h);
+#else
+    if (c->use_mmap)
+        av_log(h, AV_LOG_VERBOSE, "mmap not supported by this build\n");
+#endif
+
+#if FILE_URING
+    if (c->io_uring)
+        file_uring_open(h, flags);
+#else
+    if (c->io_uring)
+        av_log(h, AV_LOG_VERBOSE, "io_uring not supported by this build\n");
+#endif
+
     return 0;
 }
 
@@ -415,6 +1060,9 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+#if HAVE_MMAP
+    .url_map             = file_map,
+#endif
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
@@ -27,6 +27,7 @@
  * https://www.rfc-editor.org/rfc/rfc8216.txt
  */
 
+#include "config.h"
 #include "config_components.h"
 
 #include "libavformat/http.h"
@@ -38,6 +39,8 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/fifo.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "demux.h"
@@ -87,6 +90,8 @@ struct segment {
 };
 
 struct rendition;
+struct prefetch_slot;
+struct prefetch_pool;
 
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
@@ -107,6 +112,12 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    /* set if input reads a segment downloaded by a prefetch thread */
+    struct prefetch_slot *input_slot;
+    /* segments being downloaded ahead of cur_seq_no, in order */
+    struct prefetch_slot **prefetch;
+    int n_prefetch;
+    struct prefetch_pool *prefetch_pool;
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -143,6 +154,9 @@ struct playlist {
 
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
+    /* key of the last segment passed to prefetch_start() */
+    char prefetch_key_url[MAX_URL_SIZE];
+    uint8_t prefetch_key[16];
 
     /* ID3 timestamp handling (elementary audio streams have ID3 timestamps
      * (and possibly other ID3 tags) in the beginning of each segment) */
@@ -228,13 +242,20 @@ typedef struct HLSContext {
     int extension_picky;
     int max_reload;
     int http_persistent;
+    int http_connection_pool;
     int http_multiple;
     int http_seekable;
     int seg_max_retry;
+    int prefetch_segments;
+    int prefetch_buffer_size;
     AVIOContext *playlist_pb;
     HLSCryptoContext  crypto_ctx;
 } HLSContext;
 
+static void close_input(struct playlist *pls);
+static void prefetch_cancel(struct playlist *pls);
+static void prefetch_pool_free(struct playlist *pls);
+
 static void free_segment_dynarray(struct segment **segments, int n_segments)
 {
     int i;
@@ -279,7 +300,9 @@ static void free_playlist_list(HLSContext *c)
         av_freep(&pls->init_sec_buf);
         av_packet_free(&pls->pkt);
         av_freep(&pls->pb.pub.buffer);
-        ff_format_io_close(c->ctx, &pls->input);
+        close_input(pls);
+        prefetch_cancel(pls);
+        prefetch_pool_free(pls);
         pls->input_read_done = 0;
         ff_format_io_close(c->ctx, &pls->input_next);
         pls->input_next_requested = 0;
@@ -646,13 +669,10 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 #endif
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+static int check_url(AVFormatContext *s, const char *url, int *is_http_out)
 {
     HLSContext *c = s->priv_data;
-    AVDictionary *tmp = NULL;
     const char *proto_name = NULL;
-    int ret;
     int is_http = 0;
 
     if (av_strstart(url, "crypto", NULL)) {
@@ -694,6 +714,22 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     else if (strcmp(proto_name, "file") || !strncmp(url, "file,", 5))
         return AVERROR_INVALIDDATA;
 
+    *is_http_out = is_http;
+    return 0;
+}
+
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+{
+    HLSContext *c = s->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+    int is_http = 0;
+
+    ret = check_url(s, url, &is_http);
+    if (ret < 0)
+        return ret;
+
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
 
@@ -821,8 +857,11 @@ static int parse_playlist(HLSContext *c, const char *url,
         AVDictionary *opts = NULL;
         av_dict_copy(&opts, c->avio_opts, 0);
 
-        if (c->http_persistent)
+        if (c->http_persistent) {
             av_dict_set(&opts, "multiple_requests", "1", 0);
+            if (c->http_connection_pool)
+                av_dict_set(&opts, "connection_pool", "1", 0);
+        }
 
         ret = c->ctx->io_open(c->ctx, &in, url, AVIO_FLAG_READ, &opts);
         av_dict_free(&opts);
@@ -1336,7 +1375,8 @@ static void intercept_id3(struct playlist *pls, uint8_t *buf,
         pls->is_id3_timestamped = (pls->id3_mpegts_timestamp != AV_NOPTS_VALUE);
 }
 
-static int read_key(HLSContext *c, struct playlist *pls, struct segment *seg)
+static int read_key_data(HLSContext *c, struct playlist *pls,
+                         struct segment *seg, uint8_t key[16])
 {
     AVIOContext *pb = NULL;
 
@@ -1347,41 +1387,77 @@ static int read_key(HLSContext *c, struct playlist *pls, struct segment *seg)
         return ret;
     }
 
-    ret = avio_read(pb, pls->key, sizeof(pls->key));
+    ret = avio_read(pb, key, 16);
     ff_format_io_close(pls->parent, &pb);
-    if (ret != sizeof(pls->key)) {
+    if (ret != 16) {
         if (ret < 0) {
             av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s, %s\n",
                    seg->key, av_err2str(ret));
         } else {
-            av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s, read bytes %d != %zu\n",
-                   seg->key, ret, sizeof(pls->key));
+            av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s, read bytes %d != %d\n",
+                   seg->key, ret, 16);
             ret = AVERROR_INVALIDDATA;
         }
 
         return ret;
     }
 
+    return 0;
+}
+
+static int read_key(HLSContext *c, struct playlist *pls, struct segment *seg)
+{
+    int ret = read_key_data(c, pls, seg, pls->key);
+    if (ret < 0)
+        return ret;
+
     av_strlcpy(pls->key_url, seg->key, sizeof(pls->key_url));
 
     return 0;
 }
 
-static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+/*
+ * Set up the URL and protocol options for requesting seg, decrypting it
+ * with key if it is AES-128 encrypted.
+ */
+static void segment_request(HLSContext *c, struct segment *seg, const uint8_t *key,
+                            char *url, int url_size, AVDictionary **opts)
 {
-    AVDictionary *opts = NULL;
-    int ret;
-    int is_http = 0;
-
-    if (c->http_persistent)
-        av_dict_set(&opts, "multiple_requests", "1", 0);
+    if (c->http_persistent) {
+        av_dict_set(opts, "multiple_requests", "1", 0);
+        if (c->http_connection_pool)
+            av_dict_set(opts, "connection_pool", "1", 0);
+    }
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
          * (if this is in fact a HTTP request) */
-        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
-        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        av_dict_set_int(opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(opts, "end_offset", seg->url_offset + seg->size, 0);
+    }
+
+    if (seg->key_type == KEY_AES_128) {
+        char iv_hex[33], key_hex[33];
+        ff_data_to_hex(iv_hex, seg->iv, sizeof(seg->iv), 0);
+        ff_data_to_hex(key_hex, key, 16, 0);
+        if (strstr(seg->url, "://"))
+            snprintf(url, url_size, "crypto+%s", seg->url);
+        else
+            snprintf(url, url_size, "crypto:%s", seg->url);
+
+        av_dict_set(opts, "key", key_hex, 0);
+        av_dict_set(opts, "iv", iv_hex, 0);
+    } else {
+        av_strlcpy(url, seg->url, url_size);
     }
+}
+
+static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+{
+    AVDictionary *opts = NULL;
+    char url[MAX_URL_SIZE];
+    int ret;
+    int is_http = 0;
 
     av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
            seg->url, seg->url_offset, pls->index);
@@ -1394,26 +1470,12 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
         }
     }
 
-    if (seg->key_type == KEY_AES_128) {
-        char iv[33], key[33], url[MAX_URL_SIZE];
-        ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
-        ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
-        if (strstr(seg->url, "://"))
-            snprintf(url, sizeof(url), "crypto+%s", seg->url);
-        else
-            snprintf(url, sizeof(url), "crypto:%s", seg->url);
-
-        av_dict_set(&opts, "key", key, 0);
-        av_dict_set(&opts, "iv", iv, 0);
+    segment_request(c, seg, pls->key, url, sizeof(url), &opts);
 
-        ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
-        if (ret < 0) {
-            goto cleanup;
-        }
-        ret = 0;
-    } else {
-        ret = open_url(pls->parent, in, seg->url, &c->avio_opts, opts, &is_http);
-    }
+    ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
+    if (ret < 0)
+        goto cleanup;
+    ret = 0;
 
     /* Seek to the requested position. If this was a HTTP request, the offset
      * should already be where want it to, but this allows e.g. local testing
@@ -1425,7 +1487,7 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
      * as would be expected. Wrong offset received from the server will not be
      * noticed without the call, though.
      */
-    if (ret == 0 && !is_http && seg->url_offset) {
+    if (!is_http && seg->url_offset) {
         int64_t seekret = avio_seek(*in, seg->url_offset, SEEK_SET);
         if (seekret < 0) {
             av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
@@ -1440,6 +1502,452 @@ cleanup:
     return ret;
 }
 
+#if HAVE_THREADS
+#define MAX_PREFETCH_THREADS 4
+
+/*
+ * A segment downloaded ahead of time by a worker of the playlist's prefetch
+ * pool into a bounded FIFO, see the prefetch_segments option. Everything
+ * needed for the request is copied, as the segment list may be replaced by
+ * playlist reloads.
+ */
+struct prefetch_slot {
+    struct playlist *pls;
+    int64_t seq_no;
+    char *url;
+    AVDictionary *opts;
+    int64_t url_offset;
+    int64_t size;
+    int is_http;
+    AVIOInterruptCB interrupt_callback;
+    int fifo_size;
+
+    /* the following fields are protected by the pool mutex */
+    AVFifo *fifo;
+    /* cookies set by the server, taken back by the demuxer */
+    char *cookies;
+    int running;
+    int opened;
+    int abort_request;
+    /* 0 while queued or downloading, AVERROR_EOF or an error code once finished */
+    int ret;
+};
+
+/*
+ * Worker threads downloading the queued slots of a playlist in sequence
+ * order. As the slot being read always comes first, it always gets a worker,
+ * even when the others wait for their FIFOs to be read.
+ */
+struct prefetch_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t threads[MAX_PREFETCH_THREADS];
+    int nb_threads;
+    int exit;
+};
+
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct prefetch_slot *slot = opaque;
+    struct prefetch_pool *pool = slot->pls->prefetch_pool;
+    HLSContext *c = slot->pls->parent->priv_data;
+    int abort_request;
+
+    pthread_mutex_lock(&pool->mutex);
+    abort_request = slot->abort_request;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return abort_request || ff_check_interrupt(c->interrupt_callback);
+}
+
+/* Download a slot, called by a worker with the pool mutex held. */
+static void prefetch_download(struct prefetch_pool *pool, struct prefetch_slot *slot)
+{
+    AVFormatContext *s = slot->pls->parent;
+    AVIOContext *in = NULL;
+    uint8_t buf[INITIAL_BUFFER_SIZE];
+    char *cookies = NULL;
+    int64_t left = slot->size;
+    int ret;
+
+    pthread_mutex_unlock(&pool->mutex);
+    ret = ffio_open_whitelist(&in, slot->url, AVIO_FLAG_READ,
+                              &slot->interrupt_callback, &slot->opts,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    /* see open_url() and open_input() */
+    if (ret >= 0)
+        av_opt_get(in, "cookies", AV_OPT_SEARCH_CHILDREN, (uint8_t **)&cookies);
+    if (ret >= 0 && !slot->is_http && slot->url_offset) {
+        int64_t seekret = avio_seek(in, slot->url_offset, SEEK_SET);
+        if (seekret < 0)
+            ret = seekret;
+    }
+    if (ret >= 0 && !(slot->fifo = av_fifo_alloc2(slot->fifo_size, 1, 0)))
+        ret = AVERROR(ENOMEM);
+
+    pthread_mutex_lock(&pool->mutex);
+    slot->cookies = cookies;
+    slot->opened  = ret >= 0;
+    while (ret >= 0) {
+        int size = sizeof(buf);
+
+        pthread_cond_broadcast(&pool->cond);
+        while (!slot->abort_request && av_fifo_can_write(slot->fifo) < sizeof(buf))
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        if (slot->abort_request) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (left >= 0)
+            size = FFMIN(size, left);
+        ret = size ? avio_read(in, buf, size) : AVERROR_EOF;
+
+        pthread_mutex_lock(&pool->mutex);
+        if (ret > 0) {
+            av_fifo_write(slot->fifo, buf, ret);
+            if (left >= 0)
+                left -= ret;
+        }
+    }
+    slot->ret = ret ? ret : AVERROR_EOF;
+
+    /* failures to open are reported by the reader */
+    if (slot->opened && ret != AVERROR_EOF && ret != AVERROR_EXIT)
+        av_log(s, AV_LOG_WARNING, "Prefetching segment %"PRId64" of playlist %d failed: %s\n",
+               slot->seq_no, slot->pls->index, av_err2str(ret));
+
+    pthread_mutex_unlock(&pool->mutex);
+    avio_closep(&in);
+    pthread_mutex_lock(&pool->mutex);
+}
+
+static void *prefetch_worker(void *arg)
+{
+    struct playlist *pls = arg;
+    struct prefetch_pool *pool = pls->prefetch_pool;
+
+    ff_thread_setname("hls-prefetch");
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->exit) {
+        struct prefetch_slot *slot = NULL;
+
+        for (int i = 0; i < pls->n_prefetch; i++) {
+            if (!pls->prefetch[i]->running && !pls->prefetch[i]->ret) {
+                slot = pls->prefetch[i];
+                break;
+            }
+        }
+        if (!slot) {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            continue;
+        }
+
+        slot->running = 1;
+        prefetch_download(pool, slot);
+        slot->running = 0;
+        pthread_cond_broadcast(&pool->cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static void prefetch_pool_free(struct playlist *pls)
+{
+    struct prefetch_pool *pool = pls->prefetch_pool;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->exit = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    av_freep(&pls->prefetch_pool);
+}
+
+static int prefetch_pool_init(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch_pool *pool;
+    const int nb_threads = FFMIN(c->prefetch_segments + 1, MAX_PREFETCH_THREADS);
+    int ret;
+
+    if (pls->prefetch_pool)
+        return 0;
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&pool->mutex, NULL))) {
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pool->cond, NULL))) {
+        pthread_mutex_destroy(&pool->mutex);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    pls->prefetch_pool = pool;
+
+    for (; pool->nb_threads < nb_threads; pool->nb_threads++) {
+        ret = pthread_create(&pool->threads[pool->nb_threads], NULL, prefetch_worker, pls);
+        if (ret) {
+            prefetch_pool_free(pls);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+
+static int prefetch_read(void *opaque, uint8_t *buf, int buf_size)
+{
+    struct prefetch_slot *slot = opaque;
+    struct prefetch_pool *pool = slot->pls->prefetch_pool;
+    int ret;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (!av_fifo_can_read(slot->fifo) && !slot->ret)
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    ret = FFMIN(buf_size, av_fifo_can_read(slot->fifo));
+    if (ret) {
+        av_fifo_read(slot->fifo, buf, ret);
+        pthread_cond_broadcast(&pool->cond);
+    } else {
+        ret = slot->ret;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return ret;
+}
+
+/* Free a slot which is not in pls->prefetch anymore, stopping its download. */
+static void prefetch_free(struct prefetch_slot **pslot)
+{
+    struct prefetch_slot *slot = *pslot;
+    struct prefetch_pool *pool;
+
+    if (!slot)
+        return;
+    pool = slot->pls->prefetch_pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    slot->abort_request = 1;
+    pthread_cond_broadcast(&pool->cond);
+    while (slot->running)
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    av_fifo_freep2(&slot->fifo);
+    av_dict_free(&slot->opts);
+    av_freep(&slot->cookies);
+    av_freep(&slot->url);
+    av_freep(pslot);
+}
+
+static void prefetch_cancel(struct playlist *pls)
+{
+    struct prefetch_slot **slots;
+    int nb_slots;
+
+    if (!pls->prefetch_pool)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_pool->mutex);
+    slots    = pls->prefetch;
+    nb_slots = pls->n_prefetch;
+    pls->prefetch   = NULL;
+    pls->n_prefetch = 0;
+    pthread_mutex_unlock(&pls->prefetch_pool->mutex);
+
+    for (int i = 0; i < nb_slots; i++)
+        prefetch_free(&slots[i]);
+    av_free(slots);
+}
+
+static int prefetch_start(HLSContext *c, struct playlist *pls,
+                          int64_t seq_no, struct segment *seg)
+{
+    struct prefetch_slot *slot;
+    char url[MAX_URL_SIZE];
+    uint8_t key[16] = { 0 };
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if (seg->key_type == KEY_AES_128) {
+        /* pls->key must stay that of the segment being read */
+        if (!strcmp(seg->key, pls->key_url)) {
+            memcpy(key, pls->key, sizeof(key));
+        } else {
+            if (strcmp(seg->key, pls->prefetch_key_url)) {
+                ret = read_key_data(c, pls, seg, pls->prefetch_key);
+                if (ret < 0)
+                    return ret;
+                av_strlcpy(pls->prefetch_key_url, seg->key, sizeof(pls->prefetch_key_url));
+            }
+            memcpy(key, pls->prefetch_key, sizeof(key));
+        }
+    }
+
+    slot = av_mallocz(sizeof(*slot));
+    if (!slot)
+        return AVERROR(ENOMEM);
+    slot->pls        = pls;
+    slot->seq_no     = seq_no;
+    slot->url_offset = seg->url_offset;
+    slot->size       = seg->size;
+    slot->fifo_size  = FFMAX(c->prefetch_buffer_size, 2 * INITIAL_BUFFER_SIZE);
+    slot->interrupt_callback = (AVIOInterruptCB){ prefetch_interrupt_cb, slot };
+
+    segment_request(c, seg, key, url, sizeof(url), &opts);
+    ret = check_url(pls->parent, url, &slot->is_http);
+    if (ret < 0)
+        goto fail;
+    slot->url = av_strdup(url);
+    if (!slot->url ||
+        (ret = av_dict_copy(&slot->opts, c->avio_opts, 0)) < 0 ||
+        (ret = av_dict_copy(&slot->opts, opts, 0)) < 0) {
+        ret = ret < 0 ? ret : AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+           seg->url, seg->url_offset, pls->index);
+
+    pthread_mutex_lock(&pls->prefetch_pool->mutex);
+    ret = av_dynarray_add_nofree(&pls->prefetch, &pls->n_prefetch, slot);
+    if (ret >= 0)
+        pthread_cond_broadcast(&pls->prefetch_pool->cond);
+    pthread_mutex_unlock(&pls->prefetch_pool->mutex);
+    if (ret < 0)
+        goto fail;
+    av_dict_free(&opts);
+    return 0;
+
+fail:
+    av_dict_free(&opts);
+    av_dict_free(&slot->opts);
+    av_free(slot->url);
+    av_free(slot);
+    return ret;
+}
+
+/* keep n segments from seq_no on downloading, stopping at ones that cannot be */
+static void prefetch_fill(HLSContext *c, struct playlist *pls, int64_t seq_no, int n)
+{
+    if (pls->n_prefetch && pls->prefetch[0]->seq_no != seq_no)
+        prefetch_cancel(pls);
+
+    for (seq_no += pls->n_prefetch; pls->n_prefetch < n; seq_no++) {
+        int64_t i = seq_no - pls->start_seq_no;
+        struct segment *seg;
+
+        if (i < 0 || i >= pls->n_segments)
+            break;
+        seg = pls->segments[i];
+        /* SAMPLE-AES segments are decrypted with pls->key while demuxing */
+        if (seg->key_type == KEY_SAMPLE_AES)
+            break;
+        if (prefetch_start(c, pls, seq_no, seg) < 0)
+            break;
+    }
+}
+
+/*
+ * Open the current segment from its prefetch slot, if it has one, and
+ * start downloading the following ones.
+ */
+static int prefetch_open(HLSContext *c, struct playlist *pls,
+                         struct segment *seg, AVIOContext **in)
+{
+    struct prefetch_pool *pool;
+    struct prefetch_slot *slot;
+    uint8_t *buffer;
+    int ret;
+
+    if (prefetch_pool_init(c, pls) < 0)
+        return open_input(c, pls, seg, in);
+    pool = pls->prefetch_pool;
+
+    prefetch_fill(c, pls, pls->cur_seq_no, c->prefetch_segments + 1);
+    if (!pls->n_prefetch)
+        return open_input(c, pls, seg, in);
+
+    pthread_mutex_lock(&pool->mutex);
+    slot = pls->prefetch[0];
+    /* workers only pick up slots which are still queued in pls->prefetch */
+    while (!slot->opened && !slot->ret)
+        pthread_cond_wait(&pool->cond, &pool->mutex);
+    memmove(pls->prefetch, pls->prefetch + 1, --pls->n_prefetch * sizeof(*pls->prefetch));
+    ret = slot->opened ? 0 : slot->ret;
+    /* update cookies on http response with setcookies, as open_url() does */
+    if (slot->cookies) {
+        av_dict_set(&c->avio_opts, "cookies", slot->cookies, AV_DICT_DONT_STRDUP_VAL);
+        slot->cookies = NULL;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    if (ret < 0) {
+        prefetch_free(&slot);
+        return ret;
+    }
+
+    /* a connection kept alive for the previous segment is not needed */
+    ff_format_io_close(pls->parent, in);
+
+    buffer = av_malloc(INITIAL_BUFFER_SIZE);
+    if (buffer)
+        *in = avio_alloc_context(buffer, INITIAL_BUFFER_SIZE, 0, slot,
+                                 prefetch_read, NULL, NULL);
+    if (!*in) {
+        av_free(buffer);
+        prefetch_free(&slot);
+        return AVERROR(ENOMEM);
+    }
+    pls->input_slot = slot;
+    pls->cur_seg_offset = 0;
+
+    prefetch_fill(c, pls, pls->cur_seq_no + 1, c->prefetch_segments);
+
+    return 0;
+}
+#else
+static void prefetch_free(struct prefetch_slot **pslot)
+{
+}
+
+static void prefetch_pool_free(struct playlist *pls)
+{
+}
+
+static void prefetch_cancel(struct playlist *pls)
+{
+}
+
+static int prefetch_open(HLSContext *c, struct playlist *pls,
+                         struct segment *seg, AVIOContext **in)
+{
+    return open_input(c, pls, seg, in);
+}
+#endif
+
+static void close_input(struct playlist *pls)
+{
+    if (pls->input_slot) {
+        av_freep(&pls->input->buffer);
+        avio_context_free(&pls->input);
+        prefetch_free(&pls->input_slot);
+    } else {
+        ff_format_io_close(pls->parent, &pls->input);
+    }
+}
+
 static int update_init_section(struct playlist *pls, struct segment *seg)
 {
     static const int max_init_section_size = 1024*1024;
@@ -1662,6 +2170,8 @@ restart:
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
             ret = 0;
+        } else if (c->prefetch_segments) {
+            ret = prefetch_open(c, v, seg, &v->input);
         } else {
             ret = open_input(c, v, seg, &v->input);
         }
@@ -1686,7 +2196,7 @@ restart:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && !v->input_slot) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1696,7 +2206,7 @@ restart:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !c->prefetch_segments && !v->input_next_requested &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1729,11 +2239,11 @@ restart:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (c->http_persistent && !v->input_slot &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
-        ff_format_io_close(v->parent, &v->input);
+        close_input(v);
     }
     v->cur_seq_no++;
 
@@ -2133,6 +2643,13 @@ static int hls_read_header(AVFormatContext *s)
     c->first_timestamp = AV_NOPTS_VALUE;
     c->cur_timestamp = AV_NOPTS_VALUE;
 
+    if (c->prefetch_segments && !ff_format_io_is_default(s)) {
+        /* the workers would call them concurrently with the demuxer */
+        av_log(s, AV_LOG_WARNING,
+               "Prefetching is not supported with custom I/O callbacks, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = ffio_copy_url_options(s->pb, &c->avio_opts)) < 0)
         return ret;
 
@@ -2278,8 +2795,8 @@ static int hls_read_header(AVFormatContext *s)
             }
             ret = 0;
             /* Reset reading */
-            ff_format_io_close(pls->parent, &pls->input);
-            pls->input = NULL;
+            close_input(pls);
+            prefetch_cancel(pls);
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next = NULL;
@@ -2449,7 +2966,8 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %"PRId64"\n", i, pls->cur_seq_no);
         } else if (first && !cur_needed && pls->needed) {
-            ff_format_io_close(pls->parent, &pls->input);
+            close_input(pls);
+            prefetch_cancel(pls);
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
@@ -2710,7 +3228,8 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
         AVIOContext *const pb = &pls->pb.pub;
-        ff_format_io_close(pls->parent, &pls->input);
+        close_input(pls);
+        prefetch_cancel(pls);
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
@@ -2816,6 +3335,8 @@ static const AVOption hls_options[] = {
         OFFSET(m3u8_hold_counters), AV_OPT_TYPE_INT, {.i64 = 1000}, 0, INT_MAX, FLAGS},
     {"http_persistent", "Use persistent HTTP connections",
         OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, FLAGS },
+    {"http_connection_pool", "Share idle persistent HTTP connections with other requests",
+        OFFSET(http_connection_pool), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
     {"http_multiple", "Use multiple HTTP connections for fetching segments",
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
@@ -2824,6 +3345,10 @@ static const AVOption hls_options[] = {
         OFFSET(seg_format_opts), AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, FLAGS},
     {"seg_max_retry", "Maximum number of times to reload a segment on error.",
      OFFSET(seg_max_retry), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS},
+    {"prefetch_segments", "Number of segments to download ahead of the one being read",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"prefetch_buffer_size", "Maximum number of bytes buffered for each prefetched segment",
+        OFFSET(prefetch_buffer_size), AV_OPT_TYPE_INT, {.i64 = 4 * 1024 * 1024}, 0, INT_MAX, FLAGS},
     {NULL}
 };
 
@@ -32,11 +32,13 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
+#include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/log.h"
 #include "libavutil/random_seed.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
 
@@ -190,6 +192,59 @@ typedef struct VariantStream {
     const char *subtitle_varname;  /* subtitle variant name */
 } VariantStream;
 
+#if HAVE_THREADS
+/* a file written to memory by the muxer, queued for writing once closed */
+typedef struct HLSPendingFile {
+    AVIOContext **pb;
+    char *url;
+    AVDictionary *options;
+} HLSPendingFile;
+
+enum HLSIOJobType {
+    HLS_IO_WRITE,
+    HLS_IO_RENAME,
+    HLS_IO_UNLINK,
+};
+
+typedef struct HLSIOJob {
+    enum HLSIOJobType type;
+    char *url;
+    char *new_url;
+    AVDictionary *options;
+    uint8_t *data;
+    int size;
+    int64_t queue_time;
+} HLSIOJob;
+
+/*
+ * Files are written, renamed and deleted by a single background thread in
+ * the order the muxer queued them, so that playlists are never updated
+ * before the segments they list are complete.
+ */
+typedef struct HLSIOQueue {
+    AVFormatContext *s;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    AVFifo *jobs;
+    int exit;
+    int error;
+
+    HLSPendingFile *pending;
+    int nb_pending;
+
+    /* used by the I/O thread only */
+    AVIOContext *out;
+    AVIOContext *http_delete;
+
+    int nb_written;
+    int64_t bytes_written;
+    int64_t total_lag;
+    int64_t max_lag;
+    int nb_stalls;
+} HLSIOQueue;
+#endif
+
 typedef struct ClosedCaptionsStream {
     const char *ccgroup;    /* closed caption group name */
     const char *instreamid; /* closed captions INSTREAM-ID */
@@ -261,6 +316,10 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+    int io_queue_size;
+#if HAVE_THREADS
+    HLSIOQueue *io;
+#endif
 } HLSContext;
 
 static int strftime_expand(const char *fmt, char **dest)
@@ -286,8 +345,8 @@ static int strftime_expand(const char *fmt, char **dest)
     return r;
 }
 
-static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
-                          AVDictionary **options)
+static int hlsenc_io_open_url(AVFormatContext *s, AVIOContext **pb, const char *filename,
+                              AVDictionary **options)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
@@ -307,7 +366,7 @@ static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *file
     return err;
 }
 
-static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
+static int hlsenc_io_close_url(AVFormatContext *s, AVIOContext **pb, const char *filename)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
@@ -327,6 +386,294 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     return ret;
 }
 
+#if HAVE_THREADS
+static void hls_io_job_free(HLSIOJob *job)
+{
+    av_freep(&job->url);
+    av_freep(&job->new_url);
+    av_dict_free(&job->options);
+    av_freep(&job->data);
+}
+
+static int hls_io_write(HLSIOQueue *io, HLSIOJob *job)
+{
+    AVFormatContext *s = io->s;
+    AVDictionaryEntry *method = av_dict_get(job->options, "method", NULL, 0);
+    /* persistent connections cannot change the method, see hls_delete_file() */
+    AVIOContext **pb = method && !strcmp(method->value, "DELETE") ? &io->http_delete : &io->out;
+    AVDictionary *options = NULL;
+    int ret;
+
+    if (*pb && !ff_is_http_proto(job->url))
+        ff_format_io_close(s, pb);
+
+    av_dict_copy(&options, job->options, 0);
+    ret = hlsenc_io_open_url(s, pb, job->url, &options);
+    av_dict_free(&options);
+    if (ret < 0)
+        goto fail;
+    avio_write(*pb, job->data, job->size);
+    ret = hlsenc_io_close_url(s, pb, job->url);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "upload of '%s' failed,"
+               " will retry with a new http session.\n", job->url);
+        ff_format_io_close(s, pb);
+        av_dict_copy(&options, job->options, 0);
+        ret = hlsenc_io_open_url(s, pb, job->url, &options);
+        av_dict_free(&options);
+        if (ret >= 0) {
+            avio_write(*pb, job->data, job->size);
+            ret = hlsenc_io_close_url(s, pb, job->url);
+        }
+    }
+
+fail:
+    if (ret < 0)
+        av_log(s, AV_LOG_ERROR, "Failed to write '%s': %s\n",
+               job->url, av_err2str(ret));
+    return ret;
+}
+
+static void *hls_io_thread(void *arg)
+{
+    HLSIOQueue *io = arg;
+    HLSIOJob job;
+
+    pthread_mutex_lock(&io->mutex);
+    while (1) {
+        int64_t lag;
+        int ret = 0;
+
+        while (!av_fifo_can_read(io->jobs) && !io->exit)
+            pthread_cond_wait(&io->cond, &io->mutex);
+        /* only exit once everything queued has been written */
+        if (av_fifo_peek(io->jobs, &job, 1, 0) < 0)
+            break;
+        pthread_mutex_unlock(&io->mutex);
+
+        switch (job.type) {
+        case HLS_IO_WRITE:
+            ret = hls_io_write(io, &job);
+            break;
+        case HLS_IO_RENAME:
+            ff_rename(job.url, job.new_url, io->s);
+            break;
+        case HLS_IO_UNLINK:
+            if (unlink(job.url) < 0)
+                av_log(io->s, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
+                       job.url, strerror(errno));
+            break;
+        }
+
+        lag = av_gettime_relative() - job.queue_time;
+        if (job.type == HLS_IO_WRITE && ret >= 0)
+            av_log(io->s, AV_LOG_DEBUG, "Wrote '%s', %d bytes, %.3fs after it was completed\n",
+                   job.url, job.size, lag / 1000000.0);
+
+        pthread_mutex_lock(&io->mutex);
+        av_fifo_drain2(io->jobs, 1);
+        if (job.type == HLS_IO_WRITE) {
+            io->nb_written++;
+            io->bytes_written += job.size;
+            io->total_lag     += lag;
+            io->max_lag        = FFMAX(io->max_lag, lag);
+        }
+        if (ret < 0 && !io->error)
+            io->error = ret;
+        hls_io_job_free(&job);
+        pthread_cond_broadcast(&io->cond);
+    }
+    pthread_mutex_unlock(&io->mutex);
+
+    return NULL;
+}
+
+static int hls_io_queue(HLSContext *hls, HLSIOJob *job)
+{
+    HLSIOQueue *io = hls->io;
+    int ret;
+
+    job->queue_time = av_gettime_relative();
+
+    pthread_mutex_lock(&io->mutex);
+    if (!av_fifo_can_write(io->jobs)) {
+        io->nb_stalls++;
+        av_log(hls, AV_LOG_WARNING, "Output is lagging behind, waiting for "
+               "%zu queued files to be written\n", av_fifo_can_read(io->jobs));
+        while (!av_fifo_can_write(io->jobs))
+            pthread_cond_wait(&io->cond, &io->mutex);
+    }
+    ret = hls->ignore_io_errors ? 0 : io->error;
+    if (ret >= 0) {
+        av_fifo_write(io->jobs, job, 1);
+        pthread_cond_broadcast(&io->cond);
+    }
+    pthread_mutex_unlock(&io->mutex);
+
+    if (ret < 0)
+        hls_io_job_free(job);
+    return ret;
+}
+
+static int hls_io_flush(HLSContext *hls)
+{
+    HLSIOQueue *io = hls->io;
+    int ret;
+
+    pthread_mutex_lock(&io->mutex);
+    while (av_fifo_can_read(io->jobs))
+        pthread_cond_wait(&io->cond, &io->mutex);
+    ret = hls->ignore_io_errors ? 0 : io->error;
+    pthread_mutex_unlock(&io->mutex);
+
+    return ret;
+}
+
+static int hls_io_init(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    HLSIOQueue *io;
+    int ret;
+
+    io = av_mallocz(sizeof(*io));
+    if (!io)
+        return AVERROR(ENOMEM);
+    io->s    = s;
+    io->jobs = av_fifo_alloc2(hls->io_queue_size, sizeof(HLSIOJob), 0);
+    if (!io->jobs) {
+        av_free(io);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&io->mutex, NULL);
+    pthread_cond_init(&io->cond, NULL);
+
+    ret = pthread_create(&io->thread, NULL, hls_io_thread, io);
+    if (ret) {
+        pthread_cond_destroy(&io->cond);
+        pthread_mutex_destroy(&io->mutex);
+        av_fifo_freep2(&io->jobs);
+        av_free(io);
+        return AVERROR(ret);
+    }
+    hls->io = io;
+
+    return 0;
+}
+
+static void hls_io_uninit(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    HLSIOQueue *io = hls->io;
+
+    if (!io)
+        return;
+
+    /* files still in memory were never completed */
+    for (int i = 0; i < io->nb_pending; i++) {
+        ffio_free_dyn_buf(io->pending[i].pb);
+        av_free(io->pending[i].url);
+        av_dict_free(&io->pending[i].options);
+    }
+    av_freep(&io->pending);
+
+    pthread_mutex_lock(&io->mutex);
+    io->exit = 1;
+    pthread_cond_broadcast(&io->cond);
+    pthread_mutex_unlock(&io->mutex);
+    pthread_join(io->thread, NULL);
+
+    ff_format_io_close(s, &io->out);
+    ff_format_io_close(s, &io->http_delete);
+
+    if (io->nb_written)
+        av_log(s, AV_LOG_VERBOSE, "Background I/O: %d files, %"PRId64" bytes written, "
+               "lag %.3fs on average and %.3fs at most, muxer blocked %d times\n",
+               io->nb_written, io->bytes_written,
+               io->total_lag / 1000000.0 / io->nb_written, io->max_lag / 1000000.0,
+               io->nb_stalls);
+
+    av_fifo_freep2(&io->jobs);
+    pthread_cond_destroy(&io->cond);
+    pthread_mutex_destroy(&io->mutex);
+    av_freep(&hls->io);
+}
+#endif
+
+static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
+                          AVDictionary **options)
+{
+#if HAVE_THREADS
+    HLSContext *hls = s->priv_data;
+    HLSIOQueue *io = hls->io;
+
+    /* write to memory, the file is queued for writing once closed */
+    if (io) {
+        HLSPendingFile *f;
+        int ret;
+
+        if ((ret = avio_open_dyn_buf(pb)) < 0)
+            return ret;
+        f = av_dynarray2_add((void **)&io->pending, &io->nb_pending, sizeof(*f), NULL);
+        if (!f) {
+            ffio_free_dyn_buf(pb);
+            return AVERROR(ENOMEM);
+        }
+        f->pb      = pb;
+        f->url     = av_strdup(filename);
+        f->options = NULL;
+        if (!f->url || av_dict_copy(&f->options, options ? *options : NULL, 0) < 0) {
+            av_freep(&f->url);
+            av_dict_free(&f->options);
+            io->nb_pending--;
+            ffio_free_dyn_buf(pb);
+            return AVERROR(ENOMEM);
+        }
+        return 0;
+    }
+#endif
+    return hlsenc_io_open_url(s, pb, filename, options);
+}
+
+static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
+{
+#if HAVE_THREADS
+    HLSContext *hls = s->priv_data;
+    HLSIOQueue *io = hls->io;
+
+    for (int i = 0; io && *pb && i < io->nb_pending; i++) {
+        HLSIOJob job = { HLS_IO_WRITE };
+
+        if (io->pending[i].pb != pb)
+            continue;
+        job.url     = io->pending[i].url;
+        job.options = io->pending[i].options;
+        io->pending[i] = io->pending[--io->nb_pending];
+        job.size = avio_close_dyn_buf(*pb, &job.data);
+        *pb = NULL;
+        return hls_io_queue(hls, &job);
+    }
+#endif
+    return hlsenc_io_close_url(s, pb, filename);
+}
+
+static int hlsenc_rename(HLSContext *hls, const char *url_src, const char *url_dst)
+{
+#if HAVE_THREADS
+    if (hls->io) {
+        HLSIOJob job = { HLS_IO_RENAME };
+
+        job.url     = av_strdup(url_src);
+        job.new_url = av_strdup(url_dst);
+        if (!job.url || !job.new_url) {
+            hls_io_job_free(&job);
+            return AVERROR(ENOMEM);
+        }
+        return hls_io_queue(hls, &job);
+    }
+#endif
+    return ff_rename(url_src, url_dst, hls);
+}
+
 static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSContext *c)
 {
     int http_base_proto = ff_is_http_proto(s->url);
@@ -518,6 +865,15 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
 
         //Nothing to write
         hlsenc_io_close(avf, &hls->http_delete, path);
+#if HAVE_THREADS
+    } else if (hls->io) {
+        HLSIOJob job = { HLS_IO_UNLINK };
+
+        job.url = av_strdup(path);
+        if (!job.url)
+            return AVERROR(ENOMEM);
+        return hls_io_queue(hls, &job);
+#endif
     } else if (unlink(path) < 0) {
         av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
                path, strerror(errno));
@@ -980,7 +1336,7 @@ static int sls_flag_check_duration_size(HLSContext *hls, VariantStream *vs)
 static void sls_flag_file_rename(HLSContext *hls, VariantStream *vs, char *old_filename) {
     if ((hls->flags & (HLS_SECOND_LEVEL_SEGMENT_SIZE | HLS_SECOND_LEVEL_SEGMENT_DURATION)) &&
         strlen(vs->current_segment_final_filename_fmt)) {
-        ff_rename(old_filename, vs->avf->url, hls);
+        hlsenc_rename(hls, old_filename, vs->avf->url);
     }
 }
 
@@ -1292,7 +1648,7 @@ static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
     if (!final_filename)
         return AVERROR(ENOMEM);
     final_filename[len-4] = '\0';
-    ret = ff_rename(oc->url, final_filename, s);
+    ret = hlsenc_rename(s->priv_data, oc->url, final_filename);
     oc->url[len-4] = '\0';
     av_freep(&final_filename);
     return ret;
@@ -1509,7 +1865,7 @@ fail:
         hls->master_m3u8_created = 1;
     hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
     if (use_temp_file)
-        ff_rename(temp_filename, hls->master_m3u8_url, s);
+        hlsenc_rename(hls, temp_filename, hls->master_m3u8_url);
 
     return ret;
 }
@@ -1647,9 +2003,9 @@ fail:
     }
     hlsenc_io_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
     if (use_temp_file) {
-        ff_rename(temp_filename, vs->m3u8_name, s);
+        hlsenc_rename(hls, temp_filename, vs->m3u8_name);
         if (vs->vtt_m3u8_name)
-            ff_rename(temp_vtt_filename, vs->vtt_m3u8_name, s);
+            hlsenc_rename(hls, temp_vtt_filename, vs->vtt_m3u8_name);
     }
     if (ret >= 0 && hls->master_pl_name)
         if (create_master_playlist(s, vs, last) < 0)
@@ -2682,6 +3038,10 @@ static void hls_deinit(AVFormatContext *s)
     int i = 0;
     VariantStream *vs = NULL;
 
+#if HAVE_THREADS
+    hls_io_uninit(s);
+#endif
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2763,7 +3123,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
                 vs->start_pos = range_length;
                 byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
                 if (!byterange_mode) {
-                    ff_format_io_close(s, &vs->out);
+                    hlsenc_io_close(s, &vs->out, NULL);
                     hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
                 }
             }
@@ -2833,7 +3193,7 @@ failed:
             if (vtt_oc->pb)
                 av_write_trailer(vtt_oc);
             vs->size = avio_tell(vs->vtt_avf->pb) - vs->start_pos;
-            ff_format_io_close(s, &vtt_oc->pb);
+            hlsenc_io_close(s, &vtt_oc->pb, NULL);
         }
         ret = hls_window(s, 1, vs);
         if (ret < 0) {
@@ -2846,6 +3206,10 @@ failed:
         av_free(old_filename);
     }
 
+#if HAVE_THREADS
+    if (hls->io)
+        return hls_io_flush(hls);
+#endif
     return 0;
 }
 
@@ -2885,6 +3249,24 @@ static int hls_init(AVFormatContext *s)
         av_log(hls, AV_LOG_WARNING, "No HTTP method set, hls muxer defaulting to method PUT.\n");
     }
 
+    if (hls->io_queue_size) {
+        if (hls->flags & HLS_SINGLE_FILE) {
+            av_log(hls, AV_LOG_WARNING, "io_queue_size is not supported with single_file, "
+                   "writing synchronously.\n");
+        } else if (!ff_format_io_is_default(s)) {
+            /* the I/O thread would call them concurrently with the muxer */
+            av_log(hls, AV_LOG_WARNING, "io_queue_size is not supported with custom I/O "
+                   "callbacks, writing synchronously.\n");
+        } else {
+#if HAVE_THREADS
+            if ((ret = hls_io_init(s)) < 0)
+                return ret;
+#else
+            av_log(hls, AV_LOG_WARNING, "io_queue_size requires threads, writing synchronously.\n");
+#endif
+        }
+    }
+
     ret = validate_name(hls->nb_varstreams, s->url);
     if (ret < 0)
         return ret;
@@ -3162,6 +3544,7 @@ static const AVOption options[] = {
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
+    {"io_queue_size", "number of completed files that may wait to be written by a background thread, 0 to write them inline", OFFSET(io_queue_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, E },
     { NULL },
 };
 
@@ -37,6 +37,7 @@
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
 
@@ -62,6 +63,8 @@
 #define HTTP_MUTLI    2
 #define MAX_DATE_LEN  19
 #define WHITESPACES " \n\t\r"
+#define POOL_MAX_IDLE     16
+#define POOL_IDLE_TIMEOUT (30 * 1000000)
 typedef enum {
     LOWER_PROTO,
     READ_HEADERS,
@@ -69,9 +72,35 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/**
+ * A connection opened with connection_pool, see http_pool_open().
+ */
+typedef struct HTTPPoolConn {
+    /* Interrupt callback of the context using the connection; the lower
+     * protocols were opened with pool_interrupt_cb() forwarding to it, as
+     * they may outlive the context which opened them. */
+    AVIOInterruptCB int_cb;
+    /* lower protocol URL and options */
+    char *key;
+    /* options the lower protocols did not consume when opened */
+    AVDictionary *unused_options;
+    /* only set while idle in the pool */
+    URLContext *hd;
+    int64_t idle_since;
+    struct HTTPPoolConn *next;
+} HTTPPoolConn;
+
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+static HTTPPoolConn *pool;
+static int pool_size;
+/* number of avformat_network_init() calls not matched by a deinit yet */
+static int pool_refs;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
+    /* set if hd was opened for the connection pool */
+    HTTPPoolConn *conn;
     unsigned char buffer[BUFFER_SIZE], *buf_ptr, *buf_end;
     int line_count;
     int http_code;
@@ -146,6 +175,7 @@ typedef struct HTTPContext {
     unsigned int retry_after;
     int reconnect_max_retries;
     int reconnect_delay_total_max;
+    int connection_pool;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -191,6 +221,7 @@ static const AVOption options[] = {
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
     { "short_seek_size", "Threshold to favor readahead over seek.", OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "connection_pool", "reuse idle persistent connections of other contexts to the same server", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { NULL }
 };
 
@@ -210,6 +241,203 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+static int pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return ff_check_interrupt(&conn->int_cb);
+}
+
+static void pool_conn_free(HTTPPoolConn *conn)
+{
+    ffurl_closep(&conn->hd);
+    av_freep(&conn->key);
+    av_dict_free(&conn->unused_options);
+    av_free(conn);
+}
+
+static void pool_conn_free_list(HTTPPoolConn *conn)
+{
+    while (conn) {
+        HTTPPoolConn *next = conn->next;
+        pool_conn_free(conn);
+        conn = next;
+    }
+}
+
+/**
+ * Unlink the connections idle for longer than POOL_IDLE_TIMEOUT, or all of
+ * them if now is INT64_MAX. Must be called with pool_mutex held.
+ *
+ * @return the list of unlinked connections, to be freed without the lock
+ */
+static HTTPPoolConn *pool_unlink_expired(int64_t now)
+{
+    HTTPPoolConn *expired = NULL, **p;
+
+    for (p = &pool; *p;) {
+        HTTPPoolConn *cur = *p;
+        if (now - cur->idle_since > POOL_IDLE_TIMEOUT) {
+            *p = cur->next;
+            cur->next = expired;
+            expired   = cur;
+            pool_size--;
+        } else
+            p = &cur->next;
+    }
+    return expired;
+}
+
+void ff_http_pool_init(void)
+{
+    ff_mutex_lock(&pool_mutex);
+    pool_refs++;
+    ff_mutex_unlock(&pool_mutex);
+}
+
+void ff_http_pool_uninit(void)
+{
+    HTTPPoolConn *expired = NULL;
+
+    ff_mutex_lock(&pool_mutex);
+    if (pool_refs > 0)
+        pool_refs--;
+    if (!pool_refs)
+        expired = pool_unlink_expired(INT64_MAX);
+    ff_mutex_unlock(&pool_mutex);
+
+    pool_conn_free_list(expired);
+}
+
+static void http_close_cnx(HTTPContext *s)
+{
+    ffurl_closep(&s->hd);
+    if (s->conn) {
+        pool_conn_free(s->conn);
+        s->conn = NULL;
+    }
+}
+
+/**
+ * Open the connection to lower_url for s->hd, reusing an idle connection
+ * from the process-wide pool opened with the same options if reused is set.
+ * On reuse, options is replaced by the options the lower protocols did not
+ * consume when the connection was opened, as if it had been opened again.
+ */
+static int http_pool_open(URLContext *h, const char *lower_url,
+                          AVDictionary **options, int *reused)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConn *conn = NULL, *expired, **p;
+    int64_t now = av_gettime_relative();
+    char *opts = NULL, *key;
+    int err;
+
+    if ((err = av_dict_get_string(*options, &opts, '=', ',')) < 0)
+        return err;
+    key = av_asprintf("%s %s", lower_url, opts);
+    av_free(opts);
+    if (!key)
+        return AVERROR(ENOMEM);
+
+    if (reused) {
+        ff_mutex_lock(&pool_mutex);
+        expired = pool_unlink_expired(now);
+        for (p = &pool; *p; p = &(*p)->next) {
+            if (!strcmp((*p)->key, key)) {
+                conn = *p;
+                *p   = conn->next;
+                pool_size--;
+                break;
+            }
+        }
+        ff_mutex_unlock(&pool_mutex);
+
+        pool_conn_free_list(expired);
+    }
+
+    if (conn) {
+        AVDictionary *unused = NULL;
+
+        av_free(key);
+        if (av_dict_copy(&unused, conn->unused_options, 0) < 0) {
+            av_dict_free(&unused);
+            pool_conn_free(conn);
+            return AVERROR(ENOMEM);
+        }
+        av_dict_free(options);
+        *options = unused;
+        av_log(h, AV_LOG_DEBUG, "Reusing connection to %s\n", lower_url);
+        conn->int_cb = h->interrupt_callback;
+        conn->next   = NULL;
+        s->hd    = conn->hd;
+        conn->hd = NULL;
+        s->conn  = conn;
+        *reused  = 1;
+        return 0;
+    }
+
+    conn = av_mallocz(sizeof(*conn));
+    if (!conn) {
+        av_free(key);
+        return AVERROR(ENOMEM);
+    }
+    conn->key    = key;
+    conn->int_cb = h->interrupt_callback;
+    err = ffurl_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                               &(const AVIOInterruptCB){ pool_interrupt_cb, conn },
+                               options, h->protocol_whitelist,
+                               h->protocol_blacklist, h);
+    if (err < 0 || (err = av_dict_copy(&conn->unused_options, *options, 0)) < 0) {
+        ffurl_closep(&s->hd);
+        pool_conn_free(conn);
+        return err;
+    }
+    s->conn = conn;
+    return 0;
+}
+
+/* whether the response was read completely and the server keeps the
+ * connection open, so it can take the next request */
+static int http_pool_reusable(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint64_t target_end = s->end_off ? s->end_off : s->filesize;
+
+    if (!s->conn || !s->hd || s->willclose || s->icy_metaint ||
+        s->buf_ptr != s->buf_end || (s->http_code != 200 && s->http_code != 206))
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    return s->off == target_end;
+}
+
+static void http_pool_put(HTTPContext *s)
+{
+    HTTPPoolConn *conn = s->conn, *evict, **p;
+
+    conn->hd         = s->hd;
+    conn->int_cb     = (AVIOInterruptCB){ 0 };
+    conn->idle_since = av_gettime_relative();
+    s->hd   = NULL;
+    s->conn = NULL;
+
+    ff_mutex_lock(&pool_mutex);
+    evict = pool_unlink_expired(conn->idle_since);
+    conn->next = pool;
+    pool       = conn;
+    if (++pool_size > POOL_MAX_IDLE) {
+        for (p = &pool; (*p)->next; p = &(*p)->next)
+            ;
+        (*p)->next = evict;
+        evict      = *p;
+        *p         = NULL;
+        pool_size--;
+    }
+    ff_mutex_unlock(&pool_mutex);
+
+    pool_conn_free_list(evict);
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -219,8 +447,10 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE], sanitized_path[MAX_URL_SIZE + 1];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err = 0;
+    int port, use_proxy, err = 0, reused = 0;
+    AVDictionary *pool_options = NULL;
     HTTPContext *s = h->priv_data;
+    uint64_t off = s->off;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
                  hostname, sizeof(hostname), &port,
@@ -282,16 +512,38 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
-    if (!s->hd) {
+    if (!s->hd && s->connection_pool) {
+        /* kept to look up the pool again if the reused connection fails */
+        if ((err = av_dict_copy(&pool_options, *options, 0)) < 0)
+            goto end;
+        err = http_pool_open(h, buf, options, &reused);
+    } else if (!s->hd) {
         err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
                                    &h->interrupt_callback, options,
                                    h->protocol_whitelist, h->protocol_blacklist, h);
     }
+    if (err < 0)
+        goto end;
+
+    s->line_count = 0;
+    err = http_connect(h, path, local_path, hoststr, auth, proxyauth);
+    if (err < 0 && reused && !s->line_count) {
+        /* the server may have closed the idle connection meanwhile */
+        av_log(h, AV_LOG_DEBUG, "Reused connection failed, reconnecting\n");
+        http_close_cnx(s);
+        s->off = off;
+        av_dict_free(options);
+        *options     = pool_options;
+        pool_options = NULL;
+        err = http_pool_open(h, buf, options, NULL);
+        if (err >= 0)
+            err = http_connect(h, path, local_path, hoststr, auth, proxyauth);
+    }
 
 end:
+    av_dict_free(&pool_options);
     freeenv_utf8(env_http_proxy);
-    return err < 0 ? err : http_connect(
-        h, path, local_path, hoststr, auth, proxyauth);
+    return err;
 }
 
 static int http_should_reconnect(HTTPContext *s, int err)
@@ -426,7 +678,7 @@ redo:
         /* restore the offset (http_connect resets it) */
         s->off = off;
 
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
         goto redo;
     }
 
@@ -434,7 +686,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && auth_attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_cnx(s);
             goto redo;
         } else
             goto fail;
@@ -442,7 +694,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && auth_attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_cnx(s);
             goto redo;
         } else
             goto fail;
@@ -451,7 +703,7 @@ redo:
          s->http_code == 303 || s->http_code == 307 || s->http_code == 308) &&
         s->new_location) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
 
@@ -477,7 +729,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
     if (ret < 0)
         return ret;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -753,6 +1005,13 @@ static int http_open(URLContext *h, const char *uri, int flags,
     if (options)
         av_dict_copy(&s->chained_options, *options, 0);
 
+    /* only plain requests whose response is read completely are pooled */
+    if (s->connection_pool && !(flags & AVIO_FLAG_WRITE) && !s->listen &&
+        !s->post_data)
+        s->multiple_requests = 1;
+    else
+        s->connection_pool = 0;
+
     if (s->headers) {
         int len = strlen(s->headers);
         if (len < 2 || strcmp("\r\n", s->headers + len - 2)) {
@@ -1665,7 +1924,7 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
             }
             else if (!s->chunksize) {
                 av_log(h, AV_LOG_DEBUG, "Last chunk received, closing conn\n");
-                ffurl_closep(&s->hd);
+                http_close_cnx(s);
                 return 0;
             }
             else if (s->chunksize == UINT64_MAX) {
@@ -1973,8 +2232,10 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    if (http_pool_reusable(h))
+        http_pool_put(s);
+    else
+        http_close_cnx(s);
     av_dict_free(&s->chained_options);
     av_dict_free(&s->cookie_dict);
     av_dict_free(&s->redirect_cache);
@@ -1987,6 +2248,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    HTTPPoolConn *old_conn = s->conn;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -2034,7 +2296,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd   = NULL;
+    s->conn = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -2043,11 +2306,14 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
         s->hd      = old_hd;
+        s->conn    = old_conn;
         s->off     = old_off;
         return ret;
     }
     av_dict_free(&options);
     ffurl_close(old_hd);
+    if (old_conn)
+        pool_conn_free(old_conn);
     return off;
 }
 
@@ -2125,7 +2391,7 @@ static int http_proxy_close(URLContext *h)
 {
     HTTPContext *s = h->priv_data;
     if (s->hd)
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
     return 0;
 }
 
@@ -2199,7 +2465,7 @@ redo:
     if (s->http_code == 407 &&
         (cur_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
         s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && auth_attempts < 2) {
-        ffurl_closep(&s->hd);
+        http_close_cnx(s);
         goto redo;
     }
 
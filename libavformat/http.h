@@ -64,4 +64,15 @@ int ff_http_averror(int status_code, int default_averror);
 
 const char* ff_http_get_new_location(URLContext *h);
 
+/**
+ * Reference the connection pool, see the connection_pool option.
+ */
+void ff_http_pool_init(void);
+
+/**
+ * Unreference the connection pool and close all its idle connections when
+ * the last reference is gone.
+ */
+void ff_http_pool_uninit(void);
+
 #endif /* AVFORMAT_HTTP_H */
@@ -20,10 +20,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "config_components.h"
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE
+#include <stdatomic.h>
 #include <sys/stat.h>
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -33,6 +35,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
 #include "libavcodec/gif.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -40,6 +43,7 @@
 #include "internal.h"
 #include "img2.h"
 #include "os_support.h"
+#include "url.h"
 #include "libavcodec/jpegxl_parse.h"
 #include "libavcodec/mjpeg.h"
 #include "libavcodec/vbn.h"
@@ -191,6 +195,13 @@ int ff_img_read_header(AVFormatContext *s1)
     s->img_number = 0;
     s->img_count  = 0;
 
+    /* the workers open the files themselves, like the default io_open */
+    if (s->prefetch && !ff_format_io_is_default(s1)) {
+        av_log(s1, AV_LOG_WARNING,
+               "Prefetching is not supported with custom I/O callbacks, disabling it\n");
+        s->prefetch = 0;
+    }
+
     /* find format */
     if (s1->iformat->flags & AVFMT_NOFILE)
         s->is_pipe = 0;
@@ -360,6 +371,415 @@ static int add_filename_as_pkt_side_data(char *filename, AVPacket *pkt) {
     return 0;
 }
 
+static int get_image_filename(AVFormatContext *s1, int number, AVBPrint *filename)
+{
+    VideoDemuxData *s = s1->priv_data;
+
+    if (s->pattern_type == PT_NONE) {
+        av_bprintf(filename, "%s", s1->url);
+    } else if (s->use_glob) {
+#if HAVE_GLOB
+        av_bprintf(filename, "%s", s->globstate.gl_pathv[number]);
+#endif
+    } else {
+        int ret = ff_bprint_get_frame_filename(filename, s1->url, number, 0);
+        if (ret < 0)
+            return ret;
+    }
+    if (!av_bprint_is_complete(filename))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int get_file_timestamp(VideoDemuxData *s, const char *filename, int64_t *pts)
+{
+    struct stat img_stat;
+
+    if (stat(filename, &img_stat))
+        return AVERROR(errno);
+    *pts = (int64_t)img_stat.st_mtime;
+#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    if (s->ts_from_file == 2)
+        *pts = 1000000000 * *pts + img_stat.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+/**
+ * Set the codec from the first bytes of the first image.
+ * header must be padded with AVPROBE_PADDING_SIZE zero bytes.
+ */
+static void probe_image_codec(AVCodecParameters *par, const uint8_t *header,
+                              int size, const char *filename)
+{
+    AVProbeData pd = { 0 };
+    const FFInputFormat *ifmt;
+    int score = 0;
+
+    pd.buf = (uint8_t *)header;
+    pd.buf_size = size;
+    pd.filename = filename;
+
+    ifmt = ffifmt(av_probe_input_format3(&pd, 1, &score));
+    if (ifmt && ifmt->read_packet == ff_img_read_packet && ifmt->raw_codec_id)
+        par->codec_id = ifmt->raw_codec_id;
+}
+
+#if HAVE_THREADS
+enum ImagePrefetchState {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_BUSY,
+    SLOT_DONE,
+};
+
+typedef struct ImagePrefetchSlot {
+    enum ImagePrefetchState state;
+    int number;
+    char *filename;
+    uint8_t *data;
+    int size;           /**< number of bytes read, or an error code */
+    int open_failed;
+    int64_t pts;        /**< file timestamp, if ts_from_file is set */
+} ImagePrefetchSlot;
+
+/**
+ * Images following the current one, read by worker threads into a ring
+ * of slots consumed in sequence order.
+ */
+typedef struct ImagePrefetch {
+    AVFormatContext *s1;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t *threads;
+    int nb_threads;
+    ImagePrefetchSlot *slots;
+    int nb_slots;
+    int head;
+    int count;
+    int next_number;    /**< next image to queue */
+    int eof;            /**< all images up to the end of the sequence are queued */
+    atomic_int exit;
+} ImagePrefetch;
+
+static int prefetch_interrupt_cb(void *arg)
+{
+    ImagePrefetch *p = arg;
+
+    return atomic_load(&p->exit) || ff_check_interrupt(&p->s1->interrupt_callback);
+}
+
+static void prefetch_read_image(ImagePrefetch *p, ImagePrefetchSlot *slot,
+                                const AVIOInterruptCB *interrupt_callback)
+{
+    AVFormatContext *s1 = p->s1;
+    VideoDemuxData *s = s1->priv_data;
+    AVIOContext *pb = NULL;
+    AVBPrint filename;
+    int64_t size;
+    int ret;
+
+    av_bprint_init(&filename, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = get_image_filename(s1, slot->number, &filename);
+    if (ret < 0) {
+        av_bprint_finalize(&filename, NULL);
+        goto end;
+    }
+    ret = av_bprint_finalize(&filename, &slot->filename);
+    if (ret < 0)
+        goto end;
+
+    ret = ffio_open_whitelist(&pb, slot->filename, AVIO_FLAG_READ, interrupt_callback,
+                              NULL, s1->protocol_whitelist, s1->protocol_blacklist);
+    if (ret < 0) {
+        slot->open_failed = 1;
+        goto end;
+    }
+
+    size = avio_size(pb);
+    if (size < 0 || size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    slot->data = av_malloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!slot->data) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (int64_t pos = 0; pos < size; pos += ret) {
+        ret = avio_read(pb, slot->data + pos, size - pos);
+        if (ret == AVERROR_EOF || !ret) {
+            /* the file got shorter since its size was read */
+            size = pos;
+            break;
+        }
+        if (ret < 0)
+            goto end;
+    }
+    if (!size) {
+        ret = AVERROR_EOF;
+        goto end;
+    }
+    ret = size;
+    memset(slot->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    if (s->ts_from_file) {
+        int err = get_file_timestamp(s, slot->filename, &slot->pts);
+        if (err < 0)
+            ret = err;
+    }
+
+end:
+    avio_closep(&pb);
+    slot->size = ret;
+}
+
+static void *prefetch_worker(void *arg)
+{
+    ImagePrefetch *p = arg;
+    const AVIOInterruptCB interrupt_callback = { prefetch_interrupt_cb, p };
+
+    ff_thread_setname("img2-prefetch");
+
+    pthread_mutex_lock(&p->mutex);
+    while (!atomic_load(&p->exit)) {
+        ImagePrefetchSlot *slot = NULL;
+
+        for (int i = 0; i < p->count; i++) {
+            ImagePrefetchSlot *cur = &p->slots[(p->head + i) % p->nb_slots];
+            if (cur->state == SLOT_QUEUED) {
+                slot = cur;
+                break;
+            }
+        }
+        if (!slot) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+            continue;
+        }
+
+        slot->state = SLOT_BUSY;
+        pthread_mutex_unlock(&p->mutex);
+
+        prefetch_read_image(p, slot, &interrupt_callback);
+
+        pthread_mutex_lock(&p->mutex);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+
+    return NULL;
+}
+
+static void prefetch_slot_reset(ImagePrefetchSlot *slot)
+{
+    av_freep(&slot->filename);
+    av_freep(&slot->data);
+    slot->open_failed = 0;
+    slot->state       = SLOT_FREE;
+}
+
+/* Queue images in sequence order until all slots are in use. */
+static void prefetch_queue(ImagePrefetch *p)
+{
+    VideoDemuxData *s = p->s1->priv_data;
+
+    while (p->count < p->nb_slots && !p->eof) {
+        ImagePrefetchSlot *slot = &p->slots[(p->head + p->count++) % p->nb_slots];
+
+        slot->number = p->next_number;
+        slot->state  = SLOT_QUEUED;
+        if (p->next_number < s->img_last)
+            p->next_number++;
+        else if (s->loop)
+            p->next_number = s->img_first;
+        else
+            p->eof = 1;
+    }
+    pthread_cond_broadcast(&p->cond);
+}
+
+/* Drop all queued images, waiting for those being read. */
+static void prefetch_flush(ImagePrefetch *p)
+{
+    int busy;
+
+    for (int i = 0; i < p->count; i++) {
+        ImagePrefetchSlot *slot = &p->slots[(p->head + i) % p->nb_slots];
+        if (slot->state == SLOT_QUEUED)
+            slot->state = SLOT_FREE;
+    }
+    do {
+        busy = 0;
+        for (int i = 0; i < p->count; i++)
+            busy |= p->slots[(p->head + i) % p->nb_slots].state == SLOT_BUSY;
+        if (busy)
+            pthread_cond_wait(&p->cond, &p->mutex);
+    } while (busy);
+
+    for (int i = 0; i < p->count; i++)
+        prefetch_slot_reset(&p->slots[(p->head + i) % p->nb_slots]);
+    p->count = 0;
+}
+
+static void prefetch_stop(VideoDemuxData *s)
+{
+    ImagePrefetch *p = s->prefetcher;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    atomic_store(&p->exit, 1);
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    for (int i = 0; i < p->nb_threads; i++)
+        pthread_join(p->threads[i], NULL);
+
+    for (int i = 0; i < p->nb_slots; i++)
+        prefetch_slot_reset(&p->slots[i]);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    av_freep(&p->threads);
+    av_freep(&p->slots);
+    av_freep(&s->prefetcher);
+}
+
+static int prefetch_start(AVFormatContext *s1)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImagePrefetch *p;
+    int ret;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->s1       = s1;
+    p->nb_slots = s->prefetch;
+    p->eof      = 1;
+    p->slots   = av_calloc(p->nb_slots, sizeof(*p->slots));
+    p->threads = av_calloc(s->prefetch, sizeof(*p->threads));
+    if (!p->slots || !p->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    atomic_init(&p->exit, 0);
+    if ((ret = pthread_mutex_init(&p->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    if ((ret = pthread_cond_init(&p->cond, NULL))) {
+        pthread_mutex_destroy(&p->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    s->prefetcher = p;
+
+    for (; p->nb_threads < s->prefetch; p->nb_threads++) {
+        ret = pthread_create(&p->threads[p->nb_threads], NULL, prefetch_worker, p);
+        if (ret) {
+            prefetch_stop(s);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+fail:
+    av_freep(&p->slots);
+    av_freep(&p->threads);
+    av_free(p);
+    return ret;
+}
+
+static int prefetch_read_packet(AVFormatContext *s1, AVPacket *pkt)
+{
+    VideoDemuxData *s = s1->priv_data;
+    ImagePrefetch *p = s->prefetcher;
+    AVCodecParameters *par = s1->streams[0]->codecpar;
+    ImagePrefetchSlot *slot;
+    char *filename;
+    uint8_t *data;
+    int64_t pts;
+    int size, open_failed, ret;
+
+    pthread_mutex_lock(&p->mutex);
+    /* the sequence was seeked or looped differently than queued */
+    if (p->count && p->slots[p->head].number != s->img_number)
+        prefetch_flush(p);
+    if (!p->count) {
+        p->next_number = s->img_number;
+        p->eof         = 0;
+    }
+    prefetch_queue(p);
+
+    slot = &p->slots[p->head];
+    while (slot->state != SLOT_DONE)
+        pthread_cond_wait(&p->cond, &p->mutex);
+
+    filename    = slot->filename;
+    data        = slot->data;
+    size        = slot->size;
+    open_failed = slot->open_failed;
+    pts         = slot->pts;
+    slot->filename = NULL;
+    slot->data     = NULL;
+    prefetch_slot_reset(slot);
+    p->head = (p->head + 1) % p->nb_slots;
+    p->count--;
+    prefetch_queue(p);
+    pthread_mutex_unlock(&p->mutex);
+
+    if (size < 0) {
+        if (open_failed)
+            av_log(s1, AV_LOG_ERROR, "Could not open file : %s\n", filename);
+        ret = size;
+        goto end;
+    }
+
+    if (par->codec_id == AV_CODEC_ID_NONE) {
+        uint8_t header[PROBE_BUF_MIN + AVPROBE_PADDING_SIZE] = { 0 };
+        int header_size = FFMIN(size, PROBE_BUF_MIN);
+
+        memcpy(header, data, header_size);
+        probe_image_codec(par, header, header_size, filename);
+    }
+    if (par->codec_id == AV_CODEC_ID_RAWVIDEO && !par->width)
+        infer_size(&par->width, &par->height, size);
+
+    ret = av_packet_from_data(pkt, data, size);
+    if (ret < 0)
+        goto end;
+    data = NULL;
+
+    pkt->stream_index = 0;
+    pkt->flags       |= AV_PKT_FLAG_KEY;
+    if (s->ts_from_file) {
+        pkt->pts = pts;
+        av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
+    } else {
+        pkt->pts = s->pts;
+    }
+
+    if (s->export_path_metadata == 1) {
+        ret = add_filename_as_pkt_side_data(filename, pkt);
+        if (ret < 0)
+            goto end;
+    }
+
+    s->img_count++;
+    s->img_number++;
+    s->pts++;
+
+end:
+    av_free(filename);
+    av_free(data);
+    return ret;
+}
+#else
+static void prefetch_stop(VideoDemuxData *s)
+{
+}
+#endif
+
 int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
 {
     VideoDemuxData *s = s1->priv_data;
@@ -377,22 +797,17 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
         if (s->img_number > s->img_last)
             return AVERROR_EOF;
-        if (s->pattern_type == PT_NONE) {
-            av_bprintf(&filename, "%s", s1->url);
-        } else if (s->use_glob) {
-#if HAVE_GLOB
-            av_bprintf(&filename, "%s", s->globstate.gl_pathv[s->img_number]);
-#endif
-        } else {
-            int ret = ff_bprint_get_frame_filename(&filename, s1->url, s->img_number, 0);
-            if (ret < 0) {
-                av_bprint_finalize(&filename, NULL);
-                return ret;
-            }
+#if HAVE_THREADS
+        if (s->prefetch && !s->split_planes && !s1->pb) {
+            if (!s->prefetcher && (res = prefetch_start(s1)) < 0)
+                return res;
+            return prefetch_read_packet(s1, pkt);
         }
-        if (!av_bprint_is_complete(&filename)) {
+#endif
+        res = get_image_filename(s1, s->img_number, &filename);
+        if (res < 0) {
             av_bprint_finalize(&filename, NULL);
-            return AVERROR(ENOMEM);
+            return res;
         }
         for (i = 0; i < 3; i++) {
             if (s1->pb &&
@@ -417,11 +832,8 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
         av_bprint_finalize(&filename, NULL);
 
         if (par->codec_id == AV_CODEC_ID_NONE) {
-            AVProbeData pd = { 0 };
-            const FFInputFormat *ifmt;
             uint8_t header[PROBE_BUF_MIN + AVPROBE_PADDING_SIZE];
             int ret;
-            int score = 0;
 
             ret = avio_read(f[0], header, PROBE_BUF_MIN);
             if (ret < 0) {
@@ -430,13 +842,7 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
             }
             memset(header + ret, 0, sizeof(header) - ret);
             avio_skip(f[0], -ret);
-            pd.buf = header;
-            pd.buf_size = ret;
-            pd.filename = filename.str;
-
-            ifmt = ffifmt(av_probe_input_format3(&pd, 1, &score));
-            if (ifmt && ifmt->read_packet == ff_img_read_packet && ifmt->raw_codec_id)
-                par->codec_id = ifmt->raw_codec_id;
+            probe_image_codec(par, header, ret, filename.str);
         }
 
         if (par->codec_id == AV_CODEC_ID_RAWVIDEO && !par->width)
@@ -463,17 +869,10 @@ int ff_img_read_packet(AVFormatContext *s1, AVPacket *pkt)
     pkt->stream_index = 0;
     pkt->flags       |= AV_PKT_FLAG_KEY;
     if (s->ts_from_file) {
-        struct stat img_stat;
         av_assert0(!s->is_pipe); // The ts_from_file option is not supported by piped input demuxers
-        if (stat(filename.str, &img_stat)) {
-            res = AVERROR(errno);
+        res = get_file_timestamp(s, filename.str, &pkt->pts);
+        if (res < 0)
             goto fail;
-        }
-        pkt->pts = (int64_t)img_stat.st_mtime;
-#if HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
-        if (s->ts_from_file == 2)
-            pkt->pts = 1000000000*pkt->pts + img_stat.st_mtim.tv_nsec;
-#endif
         av_add_index_entry(s1->streams[0], s->img_number, pkt->pts, 0, 0, AVINDEX_KEYFRAME);
     } else if (!s->is_pipe) {
         pkt->pts      = s->pts;
@@ -541,10 +940,12 @@ fail:
     return res;
 }
 
-static int img_read_close(struct AVFormatContext* s1)
+int ff_img_read_close(AVFormatContext *s1)
 {
-#if HAVE_GLOB
     VideoDemuxData *s = s1->priv_data;
+
+    prefetch_stop(s);
+#if HAVE_GLOB
     if (s->use_glob) {
         globfree(&s->globstate);
     }
@@ -594,6 +995,7 @@ const AVOption ff_img_options[] = {
     { "sec",  "second precision",       0, AV_OPT_TYPE_CONST,    {.i64 = 1   }, 0, 2,       DEC, .unit = "ts_type" },
     { "ns",   "nano second precision",  0, AV_OPT_TYPE_CONST,    {.i64 = 2   }, 0, 2,       DEC, .unit = "ts_type" },
     { "export_path_metadata", "enable metadata containing input path information", OFFSET(export_path_metadata), AV_OPT_TYPE_BOOL,   {.i64 = 0   }, 0, 1,       DEC }, \
+    { "prefetch",     "number of following images read in parallel by worker threads", OFFSET(prefetch), AV_OPT_TYPE_INT, {.i64 = 0 }, 0, 64, DEC },
     COMMON_OPTIONS
 };
 
@@ -612,7 +1014,7 @@ const FFInputFormat ff_image2_demuxer = {
     .read_probe     = img_read_probe,
     .read_header    = ff_img_read_header,
     .read_packet    = ff_img_read_packet,
-    .read_close     = img_read_close,
+    .read_close     = ff_img_read_close,
     .read_seek      = img_read_seek,
 };
 #endif
@@ -22,6 +22,7 @@
 
 #include <time.h>
 
+#include "config.h"
 #include "config_components.h"
 
 #include "libavutil/intreadwrite.h"
@@ -32,6 +33,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/time_internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -39,6 +41,19 @@
 #include "img2.h"
 #include "mux.h"
 
+/**
+ * The files written for one packet.
+ */
+typedef struct ImageWriteJob {
+    AVPacket *pkt;          /**< reference to the data to write */
+    int nb_files;
+    char *filename[4];
+    char *tmp[4];           /**< temporary names, if use_rename is set */
+    int offset[4];
+    int size[4];
+    int busy;
+} ImageWriteJob;
+
 typedef struct VideoMuxData {
     const AVClass *class;  /**< Class for private options. */
     int start_img_number;
@@ -50,34 +65,21 @@ typedef struct VideoMuxData {
     const char *muxer;
     int use_rename;
     AVDictionary *protocol_opts;
+    int nb_writer_threads;
+    int writer_queue_size;
+#if HAVE_THREADS
+    pthread_t *writer_threads;
+    int nb_threads_started;
+    pthread_mutex_t writer_mutex;
+    pthread_cond_t writer_cond;
+    /* jobs waiting or being written, in submission order */
+    ImageWriteJob **jobs;
+    int nb_jobs;
+    int writer_exit;
+    int writer_error;
+#endif
 } VideoMuxData;
 
-static int write_header(AVFormatContext *s)
-{
-    VideoMuxData *img = s->priv_data;
-    AVStream *st = s->streams[0];
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(st->codecpar->format);
-
-    if (st->codecpar->codec_id == AV_CODEC_ID_GIF) {
-        img->muxer = "gif";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_FITS) {
-        img->muxer = "fits";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_AV1) {
-        img->muxer = "avif";
-    } else if (st->codecpar->codec_id == AV_CODEC_ID_RAWVIDEO) {
-        const char *str = strrchr(s->url, '.');
-        img->split_planes =     str
-                             && !av_strcasecmp(str + 1, "y")
-                             && s->nb_streams == 1
-                             && desc
-                             &&(desc->flags & AV_PIX_FMT_FLAG_PLANAR)
-                             && desc->nb_components >= 3;
-    }
-    img->img_number = img->start_img_number;
-
-    return 0;
-}
-
 static int write_muxed_file(AVFormatContext *s, AVIOContext *pb, AVPacket *pkt)
 {
     VideoMuxData *img = s->priv_data;
@@ -137,34 +139,38 @@ static int write_and_close(AVFormatContext *s, AVIOContext **pb, const unsigned
     return ff_format_io_close(s, pb);
 }
 
-static int write_packet(AVFormatContext *s, AVPacket *pkt)
+static void image_job_free(ImageWriteJob **pjob)
+{
+    ImageWriteJob *job = *pjob;
+
+    if (!job)
+        return;
+    av_packet_free(&job->pkt);
+    for (int i = 0; i < FF_ARRAY_ELEMS(job->filename); i++) {
+        av_freep(&job->filename[i]);
+        av_freep(&job->tmp[i]);
+    }
+    av_freep(pjob);
+}
+
+static int get_filename(AVFormatContext *s, AVPacket *pkt, AVBPrint *filename)
 {
     VideoMuxData *img = s->priv_data;
-    AVIOContext *pb[4] = {0};
-    char* target[4]    = {0};
-    char* tmp[4]       = {0};
-    AVCodecParameters *par = s->streams[pkt->stream_index]->codecpar;
-    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(par->format);
-    int ret, i;
-    AVDictionary *options = NULL;
-    AVBPrint filename;
-    av_bprint_init(&filename, 0, AV_BPRINT_SIZE_UNLIMITED);
 
     if (img->update) {
-        av_bprintf(&filename, "%s", s->url);
+        av_bprintf(filename, "%s", s->url);
     } else if (img->use_strftime) {
         time_t now0;
         struct tm *tm, tmpbuf;
         time(&now0);
         tm = localtime_r(&now0, &tmpbuf);
-        av_bprint_strftime(&filename, s->url, tm);
+        av_bprint_strftime(filename, s->url, tm);
     } else if (img->frame_pts) {
-        if (ff_bprint_get_frame_filename(&filename, s->url, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
+        if (ff_bprint_get_frame_filename(filename, s->url, pkt->pts, AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
             av_log(s, AV_LOG_ERROR, "Cannot write filename by pts of the frames.");
-            ret = AVERROR(EINVAL);
-            goto fail;
+            return AVERROR(EINVAL);
         }
-    } else if (ff_bprint_get_frame_filename(&filename, s->url,
+    } else if (ff_bprint_get_frame_filename(filename, s->url,
                                      img->img_number,
                                      AV_FRAME_FILENAME_FLAGS_MULTIPLE) < 0) {
         if (img->img_number == img->start_img_number) {
@@ -172,43 +178,59 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
             av_log(s, AV_LOG_WARNING,
                    "Use a pattern such as %%03d for an image sequence or "
                    "use the -update option (with -frames:v 1 if needed) to write a single image.\n");
-            av_bprint_clear(&filename);
-            av_bprintf(&filename, "%s", s->url);
+            av_bprint_clear(filename);
+            av_bprintf(filename, "%s", s->url);
         } else {
             av_log(s, AV_LOG_ERROR, "Cannot write more than one file with the same name. Are you missing the -update option or a sequence pattern?\n");
-            ret = AVERROR(EINVAL);
-            goto fail;
+            return AVERROR(EINVAL);
         }
     }
-    if (!av_bprint_is_complete(&filename)) {
+    if (!av_bprint_is_complete(filename))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+/**
+ * Set up the files and data to write for a packet. This runs on the muxing
+ * thread and takes care of everything depending on the muxer state.
+ */
+static int prepare_job(AVFormatContext *s, AVPacket *pkt, ImageWriteJob *job)
+{
+    VideoMuxData *img = s->priv_data;
+    AVCodecParameters *par = s->streams[pkt->stream_index]->codecpar;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(par->format);
+    AVBPrint filename;
+    int ret, i;
+
+    av_bprint_init(&filename, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = get_filename(s, pkt, &filename);
+    if (ret < 0)
+        goto fail;
+
+    job->pkt = av_packet_alloc();
+    if (!job->pkt) {
         ret = AVERROR(ENOMEM);
         goto fail;
     }
-    for (i = 0; i < 4; i++) {
-        av_dict_copy(&options, img->protocol_opts, 0);
-        if (img->use_rename) {
-            tmp[i] = av_asprintf("%s.tmp", filename.str);
-            target[i] = av_strdup(filename.str);
-            if (!tmp[i] || !target[i]) {
-                ret = AVERROR(ENOMEM);
-                goto fail;
-            }
-        }
-        if ((ret = s->io_open(s, &pb[i], tmp[i] ? tmp[i] : filename.str, AVIO_FLAG_WRITE, &options)) < 0) {
-            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", tmp[i] ? tmp[i] : filename.str);
+    if (img->muxer) {
+        AVIOContext *dyn_pb;
+        uint8_t *buf;
+        int size;
+
+        if ((ret = avio_open_dyn_buf(&dyn_pb)) < 0)
+            goto fail;
+        if ((ret = write_muxed_file(s, dyn_pb, pkt)) < 0) {
+            ffio_free_dyn_buf(&dyn_pb);
             goto fail;
         }
-        if (options) {
-            av_log(s, AV_LOG_ERROR, "Could not recognize some protocol options\n");
-            ret = AVERROR(EINVAL);
+        size = avio_close_dyn_buf(dyn_pb, &buf);
+        if ((ret = av_packet_from_data(job->pkt, buf, size)) < 0) {
+            av_free(buf);
             goto fail;
         }
-
-        if (!img->split_planes || i+1 >= desc->nb_components)
-            break;
-        filename.str[filename.len - 1] = "UVAx"[i];
+    } else if ((ret = av_packet_ref(job->pkt, pkt)) < 0) {
+        goto fail;
     }
-    av_bprint_finalize(&filename, NULL);
 
     if (img->split_planes) {
         int ysize = par->width * par->height;
@@ -217,45 +239,311 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
             ysize *= 2;
             usize *= 2;
         }
-        if ((ret = write_and_close(s, &pb[0], pkt->data                , ysize)) < 0 ||
-            (ret = write_and_close(s, &pb[1], pkt->data + ysize        , usize)) < 0 ||
-            (ret = write_and_close(s, &pb[2], pkt->data + ysize + usize, usize)) < 0)
+        job->nb_files = FFMIN(desc->nb_components, 4);
+        job->size[0]  = ysize;
+        job->size[1]  = usize;
+        job->size[2]  = usize;
+        job->size[3]  = ysize;
+        for (i = 1; i < job->nb_files; i++)
+            job->offset[i] = job->offset[i - 1] + job->size[i - 1];
+    } else {
+        job->nb_files = 1;
+        job->size[0]  = job->pkt->size;
+    }
+
+    for (i = 0; i < job->nb_files; i++) {
+        job->filename[i] = av_strdup(filename.str);
+        if (!job->filename[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (img->use_rename) {
+            job->tmp[i] = av_asprintf("%s.tmp", filename.str);
+            if (!job->tmp[i]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        }
+        filename.str[filename.len - 1] = "UVAx"[i];
+    }
+
+fail:
+    av_bprint_finalize(&filename, NULL);
+    return ret;
+}
+
+/**
+ * Open, write and close the files of a job, and move them in place if
+ * written to temporary files.
+ */
+static int write_job(AVFormatContext *s, ImageWriteJob *job)
+{
+    VideoMuxData *img = s->priv_data;
+    AVIOContext *pb[4] = {0};
+    AVDictionary *options = NULL;
+    int ret = 0, i;
+
+    for (i = 0; i < job->nb_files; i++) {
+        const char *name = job->tmp[i] ? job->tmp[i] : job->filename[i];
+
+        av_dict_copy(&options, img->protocol_opts, 0);
+        if ((ret = s->io_open(s, &pb[i], name, AVIO_FLAG_WRITE, &options)) < 0) {
+            av_log(s, AV_LOG_ERROR, "Could not open file : %s\n", name);
             goto fail;
-        if (desc->nb_components > 3)
-            ret = write_and_close(s, &pb[3], pkt->data + ysize + 2*usize, ysize);
-    } else if (img->muxer) {
-        if ((ret = write_muxed_file(s, pb[0], pkt)) < 0)
+        }
+        if (options) {
+            av_log(s, AV_LOG_ERROR, "Could not recognize some protocol options\n");
+            ret = AVERROR(EINVAL);
             goto fail;
-        ret = ff_format_io_close(s, &pb[0]);
-    } else {
-        ret = write_and_close(s, &pb[0], pkt->data, pkt->size);
+        }
     }
-    if (ret < 0)
-        goto fail;
 
-    for (i = 0; i < 4 && tmp[i]; i++) {
-        int ret = ff_rename(tmp[i], target[i], s);
+    for (i = 0; i < job->nb_files; i++) {
+        ret = write_and_close(s, &pb[i], job->pkt->data + job->offset[i], job->size[i]);
         if (ret < 0)
             goto fail;
-        av_freep(&tmp[i]);
-        av_freep(&target[i]);
     }
 
-    img->img_number++;
-    return 0;
+    for (i = 0; i < job->nb_files && job->tmp[i]; i++) {
+        ret = ff_rename(job->tmp[i], job->filename[i], s);
+        if (ret < 0)
+            goto fail;
+    }
 
 fail:
-    av_bprint_finalize(&filename, NULL);
     av_dict_free(&options);
     for (i = 0; i < FF_ARRAY_ELEMS(pb); i++) {
-        av_freep(&tmp[i]);
-        av_freep(&target[i]);
         if (pb[i])
             ff_format_io_close(s, &pb[i]);
     }
     return ret;
 }
 
+#if HAVE_THREADS
+/**
+ * Return the oldest job that is not being written, skipping jobs for a
+ * file that an older job still has to write, so that files written more
+ * than once (update, strftime) end up with the most recent data.
+ */
+static ImageWriteJob *next_writer_job(VideoMuxData *img)
+{
+    for (int i = 0; i < img->nb_jobs; i++) {
+        ImageWriteJob *job = img->jobs[i];
+        int j;
+
+        if (job->busy)
+            continue;
+        for (j = 0; j < i; j++)
+            if (!strcmp(img->jobs[j]->filename[0], job->filename[0]))
+                break;
+        if (j == i)
+            return job;
+    }
+    return NULL;
+}
+
+static void *writer_thread(void *arg)
+{
+    AVFormatContext *s = arg;
+    VideoMuxData *img = s->priv_data;
+
+    ff_thread_setname("img2-writer");
+
+    pthread_mutex_lock(&img->writer_mutex);
+    while (1) {
+        ImageWriteJob *job = next_writer_job(img);
+        int ret, i;
+
+        if (!job) {
+            if (img->writer_exit && !img->nb_jobs)
+                break;
+            pthread_cond_wait(&img->writer_cond, &img->writer_mutex);
+            continue;
+        }
+
+        job->busy = 1;
+        pthread_mutex_unlock(&img->writer_mutex);
+
+        ret = write_job(s, job);
+
+        pthread_mutex_lock(&img->writer_mutex);
+        if (ret < 0 && !img->writer_error)
+            img->writer_error = ret;
+        for (i = 0; img->jobs[i] != job; i++);
+        memmove(&img->jobs[i], &img->jobs[i + 1],
+                (img->nb_jobs - i - 1) * sizeof(*img->jobs));
+        img->nb_jobs--;
+        image_job_free(&job);
+        pthread_cond_broadcast(&img->writer_cond);
+    }
+    pthread_mutex_unlock(&img->writer_mutex);
+
+    return NULL;
+}
+
+static int init_writer_threads(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    int ret;
+
+    img->jobs           = av_calloc(img->writer_queue_size, sizeof(*img->jobs));
+    img->writer_threads = av_calloc(img->nb_writer_threads, sizeof(*img->writer_threads));
+    if (!img->jobs || !img->writer_threads)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&img->writer_mutex, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&img->writer_cond, NULL))) {
+        pthread_mutex_destroy(&img->writer_mutex);
+        return AVERROR(ret);
+    }
+
+    for (; img->nb_threads_started < img->nb_writer_threads; img->nb_threads_started++) {
+        ret = pthread_create(&img->writer_threads[img->nb_threads_started], NULL,
+                             writer_thread, s);
+        if (ret) {
+            if (!img->nb_threads_started) {
+                pthread_cond_destroy(&img->writer_cond);
+                pthread_mutex_destroy(&img->writer_mutex);
+            }
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+
+/* Hand a job over to the writer threads, waiting while the queue is full. */
+static int queue_job(AVFormatContext *s, ImageWriteJob **pjob)
+{
+    VideoMuxData *img = s->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&img->writer_mutex);
+    while (img->nb_jobs >= img->writer_queue_size && !img->writer_error)
+        pthread_cond_wait(&img->writer_cond, &img->writer_mutex);
+    ret = img->writer_error;
+    if (!ret) {
+        img->jobs[img->nb_jobs++] = *pjob;
+        *pjob = NULL;
+        pthread_cond_broadcast(&img->writer_cond);
+    }
+    pthread_mutex_unlock(&img->writer_mutex);
+
+    return ret;
+}
+#endif
+
+static int write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VideoMuxData *img = s->priv_data;
+    ImageWriteJob *job;
+    int ret;
+
+    job = av_mallocz(sizeof(*job));
+    if (!job)
+        return AVERROR(ENOMEM);
+
+    ret = prepare_job(s, pkt, job);
+    if (ret >= 0) {
+#if HAVE_THREADS
+        if (img->nb_threads_started)
+            ret = queue_job(s, &job);
+        else
+#endif
+            ret = write_job(s, job);
+    }
+    image_job_free(&job);
+    if (ret < 0)
+        return ret;
+
+    img->img_number++;
+    return 0;
+}
+
+static int write_trailer(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    VideoMuxData *img = s->priv_data;
+    int ret;
+
+    if (!img->nb_threads_started)
+        return 0;
+
+    pthread_mutex_lock(&img->writer_mutex);
+    while (img->nb_jobs)
+        pthread_cond_wait(&img->writer_cond, &img->writer_mutex);
+    ret = img->writer_error;
+    pthread_mutex_unlock(&img->writer_mutex);
+
+    return ret;
+#else
+    return 0;
+#endif
+}
+
+static void deinit(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    VideoMuxData *img = s->priv_data;
+
+    if (img->nb_threads_started) {
+        pthread_mutex_lock(&img->writer_mutex);
+        img->writer_exit = 1;
+        pthread_cond_broadcast(&img->writer_cond);
+        pthread_mutex_unlock(&img->writer_mutex);
+        for (int i = 0; i < img->nb_threads_started; i++)
+            pthread_join(img->writer_threads[i], NULL);
+        pthread_cond_destroy(&img->writer_cond);
+        pthread_mutex_destroy(&img->writer_mutex);
+    }
+    av_freep(&img->writer_threads);
+    av_freep(&img->jobs);
+#endif
+}
+
+static int write_header(AVFormatContext *s)
+{
+    VideoMuxData *img = s->priv_data;
+    AVStream *st = s->streams[0];
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(st->codecpar->format);
+
+    if (st->codecpar->codec_id == AV_CODEC_ID_GIF) {
+        img->muxer = "gif";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_FITS) {
+        img->muxer = "fits";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_AV1) {
+        img->muxer = "avif";
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_RAWVIDEO) {
+        const char *str = strrchr(s->url, '.');
+        img->split_planes =     str
+                             && !av_strcasecmp(str + 1, "y")
+                             && s->nb_streams == 1
+                             && desc
+                             &&(desc->flags & AV_PIX_FMT_FLAG_PLANAR)
+                             && desc->nb_components >= 3;
+    }
+    img->img_number = img->start_img_number;
+
+    /* the writer threads call io_open and io_close2 concurrently */
+    if (img->nb_writer_threads && !ff_format_io_is_default(s)) {
+        av_log(s, AV_LOG_WARNING, "writer_threads is not supported with custom I/O callbacks, "
+               "writing files from the muxing thread.\n");
+        img->nb_writer_threads = 0;
+    }
+
+    if (img->nb_writer_threads) {
+#if HAVE_THREADS
+        int ret = init_writer_threads(s);
+        if (ret < 0)
+            return ret;
+#else
+        av_log(s, AV_LOG_WARNING, "writer_threads requires threads, writing files from the muxing thread.\n");
+#endif
+    }
+
+    return 0;
+}
+
 static int query_codec(enum AVCodecID id, int std_compliance)
 {
     int i;
@@ -276,6 +564,8 @@ static const AVOption muxoptions[] = {
     { "frame_pts",    "use current frame pts for filename", OFFSET(frame_pts),  AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "atomic_writing", "write files atomically (using temporary files and renames)", OFFSET(use_rename), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
     { "protocol_opts", "specify protocol options for the opened files", OFFSET(protocol_opts), AV_OPT_TYPE_DICT, {0}, 0, 0, ENC },
+    { "writer_threads", "number of threads writing files in the background, 0 to write them from the muxing thread", OFFSET(nb_writer_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, ENC },
+    { "writer_queue_size", "maximum number of frames waiting to be written by the writer threads", OFFSET(writer_queue_size), AV_OPT_TYPE_INT, { .i64 = 16 }, 1, INT_MAX, ENC },
     { NULL },
 };
 
@@ -297,6 +587,8 @@ const FFOutputFormat ff_image2_muxer = {
     .p.video_codec  = AV_CODEC_ID_MJPEG,
     .write_header   = write_header,
     .write_packet   = write_packet,
+    .write_trailer  = write_trailer,
+    .deinit         = deinit,
     .query_codec    = query_codec,
     .p.flags        = AVFMT_NOTIMESTAMPS | AVFMT_NODIMENSIONS | AVFMT_NOFILE,
     .p.priv_class   = &img2mux_class,
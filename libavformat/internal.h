@@ -118,6 +118,11 @@ typedef struct FFFormatContext {
     AVDictionary *id3v2_meta;
 
     int missing_streams;
+
+    /**
+     * Pools for the packet payloads, with AVFMT_FLAG_PACKET_POOL.
+     */
+    struct FFPacketPool *packet_pool;
 } FFFormatContext;
 
 static av_always_inline FFFormatContext *ffformatcontext(AVFormatContext *s)
@@ -302,6 +307,12 @@ typedef struct FFStream {
      */
     PacketListEntry *last_in_packet_buffer;
 
+    /**
+     * dts of last_in_packet_buffer rescaled to AV_TIME_BASE_Q, so that
+     * the max_interleave_delta check need not rescale it for every packet.
+     */
+    int64_t last_in_packet_buffer_dts;
+
     int64_t last_IP_pts;
     int last_IP_duration;
 
@@ -594,6 +605,13 @@ int ff_copy_whiteblacklists(AVFormatContext *dst, const AVFormatContext *src);
  */
 int ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Check whether the io_open and io_close2 callbacks of s are the default
+ * ones. Those may be called from several threads at once, which is not
+ * guaranteed for callbacks set by the user.
+ */
+int ff_format_io_is_default(const AVFormatContext *s);
+
 /**
  * Utility function to check if the file uses http or https protocol
  *
@@ -377,6 +377,11 @@ typedef struct MatroskaCluster {
     int64_t pos;
 } MatroskaCluster;
 
+typedef struct MatroskaCuePoint {
+    int64_t  pos;           ///< absolute position of the CuePoint element
+    uint64_t time;
+} MatroskaCuePoint;
+
 typedef struct MatroskaLevel1Element {
     int64_t  pos;
     uint32_t id;
@@ -425,6 +430,16 @@ typedef struct MatroskaDemuxContext {
     /* File has a CUES element, but we defer parsing until it is needed. */
     int cues_parsing_deferred;
 
+    /* Only read the part of the Cues needed for a seek. */
+    int lazy_cues;
+    /* Payload of the Cues element, known once it was lazily accessed. */
+    int64_t cues_start;
+    int64_t cues_end;
+    /* Sparse index of the CuePoints found while seeking, sorted by position. */
+    MatroskaCuePoint *cue_points;
+    int nb_cue_points;
+    unsigned int cue_points_size;
+
     /* Level1 elements and whether they were read yet */
     MatroskaLevel1Element level1_elems[64];
     int num_level1_elems;
@@ -1106,6 +1121,30 @@ static int ebml_read_binary(AVIOContext *pb, int length,
     return 0;
 }
 
+/*
+ * Read a (Simple)Block, referencing the input in place if it can be
+ * memory mapped.
+ */
+static int ebml_read_block(AVIOContext *pb, int length,
+                           int64_t pos, EbmlBin *bin)
+{
+    AVBufferRef *buf;
+    uint8_t *data;
+    int ret = ffio_read_mapped(pb, &buf, &data, length);
+
+    if (ret == AVERROR(ENOSYS))
+        return ebml_read_binary(pb, length, pos, bin);
+    if (ret < 0)
+        return ret;
+
+    av_buffer_unref(&bin->buf);
+    bin->buf  = buf;
+    bin->data = data;
+    bin->size = length;
+    bin->pos  = pos;
+    return 0;
+}
+
 /*
  * Read the next element, but only the header. The contents
  * are supposed to be sub-elements which can be read separately.
@@ -1485,10 +1524,24 @@ static int ebml_parse(MatroskaDemuxContext *matroska,
         res = ebml_read_ascii(pb, length, syntax->def.s, data);
         break;
     case EBML_BIN:
-        res = ebml_read_binary(pb, length, pos_alt, data);
+        if (id == MATROSKA_ID_SIMPLEBLOCK || id == MATROSKA_ID_BLOCK)
+            res = ebml_read_block(pb, length, pos_alt, data);
+        else
+            res = ebml_read_binary(pb, length, pos_alt, data);
         break;
     case EBML_LEVEL1:
     case EBML_NEST:
+        if (id == MATROSKA_ID_CUES && matroska->lazy_cues &&
+            matroska->cues_parsing_deferred > 0 &&
+            length != EBML_UNKNOWN_LENGTH &&
+            (pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+            !(matroska->ctx->flags & AVFMT_FLAG_IGNIDX) &&
+            (level1_elem = matroska_find_level1_elem(matroska, id, pos))) {
+            // Leave the Cues to be read when seeking.
+            level1_elem->pos = pos;
+            matroska->cues_parsing_deferred = 1;
+            goto skip;
+        }
         if ((res = ebml_read_master(matroska, length, pos_alt)) < 0)
             return res;
         if (id == MATROSKA_ID_SEGMENT)
@@ -2038,6 +2091,344 @@ static void matroska_parse_cues(MatroskaDemuxContext *matroska) {
     matroska_add_index_entries(matroska);
 }
 
+/* Size of the part of the Cues converted to index entries around a target. */
+#define CUES_WINDOW_SIZE    (64 << 10)
+/* Maximum size of a CuePoint found when resyncing inside the Cues. */
+#define CUE_POINT_MAX_SIZE  4096
+/* Maximum number of CueTrackPositions of a CuePoint added to the index. */
+#define CUE_POINT_MAX_POS   32
+
+/*
+ * Read an EBML element header from memory. The element must fit into
+ * [*p, end); on success *p points to its payload.
+ */
+static int cues_read_elem_header(const uint8_t **p, const uint8_t *end,
+                                 uint32_t *id, uint64_t *length)
+{
+    const uint8_t *q = *p;
+    uint64_t num;
+    int n, i;
+
+    if (q >= end || !*q)
+        return AVERROR_INVALIDDATA;
+    n = 8 - ff_log2_tab[*q];
+    if (n > 4 || end - q < n)
+        return AVERROR_INVALIDDATA;
+    for (num = 0, i = 0; i < n; i++)
+        num = num << 8 | q[i];
+    *id = num;
+    q  += n;
+
+    if (q >= end || !*q)
+        return AVERROR_INVALIDDATA;
+    n = 8 - ff_log2_tab[*q];
+    if (end - q < n)
+        return AVERROR_INVALIDDATA;
+    for (num = *q & (0xFF >> n), i = 1; i < n; i++)
+        num = num << 8 | q[i];
+    q += n;
+    /* This also rejects unknown lengths. */
+    if (num > end - q)
+        return AVERROR_INVALIDDATA;
+
+    *length = num;
+    *p      = q;
+    return 0;
+}
+
+static uint64_t cues_read_uint(const uint8_t *p, uint64_t length)
+{
+    uint64_t num = 0;
+
+    while (length--)
+        num = num << 8 | *p++;
+    return num;
+}
+
+/*
+ * Parse the CuePoint at p from memory.
+ * Returns its size on success, < 0 if there is no complete CuePoint at p.
+ */
+static int cues_parse_point(const uint8_t *p, const uint8_t *end,
+                            uint64_t *time, MatroskaIndexPos *pos, int *nb_pos)
+{
+    const uint8_t *start = p, *point_end;
+    uint64_t length;
+    uint32_t id;
+    int has_time = 0;
+
+    *nb_pos = 0;
+    if (cues_read_elem_header(&p, end, &id, &length) < 0 ||
+        id != MATROSKA_ID_POINTENTRY)
+        return AVERROR_INVALIDDATA;
+    point_end = p + length;
+
+    while (p < point_end) {
+        if (cues_read_elem_header(&p, point_end, &id, &length) < 0)
+            return AVERROR_INVALIDDATA;
+        if (id == MATROSKA_ID_CUETIME) {
+            if (length > 8)
+                return AVERROR_INVALIDDATA;
+            *time    = cues_read_uint(p, length);
+            has_time = 1;
+        } else if (id == MATROSKA_ID_CUETRACKPOSITION) {
+            const uint8_t *q = p, *pos_end = p + length;
+            MatroskaIndexPos track_pos = { 0 };
+            uint64_t len;
+
+            while (q < pos_end) {
+                if (cues_read_elem_header(&q, pos_end, &id, &len) < 0)
+                    return AVERROR_INVALIDDATA;
+                if (id == MATROSKA_ID_CUETRACK && len <= 8)
+                    track_pos.track = cues_read_uint(q, len);
+                else if (id == MATROSKA_ID_CUECLUSTERPOSITION && len <= 8)
+                    track_pos.pos   = cues_read_uint(q, len);
+                q += len;
+            }
+            if (*nb_pos < CUE_POINT_MAX_POS)
+                pos[(*nb_pos)++] = track_pos;
+        }
+        p += length;
+    }
+
+    return has_time ? point_end - start : AVERROR_INVALIDDATA;
+}
+
+static int cues_read(MatroskaDemuxContext *matroska, int64_t pos,
+                     uint8_t *buf, int size)
+{
+    AVIOContext *pb = matroska->ctx->pb;
+
+    size = FFMIN(size, matroska->cues_end - pos);
+    if (size <= 0)
+        return 0;
+    if (avio_seek(pb, pos, SEEK_SET) != pos)
+        return AVERROR(EIO);
+    return avio_read(pb, buf, size);
+}
+
+static void cues_add_point(MatroskaDemuxContext *matroska, int64_t pos,
+                           uint64_t time)
+{
+    MatroskaCuePoint *points = matroska->cue_points;
+    int i = matroska->nb_cue_points;
+
+    while (i > 0 && points[i - 1].pos >= pos) {
+        if (points[i - 1].pos == pos)
+            return;
+        i--;
+    }
+    points = av_fast_realloc(matroska->cue_points, &matroska->cue_points_size,
+                             (matroska->nb_cue_points + 1) * sizeof(*points));
+    if (!points)
+        return;
+    memmove(&points[i + 1], &points[i],
+            (matroska->nb_cue_points - i) * sizeof(*points));
+    points[i] = (MatroskaCuePoint) { pos, time };
+    matroska->cue_points    = points;
+    matroska->nb_cue_points++;
+}
+
+/*
+ * Find the first CuePoint starting in [pos, limit) and within
+ * CUE_POINT_MAX_SIZE of pos. A candidate is only accepted if it is followed
+ * by another CuePoint or by the end of the Cues.
+ * Returns 1 if one was found, 0 if there is none in [pos, limit), < 0 if
+ * the search was inconclusive.
+ */
+static int cues_find_point(MatroskaDemuxContext *matroska, uint8_t *buf,
+                           int64_t pos, int64_t limit, MatroskaCuePoint *found)
+{
+    MatroskaIndexPos track_pos[CUE_POINT_MAX_POS];
+    int size, nb_pos, i;
+
+    size = cues_read(matroska, pos, buf, 3 * CUE_POINT_MAX_SIZE);
+    if (size < 0)
+        return size;
+
+    for (i = 0; i < FFMIN(CUE_POINT_MAX_SIZE, limit - pos) && i < size; i++) {
+        const uint8_t *end = buf + size;
+        uint64_t time, next_time;
+        int len, next;
+
+        if (buf[i] != MATROSKA_ID_POINTENTRY)
+            continue;
+        len = cues_parse_point(buf + i, end, &time, track_pos, &nb_pos);
+        if (len < 0)
+            continue;
+        if (pos + i + len != matroska->cues_end) {
+            next = cues_parse_point(buf + i + len, end, &next_time, track_pos, &nb_pos);
+            if (next < 0 || next_time < time)
+                continue;
+        }
+        *found = (MatroskaCuePoint) { pos + i, time };
+        return 1;
+    }
+
+    return limit - pos <= CUE_POINT_MAX_SIZE ? 0 : AVERROR_INVALIDDATA;
+}
+
+/*
+ * Add the index entries around timestamp without reading all of the Cues:
+ * the CuePoint before it is located by bisecting the Cues on disk, and only
+ * the CuePoints from there up to one after timestamp are added to the index.
+ * Returns < 0 if this does not work for this file, in which case all of the
+ * Cues have to be parsed.
+ */
+static int matroska_load_cues_window(MatroskaDemuxContext *matroska,
+                                     AVStream *st, int64_t timestamp)
+{
+    MatroskaIndexPos track_pos[CUE_POINT_MAX_POS];
+    MatroskaCuePoint lo, hi;
+    uint64_t ts = FFMAX(timestamp, 0);
+    uint8_t *buf;
+    int64_t pos;
+    int found_before = 0, found_after = 0, nb_probes = 0, nb_points = 0;
+    int bisect = 0, ret = 0, i;
+
+    if (!matroska->cues_end) {
+        AVIOContext *pb = matroska->ctx->pb;
+        MatroskaLevel1Element *elem = NULL;
+        uint64_t id, length;
+
+        for (i = 0; i < matroska->num_level1_elems; i++)
+            if (matroska->level1_elems[i].id == MATROSKA_ID_CUES &&
+                !matroska->level1_elems[i].parsed && matroska->level1_elems[i].pos)
+                elem = &matroska->level1_elems[i];
+        if (!elem)
+            return AVERROR(ENOSYS);
+
+        if (avio_seek(pb, elem->pos, SEEK_SET) != elem->pos ||
+            (ret = ebml_read_num(matroska, pb, 4, &id, 1)) < 0)
+            return AVERROR_INVALIDDATA;
+        if ((id | 1ULL << 7 * ret) != MATROSKA_ID_CUES ||
+            ebml_read_length(matroska, pb, &length) < 0 ||
+            length == EBML_UNKNOWN_LENGTH)
+            return AVERROR_INVALIDDATA;
+        matroska->cues_start = avio_tell(pb);
+        matroska->cues_end   = matroska->cues_start + length;
+        if (avio_size(pb) > 0 && matroska->cues_end > avio_size(pb))
+            return AVERROR_INVALIDDATA;
+    }
+
+    buf = av_malloc(CUES_WINDOW_SIZE + 3 * CUE_POINT_MAX_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    /* Start from the closest CuePoints found by previous seeks. */
+    lo = (MatroskaCuePoint) { matroska->cues_start, 0 };
+    hi = (MatroskaCuePoint) { matroska->cues_end, UINT64_MAX };
+    for (i = 0; i < matroska->nb_cue_points; i++) {
+        if (matroska->cue_points[i].time <= ts) {
+            lo = matroska->cue_points[i];
+        } else {
+            hi = matroska->cue_points[i];
+            break;
+        }
+    }
+
+    while (hi.pos - lo.pos > CUES_WINDOW_SIZE) {
+        int64_t size = hi.pos - lo.pos, mid = lo.pos + size / 2;
+        uint64_t hi_time = hi.time != UINT64_MAX ? hi.time :
+                           matroska->duration > 0 ? matroska->duration : 0;
+        MatroskaCuePoint point;
+
+        /* CueTimes usually grow about linearly with the position, so guess
+         * where timestamp is, unless the last guess did not halve the
+         * search interval. */
+        if (hi_time > lo.time) {
+            double frac = FFMIN((double)(ts - lo.time) / (hi_time - lo.time), 1.0);
+            /* Close enough to be reached when adding the window. */
+            if (frac * size < CUES_WINDOW_SIZE / 2)
+                break;
+            if (!bisect)
+                mid = av_clip64(lo.pos + frac * size - CUES_WINDOW_SIZE / 4,
+                                lo.pos + 1, hi.pos - 1);
+        }
+
+        ret = cues_find_point(matroska, buf, mid, hi.pos, &point);
+        nb_probes++;
+        if (ret < 0)
+            goto end;
+        if (!ret) {
+            hi.pos = mid;
+        } else {
+            cues_add_point(matroska, point.pos, point.time);
+            if (point.time <= ts)
+                lo = point;
+            else
+                hi = point;
+        }
+        bisect = hi.pos - lo.pos > size / 2;
+    }
+
+    /* Add the CuePoints from lo up to the first one after timestamp
+     * that refers to the stream. */
+    found_before = lo.pos == matroska->cues_start;
+    pos = lo.pos;
+    while (!found_after && pos < matroska->cues_end &&
+           pos - lo.pos < 4 * CUES_WINDOW_SIZE) {
+        const uint8_t *p, *end;
+        int size = cues_read(matroska, pos, buf, CUES_WINDOW_SIZE + 3 * CUE_POINT_MAX_SIZE);
+
+        if (size <= 0) {
+            ret = size < 0 ? size : AVERROR_INVALIDDATA;
+            goto end;
+        }
+        p   = buf;
+        end = buf + size;
+        while (!found_after && p < end) {
+            uint64_t time, length;
+            uint32_t id;
+            int nb_pos, len;
+            const uint8_t *q = p;
+
+            len = cues_parse_point(p, end, &time, track_pos, &nb_pos);
+            if (len < 0) {
+                /* Skip Void and CRC-32 elements. */
+                if (cues_read_elem_header(&q, end, &id, &length) >= 0 &&
+                    id != MATROSKA_ID_POINTENTRY) {
+                    p = q + length;
+                    continue;
+                }
+                break;
+            }
+            if (p == buf)
+                cues_add_point(matroska, pos, time);
+            nb_points++;
+            for (i = 0; i < nb_pos; i++) {
+                MatroskaTrack *track = matroska_find_track_by_num(matroska,
+                                                                  track_pos[i].track);
+                if (track && track->stream)
+                    av_add_index_entry(track->stream,
+                                       track_pos[i].pos + matroska->segment_start,
+                                       time, 0, 0, AVINDEX_KEYFRAME);
+                if (track && track->stream == st) {
+                    if (time <= ts)
+                        found_before = 1;
+                    else
+                        found_after  = 1;
+                }
+            }
+            p += len;
+        }
+        if (p == buf) {
+            ret = AVERROR_INVALIDDATA;
+            goto end;
+        }
+        pos += p - buf;
+    }
+    if (!found_before || (!found_after && pos < matroska->cues_end))
+        ret = AVERROR_INVALIDDATA;
+
+end:
+    av_log(matroska->ctx, AV_LOG_DEBUG, "Loaded %d CuePoints at 0x%"PRIx64
+           " for timestamp %"PRId64" after %d probes%s\n", nb_points, lo.pos,
+           timestamp, nb_probes, ret < 0 ? ", falling back to all Cues" : "");
+    av_free(buf);
+    return ret;
+}
+
 static int matroska_parse_content_encodings(MatroskaTrackEncoding *encodings,
                                             unsigned nb_encodings,
                                             MatroskaTrack *track,
@@ -4335,7 +4726,9 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     int i, index;
 
     /* Parse the CUES now since we need the index data to seek. */
-    if (matroska->cues_parsing_deferred > 0) {
+    if (matroska->cues_parsing_deferred > 0 &&
+        (!matroska->lazy_cues ||
+         matroska_load_cues_window(matroska, st, timestamp) < 0)) {
         matroska->cues_parsing_deferred = 0;
         matroska_parse_cues(matroska);
     }
@@ -4405,6 +4798,7 @@ static int matroska_read_close(AVFormatContext *s)
         if (tracks[n].type == MATROSKA_TRACK_TYPE_AUDIO)
             av_freep(&tracks[n].audio.buf);
     ebml_free(matroska_segment, matroska);
+    av_freep(&matroska->cue_points);
 
     return 0;
 }
@@ -4854,11 +5248,24 @@ const FFInputFormat ff_webm_dash_manifest_demuxer = {
 };
 #endif
 
+static const AVOption matroska_options[] = {
+    { "lazy_cues", "only read the part of the Cues needed when seeking", offsetof(MatroskaDemuxContext, lazy_cues), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass matroska_class = {
+    .class_name = "matroska,webm demuxer",
+    .item_name  = av_default_item_name,
+    .option     = matroska_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 const FFInputFormat ff_matroska_demuxer = {
     .p.name         = "matroska,webm",
     .p.long_name    = NULL_IF_CONFIG_SMALL("Matroska / WebM"),
     .p.extensions   = "mkv,mk3d,mka,mks,webm",
     .p.mime_type    = "audio/webm,audio/x-matroska,video/webm,video/x-matroska",
+    .p.priv_class   = &matroska_class,
     .priv_data_size = sizeof(MatroskaDemuxContext),
     .flags_internal = FF_INFMT_FLAG_INIT_CLEANUP,
     .read_probe     = matroska_probe,
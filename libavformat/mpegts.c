@@ -102,6 +102,7 @@ struct MpegTSFilter {
     int last_cc; /* last cc code (-1 if first packet) */
     int64_t last_pcr;
     int discard;
+    unsigned discard_gen; /* value of MpegTSContext.discard_gen discard was computed for */
     enum MpegTSFilterType type;
     union {
         MpegTSPESFilter pes_filter;
@@ -180,6 +181,12 @@ struct MpegTSContext {
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
 
+    /** incremented whenever the result of discard_pid() may have changed */
+    unsigned discard_gen;
+    /** AVProgram.discard values discard_gen was last checked against */
+    int8_t *prg_discard;
+    unsigned nb_prg_discard;
+
     AVStream *epg_stream;
     AVBufferPool* pools[32];
 };
@@ -303,6 +310,20 @@ static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
     prg->nb_stream_indexes = 0;
 }
 
+/**
+ * Add the AVProgram with the given id if it does not exist yet. A new
+ * program can change the result of discard_pid(), so invalidate it.
+ */
+static AVProgram *new_avprogram(MpegTSContext *ts, int programid)
+{
+    unsigned nb_programs = ts->stream->nb_programs;
+    AVProgram *program   = av_new_program(ts->stream, programid);
+
+    if (ts->stream->nb_programs != nb_programs)
+        ts->discard_gen++;
+    return program;
+}
+
 static void clear_program(struct Program *p)
 {
     if (!p)
@@ -417,6 +438,38 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Invalidate the discard_pid() results cached in the filters if the
+ * caller changed the programs' discard flags since the last call.
+ */
+static void update_discard_gen(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    unsigned i;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        int8_t *tmp = av_realloc(ts->prg_discard, s->nb_programs);
+        ts->discard_gen++;
+        if (!tmp) {
+            /* keep mismatching so that discard_pid() is always rerun */
+            ts->nb_prg_discard = 0;
+            return;
+        }
+        ts->prg_discard    = tmp;
+        ts->nb_prg_discard = s->nb_programs;
+        for (i = 0; i < s->nb_programs; i++)
+            ts->prg_discard[i] = s->programs[i]->discard;
+        return;
+    }
+
+    for (i = 0; i < s->nb_programs; i++) {
+        if (ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i] = s->programs[i]->discard;
+            ts->discard_gen++;
+        }
+    }
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -507,6 +560,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     filter->es_id   = -1;
     filter->last_cc = -1;
     filter->last_pcr= -1;
+    filter->discard_gen = ts->discard_gen - 1;
 
     return filter;
 }
@@ -2384,6 +2438,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         return;
     if (!ts->skip_clear)
         clear_avprogram(ts, h->id);
+    ts->discard_gen++;
     clear_program(prg);
     add_pid_to_program(prg, ts->current_pid);
 
@@ -2580,6 +2635,7 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
     if (skip_identical(h, tssf))
         return;
     ts->id = h->id;
+    ts->discard_gen++;
 
     for (;;) {
         sid = get16(&p, p_end);
@@ -2600,7 +2656,7 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         } else {
             MpegTSFilter *fil = ts->pids[pmt_pid];
             struct Program *prg;
-            program = av_new_program(ts->stream, sid);
+            program = new_avprogram(ts, sid);
             if (program) {
                 program->program_num = sid;
                 program->pmt_pid = pmt_pid;
@@ -2762,7 +2818,7 @@ static void sdt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
                     break;
                 name = getstr8(&p, desc_end);
                 if (name) {
-                    AVProgram *program = av_new_program(ts->stream, sid);
+                    AVProgram *program = new_avprogram(ts, sid);
                     if (program) {
                         av_dict_set(&program->metadata, "service_name", name, 0);
                         av_dict_set(&program->metadata, "service_provider",
@@ -2801,8 +2857,10 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
     }
     if (!tss)
         return 0;
-    if (is_start)
-        tss->discard = discard_pid(ts, pid);
+    if (is_start && tss->discard_gen != ts->discard_gen) {
+        tss->discard     = discard_pid(ts, pid);
+        tss->discard_gen = ts->discard_gen;
+    }
     if (tss->discard)
         return 0;
     ts->current_pid = pid;
@@ -3029,6 +3087,8 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    update_discard_gen(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
@@ -3315,6 +3375,7 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
 
     for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
         av_buffer_pool_uninit(&ts->pools[i]);
@@ -3435,6 +3496,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    update_discard_gen(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
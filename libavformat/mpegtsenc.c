@@ -982,6 +982,44 @@ static void write_packet(AVFormatContext *s, const uint8_t *packet)
     ts->total_size += TS_PACKET_SIZE;
 }
 
+/* number of payload packets assembled before they are passed to avio_write() */
+#define PAYLOAD_PACKETS_BATCH 8
+
+/* Write nb_packets packets of the stream, each made of a 4 byte header
+ * without adaptation field and a full payload. The packets are built from a
+ * header template in a local buffer, so that the payload is copied in one
+ * pass and the AVIOContext is called once per batch of packets. */
+static void write_payload_packets(AVFormatContext *s, MpegTSWriteStream *ts_st,
+                                  int pid_high, const uint8_t *payload,
+                                  int nb_packets)
+{
+    MpegTSWrite *ts = s->priv_data;
+    uint8_t buf[PAYLOAD_PACKETS_BATCH * (TS_PACKET_SIZE + 4)];
+    const uint32_t header = SYNC_BYTE << 24 | pid_high << 16 |
+                            (ts_st->pid & 0xff) << 8 | 0x10; // payload indicator
+
+    while (nb_packets > 0) {
+        const int n = FFMIN(nb_packets, PAYLOAD_PACKETS_BATCH);
+        uint8_t *q = buf;
+
+        for (int i = 0; i < n; i++) {
+            if (ts->m2ts_mode) {
+                /* get_pcr() depends on the packets before this one */
+                AV_WB32(q, get_pcr(ts) % 0x3fffffff);
+                q += 4;
+            }
+            ts_st->cc = ts_st->cc + 1 & 0xf;
+            AV_WB32(q, header | ts_st->cc);
+            memcpy(q + 4, payload, TS_PACKET_SIZE - 4);
+            q              += TS_PACKET_SIZE;
+            payload        += TS_PACKET_SIZE - 4;
+            ts->total_size += TS_PACKET_SIZE;
+        }
+        avio_write(s->pb, buf, q - buf);
+        nb_packets -= n;
+    }
+}
+
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
@@ -1308,6 +1346,38 @@ static int mpegts_init(AVFormatContext *s)
 }
 
 /* send SDT, NIT, PAT and PMT tables regularly */
+/**
+ * Return how many of the next nb_packets full payload packets can be written
+ * in a row, the first one being due now: none of the others may have to be
+ * preceded by SI tables, a PCR or a null packet.
+ *
+ * @param pcr the PCR the first packet was checked against
+ */
+static int payload_run_length(const MpegTSWrite *ts, int64_t pcr, int nb_packets)
+{
+    if (ts->mux_rate <= 1) {
+        /* The PCR is constant within a PES packet, so the SI tables only
+         * have to be repeated inside it if one of their periods is 0. */
+        if (pcr != AV_NOPTS_VALUE &&
+            (!ts->sdt_period || !ts->pat_period || !ts->nit_period))
+            return 1;
+        return nb_packets;
+    }
+
+    /* The PCR only grows, so no null packet is due either when none was
+     * due for the first packet. */
+    for (int i = 1; i < nb_packets; i++) {
+        pcr = av_rescale(ts->total_size + i * TS_PACKET_SIZE + 11,
+                         8 * PCR_TIME_BASE, ts->mux_rate) + ts->first_pcr;
+        if (pcr >= ts->next_pcr ||
+            pcr - ts->last_sdt_ts >= ts->sdt_period ||
+            pcr - ts->last_pat_ts >= ts->pat_period ||
+            pcr - ts->last_nit_ts >= ts->nit_period)
+            return i;
+    }
+    return nb_packets;
+}
+
 static void retransmit_si_info(AVFormatContext *s, int force_pat, int force_sdt, int force_nit, int64_t pcr)
 {
     MpegTSWrite *ts = s->priv_data;
@@ -1494,6 +1564,8 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
     int is_dvb_subtitle = (st->codecpar->codec_id == AV_CODEC_ID_DVB_SUBTITLE);
     int is_dvb_teletext = (st->codecpar->codec_id == AV_CODEC_ID_DVB_TELETEXT);
     int64_t delay = av_rescale(s->max_delay, 90000, AV_TIME_BASE);
+    int pid_high = ts_st->pid >> 8 |
+                   (ts->m2ts_mode && st->codecpar->codec_id == AV_CODEC_ID_AC3 ? 0x20 : 0);
     int force_pat = st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && key && !ts_st->prev_payload_key;
     int force_sdt = 0;
     int force_nit = 0;
@@ -1566,12 +1638,22 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
             }
         }
 
+        if (!is_start && !write_pcr && !ts_st->discontinuity && !is_dvb_subtitle &&
+            payload_size >= TS_PACKET_SIZE - 4) {
+            /* Continuation packets needing neither adaptation field nor
+             * stuffing, which is the common case for large payloads. */
+            int nb_packets = payload_run_length(ts, pcr, payload_size / (TS_PACKET_SIZE - 4));
+
+            write_payload_packets(s, ts_st, pid_high, payload, nb_packets);
+            payload      += nb_packets * (TS_PACKET_SIZE - 4);
+            payload_size -= nb_packets * (TS_PACKET_SIZE - 4);
+            continue;
+        }
+
         /* prepare packet header */
         q    = buf;
         *q++ = SYNC_BYTE;
-        val  = ts_st->pid >> 8;
-        if (ts->m2ts_mode && st->codecpar->codec_id == AV_CODEC_ID_AC3)
-            val |= 0x20;
+        val  = pid_high;
         if (is_start)
             val |= 0x40;
         *q++      = val;
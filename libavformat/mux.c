@@ -183,6 +183,17 @@ static int validate_codec_tag(const AVFormatContext *s, const AVStream *st)
     return 1;
 }
 
+/**
+ * Whether max_interleave_delta may force output while the stream
+ * has no packets queued.
+ */
+static int interleave_delta_may_skip(const AVCodecParameters *par)
+{
+    return par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
+           par->codec_id != AV_CODEC_ID_VP8 &&
+           par->codec_id != AV_CODEC_ID_VP9 &&
+           par->codec_id != AV_CODEC_ID_SMPTE_2038;
+}
 
 static int init_muxer(AVFormatContext *s, AVDictionary **options)
 {
@@ -327,6 +338,8 @@ static int init_muxer(AVFormatContext *s, AVDictionary **options)
         if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
             par->codec_id != AV_CODEC_ID_SMPTE_2038)
             fci->nb_interleaved_streams++;
+        if (interleave_delta_may_skip(par))
+            fci->nb_skippable_streams++;
     }
     fci->interleave_packet = of->interleave_packet;
     if (!fci->interleave_packet)
@@ -836,22 +849,27 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                              int (*compare)(AVFormatContext *, const AVPacket *, const AVPacket *))
 {
     int ret;
-    FFFormatContext *const si = ffformatcontext(s);
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFFormatContext *const si = &fci->fc;
     PacketListEntry **next_point, *this_pktl;
     AVStream *st = s->streams[pkt->stream_index];
     FFStream *const sti = ffstream(st);
     int chunked  = s->max_chunk_size || s->max_chunk_duration;
 
-    this_pktl    = av_malloc(sizeof(*this_pktl));
-    if (!this_pktl) {
-        av_packet_unref(pkt);
-        return AVERROR(ENOMEM);
-    }
     if ((ret = av_packet_make_refcounted(pkt)) < 0) {
-        av_free(this_pktl);
         av_packet_unref(pkt);
         return ret;
     }
+    if (fci->free_packet_entries) {
+        this_pktl = fci->free_packet_entries;
+        fci->free_packet_entries = this_pktl->next;
+    } else {
+        this_pktl = av_malloc(sizeof(*this_pktl));
+        if (!this_pktl) {
+            av_packet_unref(pkt);
+            return AVERROR(ENOMEM);
+        }
+    }
 
     av_packet_move_ref(&this_pktl->pkt, pkt);
     pkt = &this_pktl->pkt;
@@ -860,6 +878,8 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
         next_point = &(sti->last_in_packet_buffer->next);
     } else {
         next_point = &si->packet_buffer.head;
+        fci->nb_buffered_streams++;
+        fci->nb_buffered_skippable_streams += interleave_delta_may_skip(st->codecpar);
     }
 
     if (chunked) {
@@ -902,10 +922,77 @@ next_non_null:
     this_pktl->next = *next_point;
 
     sti->last_in_packet_buffer = *next_point = this_pktl;
+    sti->last_in_packet_buffer_dts = av_rescale_q(pkt->dts, st->time_base,
+                                                  AV_TIME_BASE_Q);
+    if (fci->last_dts_max_valid && st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE)
+        fci->last_dts_max = FFMAX(fci->last_dts_max, sti->last_in_packet_buffer_dts);
 
     return 0;
 }
 
+void ff_interleave_get_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFFormatContext *const si = &fci->fc;
+    PacketListEntry *pktl = si->packet_buffer.head;
+    AVStream *const st = s->streams[pktl->pkt.stream_index];
+    FFStream *const sti = ffstream(st);
+
+    if (sti->last_in_packet_buffer == pktl) {
+        sti->last_in_packet_buffer = NULL;
+        fci->nb_buffered_streams--;
+        fci->nb_buffered_skippable_streams -= interleave_delta_may_skip(st->codecpar);
+        if (st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE &&
+            sti->last_in_packet_buffer_dts >= fci->last_dts_max)
+            fci->last_dts_max_valid = 0;
+    }
+    *pkt = pktl->pkt;
+    si->packet_buffer.head = pktl->next;
+    if (!si->packet_buffer.head)
+        si->packet_buffer.tail = NULL;
+    pktl->next = fci->free_packet_entries;
+    fci->free_packet_entries = pktl;
+}
+
+void ff_interleave_drop_packets(AVFormatContext *s, PacketListEntry *last)
+{
+    FormatContextInternal *const fci = ff_fc_internal(s);
+    FFFormatContext *const si = &fci->fc;
+    PacketListEntry *pktl = last ? last->next : si->packet_buffer.head;
+
+    while (pktl) {
+        PacketListEntry *next = pktl->next;
+        av_packet_unref(&pktl->pkt);
+        pktl->next = fci->free_packet_entries;
+        fci->free_packet_entries = pktl;
+        pktl = next;
+    }
+    if (last)
+        last->next = NULL;
+    else
+        si->packet_buffer.head = NULL;
+    si->packet_buffer.tail = last;
+
+    /* rebuild the per-stream state from the remaining packets */
+    for (unsigned i = 0; i < s->nb_streams; i++)
+        ffstream(s->streams[i])->last_in_packet_buffer = NULL;
+    fci->nb_buffered_streams           = 0;
+    fci->nb_buffered_skippable_streams = 0;
+    for (pktl = si->packet_buffer.head; pktl; pktl = pktl->next) {
+        AVStream *const st = s->streams[pktl->pkt.stream_index];
+        FFStream *const sti = ffstream(st);
+
+        if (!sti->last_in_packet_buffer) {
+            fci->nb_buffered_streams++;
+            fci->nb_buffered_skippable_streams += interleave_delta_may_skip(st->codecpar);
+        }
+        sti->last_in_packet_buffer     = pktl;
+        sti->last_in_packet_buffer_dts = av_rescale_q(pktl->pkt.dts, st->time_base,
+                                                      AV_TIME_BASE_Q);
+    }
+    fci->last_dts_max_valid = 0;
+}
+
 static int interleave_compare_dts(AVFormatContext *s, const AVPacket *next,
                                                       const AVPacket *pkt)
 {
@@ -941,8 +1028,7 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
 {
     FormatContextInternal *const fci = ff_fc_internal(s);
     FFFormatContext *const si = &fci->fc;
-    int stream_count = 0;
-    int noninterleaved_count = 0;
+    int stream_count, noninterleaved_count;
     int ret;
 
     if (has_packet) {
@@ -950,19 +1036,9 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
             return ret;
     }
 
-    for (unsigned i = 0; i < s->nb_streams; i++) {
-        const AVStream *const st  = s->streams[i];
-        const FFStream *const sti = cffstream(st);
-        const AVCodecParameters *const par = st->codecpar;
-        if (sti->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (par->codec_type != AVMEDIA_TYPE_ATTACHMENT &&
-                   par->codec_id != AV_CODEC_ID_VP8 &&
-                   par->codec_id != AV_CODEC_ID_VP9 &&
-                   par->codec_id != AV_CODEC_ID_SMPTE_2038) {
-            ++noninterleaved_count;
-        }
-    }
+    stream_count         = fci->nb_buffered_streams;
+    noninterleaved_count = fci->nb_skippable_streams -
+                           fci->nb_buffered_skippable_streams;
 
     if (fci->nb_interleaved_streams == stream_count)
         flush = 1;
@@ -979,20 +1055,23 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
                                        s->streams[top_pkt->stream_index]->time_base,
                                        AV_TIME_BASE_Q);
 
-        for (unsigned i = 0; i < s->nb_streams; i++) {
-            const AVStream *const st  = s->streams[i];
-            const FFStream *const sti = cffstream(st);
-            const PacketListEntry *const last = sti->last_in_packet_buffer;
-            int64_t last_dts;
+        if (!fci->last_dts_max_valid) {
+            fci->last_dts_max = INT64_MIN;
+            for (unsigned i = 0; i < s->nb_streams; i++) {
+                const AVStream *const st  = s->streams[i];
+                const FFStream *const sti = cffstream(st);
 
-            if (!last || st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
-                continue;
+                if (!sti->last_in_packet_buffer ||
+                    st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
+                    continue;
 
-            last_dts = av_rescale_q(last->pkt.dts,
-                                    st->time_base,
-                                    AV_TIME_BASE_Q);
-            delta_dts = FFMAX(delta_dts, last_dts - top_dts);
+                fci->last_dts_max = FFMAX(fci->last_dts_max,
+                                          sti->last_in_packet_buffer_dts);
+            }
+            fci->last_dts_max_valid = 1;
         }
+        if (fci->last_dts_max != INT64_MIN)
+            delta_dts = fci->last_dts_max - top_dts;
 
         if (delta_dts > s->max_interleave_delta) {
             av_log(s, AV_LOG_DEBUG,
@@ -1004,14 +1083,7 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *pkt,
     }
 
     if (stream_count && flush) {
-        PacketListEntry *pktl = si->packet_buffer.head;
-        AVStream *const st = s->streams[pktl->pkt.stream_index];
-        FFStream *const sti = ffstream(st);
-
-        if (sti->last_in_packet_buffer == pktl)
-            sti->last_in_packet_buffer = NULL;
-        avpriv_packet_list_get(&si->packet_buffer, pkt);
-
+        ff_interleave_get_packet(s, pkt);
         return 1;
     } else {
         return 0;
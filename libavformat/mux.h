@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include "libavcodec/packet.h"
+#include "libavcodec/packet_internal.h"
 #include "avformat.h"
 
 struct AVDeviceInfoList;
@@ -177,6 +178,21 @@ static inline const FFOutputFormat *ffofmt(const AVOutputFormat *fmt)
 int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
                              int (*compare)(AVFormatContext *, const AVPacket *, const AVPacket *));
 
+/**
+ * Move the first packet of an AVFormatContext's packet_buffer list to pkt.
+ * Interleavement functions must take packets out of packet_buffer with this
+ * or ff_interleave_drop_packets(), which keep the per-stream state that
+ * ff_interleave_add_packet() maintains for ff_interleave_packet_per_dts()
+ * consistent. The list must not be empty.
+ */
+void ff_interleave_get_packet(AVFormatContext *s, AVPacket *pkt);
+
+/**
+ * Drop the packets of an AVFormatContext's packet_buffer list that follow
+ * last, or all of them if last is NULL.
+ */
+void ff_interleave_drop_packets(AVFormatContext *s, PacketListEntry *last);
+
 /**
  * Interleave an AVPacket per dts so it can be muxed.
  * See the documentation of AVOutputFormat.interleave_packet for details.
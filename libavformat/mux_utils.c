@@ -85,19 +85,18 @@ int ff_format_shift_data(AVFormatContext *s, int64_t read_start, int shift_size)
 
     /* Shift the data: the AVIO context of the output can only be used for
      * writing, so we re-open the same output, but for reading. It also avoids
-     * a read/seek/write/seek back and forth. */
+     * a read/seek/write/seek back and forth. Seek the output first, so that
+     * writes still queued by the protocol complete before reading back. */
     avio_flush(s->pb);
+    pos_end = avio_tell(s->pb);
+    avio_seek(s->pb, read_start + shift_size, SEEK_SET);
+
     ret = s->io_open(s, &read_pb, s->url, AVIO_FLAG_READ, NULL);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Unable to re-open %s output file for shifting data\n", s->url);
         goto end;
     }
 
-    /* mark the end of the shift to up to the last data we wrote, and get ready
-     * for writing */
-    pos_end = avio_tell(s->pb);
-    avio_seek(s->pb, read_start + shift_size, SEEK_SET);
-
     avio_seek(read_pb, read_start, SEEK_SET);
     pos = avio_tell(read_pb);
 
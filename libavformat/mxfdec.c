@@ -112,8 +112,16 @@ typedef struct MXFPartition {
     int64_t pack_ofs;               ///< absolute offset of pack in file, including run-in
     int64_t body_offset;
     KLVPacket first_essence_klv;
+    int lazy;                       ///< only known from the RandomIndexPack, not read yet
+    int64_t index_start;            ///< first edit unit indexed by the IndexSID segments read lazily from this partition
+    int64_t index_end;              ///< end of the edit units indexed by them
 } MXFPartition;
 
+typedef struct MXFRandomIndexEntry {
+    int body_sid;
+    uint64_t offset;                ///< ThisPartition of the partition, excluding run-in
+} MXFRandomIndexEntry;
+
 typedef struct MXFMetadataSet {
     UID uid;
     uint64_t partition_score;
@@ -322,6 +330,13 @@ typedef struct MXFContext {
     int nb_index_tables;
     MXFIndexTable *index_tables;
     int eia608_extract;
+    int fast_open;
+    MXFRandomIndexEntry *rip_entries;
+    int nb_rip_entries;
+    int nb_lazy_partitions;         ///< number of partitions only known from the RandomIndexPack
+    MXFPartition *lazy_partition;   ///< partition being loaded by mxf_load_partition()
+    int lazy_index;                 ///< index table segments may still be missing from lazy partitions
+    int index_tables_dirty;         ///< index table segments were added since the index tables were computed
 } MXFContext;
 
 /* NOTE: klv_offset is not set (-1) for local keys */
@@ -346,6 +361,7 @@ static const uint8_t mxf_apple_coll_prefix[]               = { 0x06,0x0e,0x2b,0x
 
 /* complete keys to match */
 static const uint8_t mxf_crypto_source_container_ul[]      = { 0x06,0x0e,0x2b,0x34,0x01,0x01,0x01,0x09,0x06,0x01,0x01,0x02,0x02,0x00,0x00,0x00 };
+static const uint8_t mxf_index_table_segment_key[]         = { 0x06,0x0e,0x2b,0x34,0x02,0x53,0x01,0x01,0x0d,0x01,0x02,0x01,0x01,0x10,0x01,0x00 };
 static const uint8_t mxf_encrypted_triplet_key[]           = { 0x06,0x0e,0x2b,0x34,0x02,0x04,0x01,0x07,0x0d,0x01,0x03,0x01,0x02,0x7e,0x01,0x00 };
 static const uint8_t mxf_encrypted_essence_container[]     = { 0x06,0x0e,0x2b,0x34,0x04,0x01,0x01,0x07,0x0d,0x01,0x03,0x01,0x02,0x0b,0x01,0x00 };
 static const uint8_t mxf_sony_mpeg4_extradata[]            = { 0x06,0x0e,0x2b,0x34,0x04,0x01,0x01,0x01,0x0e,0x06,0x06,0x02,0x02,0x01,0x00,0x00 };
@@ -765,25 +781,30 @@ static int mxf_read_partition_pack(void *arg, AVIOContext *pb, int tag, int size
 
     av_assert0(klv_offset >= mxf->run_in);
 
-    tmp_part = av_realloc_array(mxf->partitions, mxf->partitions_count + 1, sizeof(*mxf->partitions));
-    if (!tmp_part)
-        return AVERROR(ENOMEM);
-    mxf->partitions = tmp_part;
-
-    if (mxf->parsing_backward) {
-        /* insert the new partition pack in the middle
-         * this makes the entries in mxf->partitions sorted by offset */
-        memmove(&mxf->partitions[mxf->last_forward_partition+1],
-                &mxf->partitions[mxf->last_forward_partition],
-                (mxf->partitions_count - mxf->last_forward_partition)*sizeof(*mxf->partitions));
-        partition = mxf->current_partition = &mxf->partitions[mxf->last_forward_partition];
+    if (mxf->lazy_partition) {
+        /* the entry already exists, fill it in */
+        partition = mxf->current_partition = mxf->lazy_partition;
     } else {
-        mxf->last_forward_partition++;
-        partition = mxf->current_partition = &mxf->partitions[mxf->partitions_count];
+        tmp_part = av_realloc_array(mxf->partitions, mxf->partitions_count + 1, sizeof(*mxf->partitions));
+        if (!tmp_part)
+            return AVERROR(ENOMEM);
+        mxf->partitions = tmp_part;
+
+        if (mxf->parsing_backward) {
+            /* insert the new partition pack in the middle
+             * this makes the entries in mxf->partitions sorted by offset */
+            memmove(&mxf->partitions[mxf->last_forward_partition+1],
+                    &mxf->partitions[mxf->last_forward_partition],
+                    (mxf->partitions_count - mxf->last_forward_partition)*sizeof(*mxf->partitions));
+            partition = mxf->current_partition = &mxf->partitions[mxf->last_forward_partition];
+        } else {
+            mxf->last_forward_partition++;
+            partition = mxf->current_partition = &mxf->partitions[mxf->partitions_count];
+        }
+        mxf->partitions_count++;
     }
 
     memset(partition, 0, sizeof(*partition));
-    mxf->partitions_count++;
     partition->pack_length = avio_tell(pb) - klv_offset + size;
     partition->pack_ofs    = klv_offset;
 
@@ -843,7 +864,7 @@ static int mxf_read_partition_pack(void *arg, AVIOContext *pb, int tag, int size
                "PreviousPartition equal to ThisPartition %"PRIx64"\n",
                partition->previous_partition);
         /* override with the actual previous partition offset */
-        if (!mxf->parsing_backward && mxf->last_forward_partition > 1) {
+        if (!mxf->parsing_backward && !mxf->lazy_partition && mxf->last_forward_partition > 1) {
             MXFPartition *prev =
                 mxf->partitions + mxf->last_forward_partition - 2;
             partition->previous_partition = prev->pack_ofs - mxf->run_in;
@@ -1854,13 +1875,18 @@ static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segment
     return 0;
 }
 
+static int mxf_load_partition(MXFContext *mxf, int x);
+
 /**
  * Computes the absolute file offset of the given essence container offset
  */
 static int mxf_absolute_bodysid_offset(MXFContext *mxf, int body_sid, int64_t offset, int64_t *offset_out, MXFPartition **partition_out)
 {
+    AVIOContext *pb = mxf->fc->pb;
+    int64_t pos = avio_tell(pb);
+    int64_t lo = 0, hi = mxf->nb_lazy_partitions ? mxf->partitions[mxf->partitions_count - 1].pack_ofs : 0;
     MXFPartition *last_p = NULL;
-    int a, b, m, m0;
+    int a, b, m, m0, slow = 0;
 
     if (offset < 0)
         return AVERROR(EINVAL);
@@ -1869,17 +1895,33 @@ static int mxf_absolute_bodysid_offset(MXFContext *mxf, int body_sid, int64_t of
     b = mxf->partitions_count;
 
     while (b - a > 1) {
+        int width = b - a;
         m0 = m = (a + b) >> 1;
 
-        while (m < b && mxf->partitions[m].body_sid != body_sid)
+        /* every partition read counts when they are read lazily, interpolate
+         * on the essence offsets unless that did not halve the range twice */
+        if (mxf->nb_lazy_partitions && hi > offset && slow < 2)
+            m0 = m = a + 1 + av_rescale(offset - lo, b - a - 2, hi - lo);
+
+        while (m < b && (mxf->partitions[m].body_sid != body_sid ||
+                         mxf_load_partition(mxf, m) < 0))
             m++;
 
-        if (m < b && mxf->partitions[m].body_offset <= offset)
-            a = m;
-        else
+        if (m < b && mxf->partitions[m].body_offset <= offset) {
+            a  = m;
+            lo = mxf->partitions[m].body_offset;
+        } else {
+            if (m < b)
+                hi = mxf->partitions[m].body_offset;
             b = m0;
+        }
+        slow = 2 * (b - a) > width ? slow + 1 : 0;
     }
 
+    /* lazy partitions may have been read */
+    if (avio_tell(pb) != pos)
+        avio_seek(pb, pos, SEEK_SET);
+
     if (a >= 0)
         last_p = &mxf->partitions[a];
 
@@ -1902,18 +1944,27 @@ static int mxf_absolute_bodysid_offset(MXFContext *mxf, int body_sid, int64_t of
  */
 static int64_t mxf_essence_container_end(MXFContext *mxf, int body_sid)
 {
+    AVIOContext *pb = mxf->fc->pb;
+    int64_t pos = avio_tell(pb);
+
     for (int x = mxf->partitions_count - 1; x >= 0; x--) {
         MXFPartition *p = &mxf->partitions[x];
 
-        if (p->body_sid != body_sid)
+        if (p->body_sid != body_sid || mxf_load_partition(mxf, x) < 0)
             continue;
 
+        if (avio_tell(pb) != pos)
+            avio_seek(pb, pos, SEEK_SET);
+
         if (!p->essence_length)
             return 0;
 
         return p->essence_offset + p->essence_length;
     }
 
+    if (avio_tell(pb) != pos)
+        avio_seek(pb, pos, SEEK_SET);
+
     return 0;
 }
 
@@ -2016,7 +2067,8 @@ static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_ta
             return 0;                               /* no TemporalOffsets */
         }
 
-        if (s->index_duration > INT_MAX - index_table->nb_ptses) {
+        if (s->index_duration > INT_MAX - index_table->nb_ptses ||
+            mxf->lazy_index && s->index_start_position > INT_MAX - s->index_duration) {
             index_table->nb_ptses = 0;
             av_log(mxf->fc, AV_LOG_ERROR, "ignoring IndexSID %d, duration is too large\n", s->index_sid);
             return 0;
@@ -2030,7 +2082,12 @@ static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_ta
             return 0;
         }
 
-        index_table->nb_ptses += s->index_duration;
+        /* while segments are loaded lazily they are placed at their IndexStartPosition,
+         * leaving the missing ones as gaps */
+        if (mxf->lazy_index)
+            index_table->nb_ptses = FFMAX(index_table->nb_ptses, s->index_start_position + s->index_duration);
+        else
+            index_table->nb_ptses += s->index_duration;
     }
 
     /* paranoid check */
@@ -2039,7 +2096,7 @@ static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_ta
 
     if (!(index_table->ptses      = av_malloc_array(index_table->nb_ptses, sizeof(int64_t))) ||
         !(index_table->fake_index = av_calloc(index_table->nb_ptses, sizeof(AVIndexEntry))) ||
-        !(index_table->offsets    = av_malloc_array(index_table->nb_ptses, sizeof(int8_t))) ||
+        !(index_table->offsets    = av_calloc(index_table->nb_ptses, sizeof(int8_t))) ||
         !(flags                   = av_malloc_array(index_table->nb_ptses, sizeof(uint8_t)))) {
         av_freep(&index_table->ptses);
         av_freep(&index_table->fake_index);
@@ -2090,6 +2147,9 @@ static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_ta
             /* ignore the last entry - it's the size of the essence container in Avid */
             n--;
 
+        if (mxf->lazy_index)
+            x = s->index_start_position;
+
         for (j = 0; j < n; j += index_delta, x++) {
             int offset = s->temporal_offset_entries[j] / index_delta;
             int index  = x + offset;
@@ -2186,7 +2246,7 @@ static int mxf_compute_index_tables(MXFContext *mxf)
             goto finish_decoding_index;
         }
 
-        if (sorted_segments[i]->index_start_position)
+        if (sorted_segments[i]->index_start_position && !mxf->lazy_index)
             av_log(mxf->fc, AV_LOG_WARNING, "IndexSID %i starts at EditUnit %"PRId64" - seeking may not work as expected\n",
                    sorted_segments[i]->index_sid, sorted_segments[i]->index_start_position);
 
@@ -3422,6 +3482,19 @@ static int mxf_is_partition_pack_key(UID key)
             key[13] >= 2 && key[13] <= 4;
 }
 
+/**
+ * @return non-zero if the KLV is essence, including encrypted essence and system items
+ */
+static int mxf_is_essence_klv(const KLVPacket *klv)
+{
+    return mxf_match_uid(klv->key, mxf_encrypted_triplet_key, sizeof(mxf_encrypted_triplet_key)) ||
+           IS_KLV_KEY(klv->key, mxf_essence_element_key) ||
+           IS_KLV_KEY(klv->key, mxf_canopus_essence_element_key) ||
+           IS_KLV_KEY(klv->key, mxf_avid_essence_element_key) ||
+           IS_KLV_KEY(klv->key, mxf_system_item_key_cp) ||
+           IS_KLV_KEY(klv->key, mxf_system_item_key_gc);
+}
+
 /**
  * Parses a metadata KLV
  * @return <0 on error, 0 otherwise
@@ -3468,6 +3541,9 @@ static int mxf_seek_to_previous_partition(MXFContext *mxf)
         mxf->run_in + mxf->current_partition->previous_partition <= mxf->last_forward_tell)
         return 0;   /* we've parsed all partitions */
 
+    if (mxf->nb_rip_entries)
+        return 0;   /* the other partitions are read when needed */
+
     /* seek to previous partition */
     current_partition_ofs = mxf->current_partition->pack_ofs;   //includes run-in
     avio_seek(pb, mxf->run_in + mxf->current_partition->previous_partition, SEEK_SET);
@@ -3567,47 +3643,53 @@ static MXFWrappingScheme mxf_get_wrapping_by_body_sid(AVFormatContext *s, int bo
 }
 
 /**
- * Figures out the proper offset and length of the essence container in each partition
+ * Figures out the proper offset and length of the essence container in a partition
  */
-static void mxf_compute_essence_containers(AVFormatContext *s)
+static void mxf_compute_essence_container(AVFormatContext *s, int x)
 {
     MXFContext *mxf = s->priv_data;
-    int x;
-
-    for (x = 0; x < mxf->partitions_count; x++) {
-        MXFPartition *p = &mxf->partitions[x];
-        MXFWrappingScheme wrapping;
+    MXFPartition *p = &mxf->partitions[x];
+    MXFWrappingScheme wrapping;
 
-        if (!p->body_sid)
-            continue;       /* BodySID == 0 -> no essence */
+    if (!p->body_sid)
+        return;         /* BodySID == 0 -> no essence */
 
-        /* for clip wrapped essences we point essence_offset after the KL (usually klv.offset + 20 or 25)
-         * otherwise we point essence_offset at the key of the first essence KLV.
-         */
+    /* for clip wrapped essences we point essence_offset after the KL (usually klv.offset + 20 or 25)
+     * otherwise we point essence_offset at the key of the first essence KLV.
+     */
 
-        wrapping = (mxf->op == OPAtom) ? ClipWrapped : mxf_get_wrapping_by_body_sid(s, p->body_sid);
+    wrapping = (mxf->op == OPAtom) ? ClipWrapped : mxf_get_wrapping_by_body_sid(s, p->body_sid);
 
-        if (wrapping == ClipWrapped) {
-            p->essence_offset = p->first_essence_klv.next_klv - p->first_essence_klv.length;
-            p->essence_length = p->first_essence_klv.length;
-        } else {
-            p->essence_offset = p->first_essence_klv.offset;
+    if (wrapping == ClipWrapped) {
+        p->essence_offset = p->first_essence_klv.next_klv - p->first_essence_klv.length;
+        p->essence_length = p->first_essence_klv.length;
+    } else {
+        p->essence_offset = p->first_essence_klv.offset;
 
-            /* essence container spans to the next partition */
-            if (x < mxf->partitions_count - 1)
-                p->essence_length = mxf->partitions[x+1].pack_ofs - mxf->run_in - p->essence_offset;
+        /* essence container spans to the next partition */
+        if (x < mxf->partitions_count - 1)
+            p->essence_length = mxf->partitions[x+1].pack_ofs - mxf->run_in - p->essence_offset;
 
-            if (p->essence_length < 0) {
-                /* next ThisPartition < essence_offset */
-                p->essence_length = 0;
-                av_log(mxf->fc, AV_LOG_ERROR,
-                       "partition %i: bad ThisPartition = %"PRIX64"\n",
-                       x+1, mxf->partitions[x+1].pack_ofs - mxf->run_in);
-            }
+        if (p->essence_length < 0) {
+            /* next ThisPartition < essence_offset */
+            p->essence_length = 0;
+            av_log(mxf->fc, AV_LOG_ERROR,
+                   "partition %i: bad ThisPartition = %"PRIX64"\n",
+                   x+1, mxf->partitions[x+1].pack_ofs - mxf->run_in);
         }
     }
 }
 
+static void mxf_compute_essence_containers(AVFormatContext *s)
+{
+    MXFContext *mxf = s->priv_data;
+
+    /* lazy partitions are handled when they are loaded */
+    for (int x = 0; x < mxf->partitions_count; x++)
+        if (!mxf->partitions[x].lazy)
+            mxf_compute_essence_container(s, x);
+}
+
 static MXFIndexTable *mxf_find_index_table(MXFContext *mxf, int index_sid)
 {
     int i;
@@ -3617,6 +3699,345 @@ static MXFIndexTable *mxf_find_index_table(MXFContext *mxf, int index_sid)
     return NULL;
 }
 
+static int mxf_compare_partitions(const void *a, const void *b)
+{
+    const MXFPartition *p1 = a, *p2 = b;
+    return FFDIFFSIGN(p1->pack_ofs, p2->pack_ofs);
+}
+
+/**
+ * Adds the partitions listed in the RandomIndexPack that were not read
+ * while opening the file. They are read by mxf_load_partition() when needed.
+ */
+static int mxf_add_lazy_partitions(MXFContext *mxf)
+{
+    int64_t file_size = avio_size(mxf->fc->pb);
+    int nb_partitions = mxf->partitions_count;
+    MXFPartition *partitions;
+    int i, j;
+
+    if (!mxf->nb_rip_entries)
+        return 0;
+
+    partitions = av_realloc_array(mxf->partitions, mxf->partitions_count + mxf->nb_rip_entries,
+                                  sizeof(*mxf->partitions));
+    if (!partitions)
+        return AVERROR(ENOMEM);
+    mxf->partitions = partitions;
+    mxf->current_partition = NULL;
+
+    for (i = 0; i < mxf->nb_rip_entries; i++) {
+        const MXFRandomIndexEntry *e = &mxf->rip_entries[i];
+        MXFPartition *p;
+
+        if (e->offset >= file_size - mxf->run_in)
+            continue;
+        for (j = 0; j < nb_partitions; j++)
+            if (partitions[j].pack_ofs == mxf->run_in + e->offset)
+                break;
+        if (j < nb_partitions)
+            continue;   /* already read */
+
+        p = &partitions[mxf->partitions_count++];
+        memset(p, 0, sizeof(*p));
+        p->type     = BodyPartition;
+        p->body_sid = e->body_sid;
+        p->pack_ofs = mxf->run_in + e->offset;
+        p->lazy     = 1;
+    }
+
+    if (mxf->partitions_count == nb_partitions)
+        return 0;
+
+    qsort(partitions, mxf->partitions_count, sizeof(*partitions), mxf_compare_partitions);
+
+    /* drop duplicate RIP entries */
+    for (i = j = 1; i < mxf->partitions_count; i++)
+        if (partitions[i].pack_ofs != partitions[j - 1].pack_ofs)
+            partitions[j++] = partitions[i];
+    mxf->partitions_count = j;
+
+    for (i = 0; i < mxf->partitions_count; i++)
+        mxf->nb_lazy_partitions += partitions[i].lazy;
+    mxf->lazy_index = 1;
+
+    av_log(mxf->fc, AV_LOG_VERBOSE, "%d partitions will be read when needed\n",
+           mxf->nb_lazy_partitions);
+
+    return 0;
+}
+
+/**
+ * Reads a partition that is only known from the RandomIndexPack: its pack,
+ * the position of its essence and, while the index is incomplete, its
+ * index table segments. Header metadata is skipped.
+ * This moves the position of the IO context, the caller has to restore it.
+ * @return <0 if the partition could not be read, 0 otherwise
+ */
+static int mxf_load_partition(MXFContext *mxf, int x)
+{
+    AVFormatContext *s = mxf->fc;
+    MXFMetadataSetGroup *mg = &mxf->metadata_set_groups[IndexTableSegment];
+    MXFPartition *current_partition = mxf->current_partition;
+    MXFPartition *p = &mxf->partitions[x];
+    int64_t pack_ofs = p->pack_ofs;
+    int nb_segments = mg->metadata_sets_count;
+    KLVPacket klv;
+    int ret;
+
+    if (!p->lazy)
+        return 0;
+
+    av_log(s, AV_LOG_TRACE, "loading partition @ %#"PRIx64"\n", pack_ofs);
+
+    mxf->lazy_partition = p;
+    if ((ret = avio_seek(s->pb, pack_ofs, SEEK_SET)) < 0 ||
+        (ret = klv_read_packet(mxf, &klv, s->pb)) < 0)
+        goto end;
+    if (klv.offset != pack_ofs || !mxf_is_partition_pack_key(klv.key)) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    if ((ret = mxf_parse_klv(mxf, klv, mxf_read_partition_pack, 0, 0)) < 0)
+        goto end;
+
+    while (!avio_feof(s->pb) && klv_read_packet(mxf, &klv, s->pb) >= 0) {
+        if (mxf_is_partition_pack_key(klv.key) ||
+            IS_KLV_KEY(klv.key, ff_mxf_random_index_pack_key))
+            break;
+        if (mxf_is_essence_klv(&klv)) {
+            p->first_essence_klv = klv;
+            break;
+        }
+        if (mxf->lazy_index && IS_KLV_KEY(klv.key, mxf_index_table_segment_key)) {
+            if ((ret = mxf_parse_klv(mxf, klv, mxf_read_index_table_segment,
+                                     sizeof(MXFIndexTableSegment), IndexTableSegment)) < 0)
+                goto end;
+        } else {
+            avio_skip(s->pb, klv.length);
+        }
+    }
+
+    for (int i = nb_segments; i < mg->metadata_sets_count; i++) {
+        MXFIndexTableSegment *segment = (MXFIndexTableSegment *)mg->metadata_sets[i];
+        int64_t end = av_sat_add64(segment->index_start_position, segment->index_duration);
+
+        mxf->index_tables_dirty = 1;
+        if (segment->index_sid != p->index_sid || end <= segment->index_start_position)
+            continue;
+        if (p->index_end > p->index_start) {
+            p->index_start = FFMIN(p->index_start, segment->index_start_position);
+            p->index_end   = FFMAX(p->index_end, end);
+        } else {
+            p->index_start = segment->index_start_position;
+            p->index_end   = end;
+        }
+    }
+
+    mxf_compute_essence_container(s, x);
+    ret = 0;
+
+end:
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "failed to read the partition @ %#"PRIx64"\n", pack_ofs);
+        /* keep it out of the way, without essence */
+        memset(p, 0, sizeof(*p));
+        p->type     = BodyPartition;
+        p->pack_ofs = pack_ofs;
+    }
+    /* recompute the index tables without the lazy layout of the PTSes */
+    if (!--mxf->nb_lazy_partitions)
+        mxf->index_tables_dirty = 1;
+    mxf->lazy_partition    = NULL;
+    mxf->current_partition = current_partition;
+    return ret;
+}
+
+static void mxf_free_index_tables(MXFContext *mxf)
+{
+    for (int i = 0; i < mxf->nb_index_tables; i++) {
+        av_freep(&mxf->index_tables[i].segments);
+        av_freep(&mxf->index_tables[i].ptses);
+        av_freep(&mxf->index_tables[i].fake_index);
+        av_freep(&mxf->index_tables[i].offsets);
+    }
+    av_freep(&mxf->index_tables);
+    mxf->nb_index_tables = 0;
+}
+
+/**
+ * @return 1 if each index table covers the whole duration of its tracks without gaps
+ */
+static int mxf_index_tables_complete(MXFContext *mxf)
+{
+    AVFormatContext *s = mxf->fc;
+
+    if (!mxf->nb_index_tables)
+        return 0;
+
+    for (int i = 0; i < mxf->nb_index_tables; i++) {
+        MXFIndexTable *t = &mxf->index_tables[i];
+        int64_t end = 0;
+
+        for (int j = 0; j < t->nb_segments; j++) {
+            if (t->segments[j]->index_start_position != end)
+                return 0;
+            end = av_sat_add64(end, t->segments[j]->index_duration);
+        }
+
+        for (int j = 0; j < s->nb_streams; j++) {
+            MXFTrack *track = s->streams[j]->priv_data;
+            if (track && track->index_sid == t->index_sid &&
+                end < av_rescale_q(track->original_duration, t->segments[0]->index_edit_rate, track->edit_rate))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Recomputes the index tables if index table segments were loaded.
+ */
+static int mxf_update_index_tables(MXFContext *mxf)
+{
+    int ret;
+
+    if (!mxf->index_tables_dirty)
+        return 0;
+    mxf->index_tables_dirty = 0;
+
+    if (!mxf->nb_lazy_partitions)
+        mxf->lazy_index = 0;
+
+    mxf_free_index_tables(mxf);
+    if ((ret = mxf_compute_index_tables(mxf)) < 0)
+        return ret;
+
+    if (mxf->lazy_index)
+        mxf->lazy_index = !mxf_index_tables_complete(mxf);
+
+    return 0;
+}
+
+static MXFIndexTableSegment *mxf_find_index_segment(MXFIndexTable *t, int64_t edit_unit)
+{
+    MXFIndexTableSegment *segment;
+    int a = 0, b = t->nb_segments;
+
+    if (!t->nb_segments)
+        return NULL;
+
+    while (b - a > 1) {
+        int m = (a + b) >> 1;
+        if (t->segments[m]->index_start_position <= edit_unit)
+            a = m;
+        else
+            b = m;
+    }
+
+    segment = t->segments[a];
+    if (edit_unit < segment->index_start_position ||
+        edit_unit - segment->index_start_position >= segment->index_duration)
+        return NULL;
+    return segment;
+}
+
+/**
+ * Loads the index table segment of an IndexSID covering the given edit unit
+ * (in IndexEditRate units) from the lazy partitions, if it isn't loaded yet.
+ */
+static int mxf_load_index_segment(MXFContext *mxf, int index_sid, int64_t edit_unit, int64_t duration)
+{
+    AVIOContext *pb = mxf->fc->pb;
+    int64_t pos = avio_tell(pb);
+    int64_t lo = 0, hi = duration > edit_unit ? duration : 0;
+    MXFIndexTable *t;
+    int a, b, ret, slow = 0;
+
+    if ((ret = mxf_update_index_tables(mxf)) < 0 || !mxf->lazy_index)
+        return ret;
+
+    t = mxf_find_index_table(mxf, index_sid);
+    if (t && mxf_find_index_segment(t, edit_unit))
+        return 0;
+
+    /* search the partitions, their segments are in edit unit order.
+     * Interpolate on the edit units when they are known, partitions usually
+     * have about the same duration, unless that did not halve the range twice. */
+    a = -1;
+    b = mxf->partitions_count;
+    while (b - a > 1) {
+        int m = (a + b) >> 1, k, width = b - a;
+        MXFPartition *p = NULL;
+
+        if (hi > lo && slow < 2)
+            m = a + 1 + av_rescale(edit_unit - lo, b - a - 2, hi - lo);
+
+        /* the first partition from m on with segments of this IndexSID */
+        for (k = m; k < b; k++) {
+            p = &mxf->partitions[k];
+            if (mxf_load_partition(mxf, k) >= 0 &&
+                p->index_sid == index_sid && p->index_end > p->index_start)
+                break;
+        }
+
+        if (k == b) {
+            b = m;
+        } else if (edit_unit < p->index_start) {
+            b  = m;
+            hi = p->index_start;
+        } else if (edit_unit >= p->index_end) {
+            a  = k;
+            lo = p->index_end;
+        } else {
+            break;
+        }
+        slow = 2 * (b - a) > width ? slow + 1 : 0;
+    }
+
+    if (avio_tell(pb) != pos)
+        avio_seek(pb, pos, SEEK_SET);
+
+    return mxf_update_index_tables(mxf);
+}
+
+/**
+ * Makes sure the index covers the given edit unit of a track while the index
+ * table segments are loaded lazily.
+ * @param neighbours also load the segments before and after the one covering
+ *                   the edit unit, for searching keyframes around it
+ */
+static int mxf_load_index(MXFContext *mxf, MXFTrack *track, int64_t edit_unit, int neighbours)
+{
+    MXFIndexTableSegment *segment;
+    MXFIndexTable *t;
+    int64_t duration = track->original_duration;
+    int ret;
+
+    if ((ret = mxf_update_index_tables(mxf)) < 0 || !mxf->lazy_index || !track->index_sid ||
+        edit_unit < 0 || duration > 0 && edit_unit >= duration)
+        return ret;
+
+    if ((t = mxf_find_index_table(mxf, track->index_sid))) {
+        edit_unit = av_rescale_q(edit_unit, t->segments[0]->index_edit_rate, track->edit_rate);
+        duration  = av_rescale_q(duration,  t->segments[0]->index_edit_rate, track->edit_rate);
+    }
+
+    if ((ret = mxf_load_index_segment(mxf, track->index_sid, edit_unit, duration)) < 0 || !neighbours ||
+        !mxf->lazy_index || !(t = mxf_find_index_table(mxf, track->index_sid)) ||
+        !(segment = mxf_find_index_segment(t, edit_unit)))
+        return ret;
+
+    edit_unit = segment->index_start_position + segment->index_duration;
+    if (segment->index_start_position > 0 &&
+        (ret = mxf_load_index_segment(mxf, track->index_sid, segment->index_start_position - 1, duration)) < 0)
+        return ret;
+    if (duration <= 0 || edit_unit < duration)
+        ret = mxf_load_index_segment(mxf, track->index_sid, edit_unit, duration);
+    return ret;
+}
+
 /**
  * Deal with the case where for some audio atoms EditUnitByteCount is
  * very small (2, 4..). In those cases we should read more than one
@@ -3687,6 +4108,14 @@ static int mxf_handle_missing_index_segment(MXFContext *mxf, AVStream *st)
     if (essence_partition_count != 1)
         return 0;
 
+    if (p->lazy) {
+        int64_t pos = avio_tell(mxf->fc->pb);
+        ret = mxf_load_partition(mxf, p - mxf->partitions);
+        avio_seek(mxf->fc->pb, pos, SEEK_SET);
+        if (ret < 0)
+            return 0;
+    }
+
     if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO && is_pcm(st->codecpar->codec_id)) {
         edit_unit_byte_count = (av_get_bits_per_sample(st->codecpar->codec_id) *
                                 st->codecpar->ch_layout.nb_channels) >> 3;
@@ -3761,13 +4190,27 @@ static void mxf_read_random_index_pack(AVFormatContext *s)
         goto end;
     }
 
-    avio_skip(s->pb, klv.length - 12);
-    mxf->footer_partition = avio_rb64(s->pb);
+    if (mxf->fast_open) {
+        int nb_entries = (klv.length - 4) / 12;
+
+        if (!(mxf->rip_entries = av_malloc_array(nb_entries, sizeof(*mxf->rip_entries))))
+            goto end;
+        for (int i = 0; i < nb_entries; i++) {
+            mxf->rip_entries[i].body_sid = avio_rb32(s->pb);
+            mxf->rip_entries[i].offset   = avio_rb64(s->pb);
+        }
+        mxf->nb_rip_entries = nb_entries;
+        mxf->footer_partition = mxf->rip_entries[nb_entries - 1].offset;
+    } else {
+        avio_skip(s->pb, klv.length - 12);
+        mxf->footer_partition = avio_rb64(s->pb);
+    }
 
     /* sanity check */
     if (mxf->run_in + mxf->footer_partition >= file_size) {
         av_log(s, AV_LOG_WARNING, "bad FooterPartition in RIP - ignoring\n");
         mxf->footer_partition = 0;
+        mxf->nb_rip_entries = 0;
     }
 
 end:
@@ -3813,13 +4256,7 @@ static int mxf_read_header(AVFormatContext *s)
 
         PRINT_KEY(s, "read header", klv.key);
         av_log(s, AV_LOG_TRACE, "size %"PRIu64" offset %#"PRIx64"\n", klv.length, klv.offset);
-        if (mxf_match_uid(klv.key, mxf_encrypted_triplet_key, sizeof(mxf_encrypted_triplet_key)) ||
-            IS_KLV_KEY(klv.key, mxf_essence_element_key) ||
-            IS_KLV_KEY(klv.key, mxf_canopus_essence_element_key) ||
-            IS_KLV_KEY(klv.key, mxf_avid_essence_element_key) ||
-            IS_KLV_KEY(klv.key, mxf_system_item_key_cp) ||
-            IS_KLV_KEY(klv.key, mxf_system_item_key_gc)) {
-
+        if (mxf_is_essence_klv(&klv)) {
             if (!mxf->current_partition) {
                 av_log(mxf->fc, AV_LOG_ERROR, "found essence prior to first PartitionPack\n");
                 return AVERROR_INVALIDDATA;
@@ -3869,6 +4306,9 @@ static int mxf_read_header(AVFormatContext *s)
     }
     avio_seek(s->pb, essence_offset, SEEK_SET);
 
+    if ((ret = mxf_add_lazy_partitions(mxf)) < 0)
+        return ret;
+
     /* we need to do this before computing the index tables
      * to be able to fill in zero IndexDurations with st->duration */
     if ((ret = mxf_parse_structural_metadata(mxf)) < 0)
@@ -3880,6 +4320,9 @@ static int mxf_read_header(AVFormatContext *s)
     if ((ret = mxf_compute_index_tables(mxf)) < 0)
         return ret;
 
+    if (mxf->lazy_index)
+        mxf->lazy_index = !mxf_index_tables_complete(mxf);
+
     if (mxf->nb_index_tables > 1) {
         /* TODO: look up which IndexSID to use via EssenceContainerData */
         av_log(mxf->fc, AV_LOG_INFO, "got %i index tables - only the first one (IndexSID %i) will be used\n",
@@ -3960,9 +4403,17 @@ static int64_t mxf_set_current_edit_unit(MXFContext *mxf, AVStream *st, int64_t
     MXFTrack *track = st->priv_data;
     int64_t edit_unit = av_rescale_q(track->sample_count, st->time_base, av_inv_q(track->edit_rate));
     int64_t new_edit_unit;
-    MXFIndexTable *t = mxf_find_index_table(mxf, track->index_sid);
+    MXFIndexTable *t;
+
+    if (track->wrapping == UnknownWrapped || edit_unit > INT64_MAX - track->edit_units_per_packet)
+        return -1;
+
+    if (mxf->lazy_index &&
+        (mxf_load_index(mxf, track, edit_unit, 0) < 0 ||
+         mxf_load_index(mxf, track, edit_unit + track->edit_units_per_packet, 0) < 0))
+        return -1;
 
-    if (!t || track->wrapping == UnknownWrapped || edit_unit > INT64_MAX - track->edit_units_per_packet)
+    if (!(t = mxf_find_index_table(mxf, track->index_sid)))
         return -1;
 
     if (mxf_edit_unit_absolute_offset(mxf, t, edit_unit + track->edit_units_per_packet, track->edit_rate, NULL, &next_ofs, NULL, 0) < 0 &&
@@ -4190,18 +4641,11 @@ static int mxf_read_close(AVFormatContext *s)
         av_freep(&mg->metadata_sets);
     }
     av_freep(&mxf->partitions);
+    av_freep(&mxf->rip_entries);
     av_freep(&mxf->aesc);
     av_freep(&mxf->local_tags);
 
-    if (mxf->index_tables) {
-        for (int i = 0; i < mxf->nb_index_tables; i++) {
-            av_freep(&mxf->index_tables[i].segments);
-            av_freep(&mxf->index_tables[i].ptses);
-            av_freep(&mxf->index_tables[i].fake_index);
-            av_freep(&mxf->index_tables[i].offsets);
-        }
-    }
-    av_freep(&mxf->index_tables);
+    mxf_free_index_tables(mxf);
 
     return 0;
 }
@@ -4251,6 +4695,10 @@ static int mxf_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         sample_time = av_rescale_q(sample_time, st->time_base,
                                    av_inv_q(source_track->edit_rate));
 
+    if (mxf->lazy_index &&
+        (ret = mxf_load_index(mxf, source_track, FFMAX(sample_time, 0), 1)) < 0)
+        return ret;
+
     if (mxf->nb_index_tables <= 0) {
         if (!s->bit_rate)
             return AVERROR_INVALIDDATA;
@@ -4348,6 +4796,9 @@ static const AVOption options[] = {
     { "eia608_extract", "extract eia 608 captions from s436m track",
       offsetof(MXFContext, eia608_extract), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,
       AV_OPT_FLAG_DECODING_PARAM },
+    { "fast_open", "read only the header and footer partitions when opening, other partitions when needed",
+      offsetof(MXFContext, fast_open), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,
+      AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -3561,40 +3561,24 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, int flus
         stream_count += !!ffstream(s->streams[i])->last_in_packet_buffer;
 
     if (stream_count && (s->nb_streams == stream_count || flush)) {
-        PacketListEntry *pktl = si->packet_buffer.head;
         if (s->nb_streams != stream_count) {
+            PacketListEntry *pktl = si->packet_buffer.head;
             PacketListEntry *last = NULL;
             // find last packet in edit unit
             while (pktl) {
                 if (!stream_count || pktl->pkt.stream_index == 0)
                     break;
-                // update last packet in packet buffer
-                if (ffstream(s->streams[pktl->pkt.stream_index])->last_in_packet_buffer != pktl)
-                    ffstream(s->streams[pktl->pkt.stream_index])->last_in_packet_buffer = pktl;
                 last = pktl;
                 pktl = pktl->next;
                 stream_count--;
             }
             // purge packet queue
-            while (pktl) {
-                PacketListEntry *next = pktl->next;
-                av_packet_unref(&pktl->pkt);
-                av_freep(&pktl);
-                pktl = next;
-            }
-            if (last)
-                last->next = NULL;
-            else {
-                si->packet_buffer.head = NULL;
-                si->packet_buffer.tail = NULL;
+            ff_interleave_drop_packets(s, last);
+            if (!last)
                 goto out;
-            }
-            pktl = si->packet_buffer.head;
         }
 
-        if (ffstream(s->streams[pktl->pkt.stream_index])->last_in_packet_buffer == pktl)
-            ffstream(s->streams[pktl->pkt.stream_index])->last_in_packet_buffer = NULL;
-        avpriv_packet_list_get(&si->packet_buffer, out);
+        ff_interleave_get_packet(s, out);
         av_log(s, AV_LOG_TRACE, "out st:%d dts:%"PRId64"\n", out->stream_index, out->dts);
         return 1;
     } else {
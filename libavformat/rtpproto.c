@@ -57,6 +57,10 @@ typedef struct RTPContext {
     int connect;
     int pkt_size;
     int dscp;
+    int batch_size;
+    int64_t bitrate;
+    int gso;
+    int fifo_size;
     char *sources;
     char *block;
     char *fec_options_str;
@@ -82,6 +86,10 @@ static const AVOption options[] = {
     { "write_to_source",    "Send packets to the source address of the latest received packet", OFFSET(write_to_source), AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "pkt_size",           "Maximum packet size",                                              OFFSET(pkt_size),        AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "dscp",               "DSCP class",                                                       OFFSET(dscp),            AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
+    { "batch_size",         "Max number of RTP packets per system call (output only)",          OFFSET(batch_size),      AV_OPT_TYPE_INT,    { .i64 =  1 },     1, 64,      .flags = E },
+    { "bitrate",            "Bits to send per second (output only)",                            OFFSET(bitrate),         AV_OPT_TYPE_INT64,  { .i64 =  0 },     0, INT64_MAX, .flags = E },
+    { "gso",                "Use UDP segmentation offload for batches (output only)",           OFFSET(gso),             AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = E },
+    { "fifo_size",          "UDP send queue size (in 188-byte packets) for batch_size/bitrate", OFFSET(fifo_size),       AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = E },
     { "timeout",            "set timeout (in microseconds) of socket I/O operations",           OFFSET(rw_timeout),      AV_OPT_TYPE_INT64,  { .i64 = -1 },    -1, INT64_MAX, .flags = D|E },
     { "sources",            "Source list",                                                      OFFSET(sources),         AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",              "Block list",                                                       OFFSET(block),           AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -183,7 +191,8 @@ static void build_udp_url(RTPContext *s,
                           const char *localaddr,
                           int port, int local_port,
                           const char *include_sources,
-                          const char *exclude_sources)
+                          const char *exclude_sources,
+                          int queued)
 {
     ff_url_join(buf, buf_size, "udp", NULL, hostname, port, NULL);
     if (local_port >= 0)
@@ -198,7 +207,18 @@ static void build_udp_url(RTPContext *s,
         url_add_option(buf, buf_size, "connect=1");
     if (s->dscp >= 0)
         url_add_option(buf, buf_size, "dscp=%d", s->dscp);
-    url_add_option(buf, buf_size, "fifo_size=0");
+    if (queued) {
+        /* let the UDP send thread batch and pace the packets */
+        if (s->fifo_size >= 0)
+            url_add_option(buf, buf_size, "fifo_size=%d", s->fifo_size);
+        if (s->batch_size > 1)
+            url_add_option(buf, buf_size, "batch_size=%d", s->batch_size);
+        if (s->bitrate)
+            url_add_option(buf, buf_size, "bitrate=%"PRId64, s->bitrate);
+        if (s->gso)
+            url_add_option(buf, buf_size, "gso=1");
+    } else
+        url_add_option(buf, buf_size, "fifo_size=0");
     if (include_sources && include_sources[0])
         url_add_option(buf, buf_size, "sources=%s", include_sources);
     if (exclude_sources && exclude_sources[0])
@@ -219,6 +239,10 @@ static void build_udp_url(RTPContext *s,
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
  *         'dscp=n'           : set DSCP value to n (QoS)
+ *         'batch_size=n'     : send up to n RTP packets per system call
+ *         'bitrate=n'        : pace the RTP packets to n bits per second
+ *         'gso=0/1'          : use UDP segmentation offload for batches
+ *         'fifo_size=n'      : size of the send queue used by batch_size and bitrate
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -240,6 +264,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     const char *p;
     int i, max_retry_count = 3;
     int rtcpflags;
+    int queued;
     int ret;
 
     av_url_split(NULL, 0, NULL, 0, hostname, sizeof(hostname), &rtp_port,
@@ -292,12 +317,17 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
     }
 
+    /* Only RTP packets go through the UDP send queue; RTCP and received
+     * packets are still handled directly on the sockets. */
+    queued = (flags & AVIO_FLAG_WRITE) && !(flags & AVIO_FLAG_READ) &&
+             !s->write_to_source && (s->batch_size > 1 || s->bitrate);
+
     for (i = 0; i < max_retry_count; i++) {
         const char *sources = s->sources ? s->sources : "";
         const char *block = s->block ? s->block : "";
         build_udp_url(s, buf, sizeof(buf),
                       hostname, s->localaddr, rtp_port, s->local_rtpport,
-                      sources, block);
+                      sources, block, queued);
         ret = ffurl_open_whitelist(&s->rtp_hd, buf, flags, &h->interrupt_callback,
                                    NULL, h->protocol_whitelist, h->protocol_blacklist, h);
         if (ret < 0)
@@ -312,7 +342,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
             s->local_rtcpport = s->local_rtpport + 1;
             build_udp_url(s, buf, sizeof(buf),
                           hostname, s->localaddr, s->rtcp_port, s->local_rtcpport,
-                          sources, block);
+                          sources, block, 0);
             if (ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags,
                                      &h->interrupt_callback, NULL,
                                      h->protocol_whitelist, h->protocol_blacklist, h) < 0) {
@@ -323,7 +353,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         }
         build_udp_url(s, buf, sizeof(buf),
                       hostname, s->localaddr, s->rtcp_port, s->local_rtcpport,
-                      sources, block);
+                      sources, block, 0);
         ret = ffurl_open_whitelist(&s->rtcp_hd, buf, rtcpflags, &h->interrupt_callback,
                                    NULL, h->protocol_whitelist, h->protocol_blacklist, h);
         if (ret < 0)
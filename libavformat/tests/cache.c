@@ -0,0 +1,188 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if HAVE_UTIME
+#include <utime.h>
+#endif
+
+#include "libavutil/dict.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavformat/avio.h"
+#include "libavformat/internal.h"
+#include "libavformat/url.h"
+
+#define SIZE (300 * 1024 + 123)
+
+static uint8_t data[SIZE];
+
+/* Check that size bytes read at pos through pb match the test data. */
+static int check_read(AVIOContext *pb, int64_t pos, int size)
+{
+    uint8_t *buf = av_malloc(size);
+    int ret = -1;
+
+    if (buf && avio_seek(pb, pos, SEEK_SET) == pos &&
+        avio_read(pb, buf, size) == size)
+        ret = memcmp(buf, data + pos, size) ? -1 : 0;
+    av_free(buf);
+    return ret;
+}
+
+/* The inner protocol is seeked without reading before going back into
+ * the range of the resource which is known but not cached yet. */
+static int test_seek_without_read(const char *url)
+{
+    AVIOContext *pb = NULL;
+    int ret;
+
+    if (avio_open2(&pb, url, AVIO_FLAG_READ, NULL, NULL) < 0)
+        return -1;
+    ret = avio_seek(pb, SIZE / 2, SEEK_SET) == SIZE / 2 ? 0 : -1;
+    if (!ret)
+        ret = check_read(pb, 0, 4096);
+    avio_closep(&pb);
+    return ret;
+}
+
+static int read_cache_dir(const char *url, const char *dir, int full)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *opts = NULL;
+    int ret;
+
+    av_dict_set(&opts, "cache_dir", dir, 0);
+    av_dict_set(&opts, "cache_chunk_size", "65536", 0);
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    ret = check_read(pb, 0, SIZE);
+    if (!ret && !full)
+        ret = avio_size(pb) == SIZE ? check_read(pb, SIZE / 3, 10000) : -1;
+    avio_closep(&pb);
+    return ret;
+}
+
+static void create_tmp_chunk(const char *dir, char c, time_t mtime, char *path, int size)
+{
+    AVIOContext *pb = NULL;
+
+    snprintf(path, size, "%s/%0*d-0.0123abcd.tmp", dir, 64, 0);
+    memset(path + strlen(dir) + 1, c, 64);
+    if (avio_open(&pb, path, AVIO_FLAG_WRITE) >= 0) {
+        avio_w8(pb, 0);
+        avio_closep(&pb);
+    }
+#if HAVE_UTIME
+    {
+        struct utimbuf times = { mtime, mtime };
+        utime(path, &times);
+    }
+#endif
+}
+
+static void remove_dir(const char *dir)
+{
+    AVIODirContext *ctx = NULL;
+    AVIODirEntry *entry = NULL;
+    char path[1024];
+
+    if (avio_open_dir(&ctx, dir, NULL) < 0)
+        return;
+    while (avio_read_dir(ctx, &entry) >= 0 && entry) {
+        if (entry->type == AVIO_ENTRY_FILE) {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->name);
+            ffurl_delete(path);
+        }
+        avio_free_directory_entry(&entry);
+    }
+    avio_close_dir(&ctx);
+    ffurl_delete(dir);
+}
+
+int main(int argc, char **argv)
+{
+    char path[1024], url[1024 + 6], dir[1024], stale[1024 + 80], recent[1024 + 80];
+    AVIOContext *pb = NULL;
+    AVLFG lfg;
+    int ret;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <temporary file prefix>\n", argv[0]);
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s.bin", argv[1]);
+    snprintf(url,  sizeof(url),  "cache:%s", path);
+    snprintf(dir,  sizeof(dir),  "%s.dir", argv[1]);
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int i = 0; i < SIZE; i++)
+        data[i] = av_lfg_get(&lfg);
+    if (avio_open(&pb, path, AVIO_FLAG_WRITE) < 0) {
+        fprintf(stderr, "Could not create %s\n", path);
+        return 1;
+    }
+    avio_write(pb, data, SIZE);
+    avio_closep(&pb);
+
+    ret = test_seek_without_read(url);
+    printf("seek without read: %s\n", ret < 0 ? "failed" : "ok");
+
+    remove_dir(dir);
+    if (ff_mkdir_p(dir) < 0) {
+        fprintf(stderr, "Could not create %s\n", dir);
+        ffurl_delete(path);
+        return 1;
+    }
+    create_tmp_chunk(dir, 'a', time(NULL) - 7200, stale, sizeof(stale));
+    create_tmp_chunk(dir, 'b', time(NULL), recent, sizeof(recent));
+
+    if (read_cache_dir(url, dir, 1) < 0) {
+        printf("read through cache_dir: failed\n");
+        ret = -1;
+    } else {
+        printf("read through cache_dir: ok\n");
+        /* the second read must be served from cache_dir alone */
+        ffurl_delete(path);
+        if (read_cache_dir(url, dir, 0) < 0) {
+            printf("read again from cache_dir: failed\n");
+            ret = -1;
+        } else
+            printf("read again from cache_dir: ok\n");
+    }
+#if HAVE_UTIME && HAVE_DIRENT_H
+    if (avio_check(stale, 0) >= 0) {
+        printf("stale temporary chunk not deleted\n");
+        ret = -1;
+    }
+#endif
+    if (avio_check(recent, 0) < 0) {
+        printf("recent temporary chunk deleted\n");
+        ret = -1;
+    }
+
+    remove_dir(dir);
+    ffurl_delete(path);
+    return ret < 0;
+}
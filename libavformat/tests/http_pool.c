@@ -0,0 +1,147 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/thread.h"
+#include "libavformat/avformat.h"
+#include "libavformat/avio.h"
+#include "libavformat/network.h"
+
+#define NB_REQUESTS 3
+
+static const char reply[] = "HTTP/1.1 200 OK\r\n"
+                            "Content-Length: 5\r\n"
+                            "\r\n"
+                            "hello";
+
+static int server_fd;
+static int nb_connections;
+
+#define MAX_FDS 4
+
+/* Answer NB_REQUESTS keep-alive requests, counting the connections used. */
+static void *server(void *arg)
+{
+    struct pollfd fds[MAX_FDS] = { { server_fd, POLLIN } };
+    char buf[MAX_FDS][1024];
+    int len[MAX_FDS] = { 0 };
+    int nb_fds = 1, nb_requests = 0;
+
+    while (nb_requests < NB_REQUESTS && poll(fds, nb_fds, -1) > 0) {
+        if (fds[0].revents & POLLIN && nb_fds < MAX_FDS) {
+            fds[nb_fds].fd     = accept(server_fd, NULL, NULL);
+            fds[nb_fds].events = POLLIN;
+            if (fds[nb_fds].fd < 0)
+                break;
+            len[nb_fds++] = 0;
+            nb_connections++;
+        }
+        for (int i = 1; i < nb_fds; i++) {
+            char *end;
+            int ret;
+
+            if (!(fds[i].revents & (POLLIN | POLLHUP)))
+                continue;
+            ret = recv(fds[i].fd, buf[i] + len[i], sizeof(buf[i]) - 1 - len[i], 0);
+            if (ret <= 0) {
+                fds[i].events = 0;
+                continue;
+            }
+            len[i] += ret;
+            buf[i][len[i]] = 0;
+            while ((end = strstr(buf[i], "\r\n\r\n"))) {
+                end    += 4;
+                len[i] -= end - buf[i];
+                memmove(buf[i], end, len[i] + 1);
+                if (send(fds[i].fd, reply, strlen(reply), 0) > 0)
+                    nb_requests++;
+            }
+        }
+    }
+    for (int i = 1; i < nb_fds; i++)
+        closesocket(fds[i].fd);
+    return NULL;
+}
+
+static int request(const char *url, const char *tcp_nodelay)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *opts = NULL;
+    char buf[16];
+    int ret;
+
+    av_dict_set(&opts, "connection_pool", "1", 0);
+    av_dict_set(&opts, "tcp_nodelay", tcp_nodelay, 0);
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &opts);
+    if (ret < 0) {
+        printf("Could not open %s\n", url);
+        av_dict_free(&opts);
+        return ret;
+    }
+    ret = avio_read(pb, buf, sizeof(buf) - 1);
+    buf[FFMAX(ret, 0)] = 0;
+    printf("tcp_nodelay=%s: %s, %d unused options\n",
+           tcp_nodelay, buf, av_dict_count(opts));
+    av_dict_free(&opts);
+    avio_closep(&pb);
+    return 0;
+}
+
+int main(void)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+    char url[64];
+
+    /* the pool is only flushed when the last reference is gone */
+    avformat_network_init();
+    avformat_network_init();
+
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    server_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd < 0 ||
+        bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server_fd, 4) < 0 ||
+        getsockname(server_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        printf("Could not set up the server\n");
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+    if (pthread_create(&thread, NULL, server, NULL))
+        return 1;
+
+    /* the second request reuses the connection of the first one, the third
+     * one needs another because its lower protocol options differ; the
+     * first deinit does not drop the pooled connection */
+    request(url, "0");
+    avformat_network_deinit();
+    request(url, "0");
+    request(url, "1");
+
+    pthread_join(thread, NULL);
+    /* closes the pooled connections */
+    avformat_network_deinit();
+    closesocket(server_fd);
+
+    printf("%d requests on %d connections\n", NB_REQUESTS, nb_connections);
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Demux a transport stream whose programs change in the middle while one
+ * program is discarded, and count the packets returned for each PID.
+ *
+ * The first part carries programs 1 and 2 with one stream each. In the
+ * second part, program 3 appears and shares the stream of the discarded
+ * program 1, which must then be returned. Once the second part has started,
+ * program 2 is discarded as well, which must take effect from the next
+ * read on.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavformat/avformat.h"
+
+#define NB_FRAMES  50
+#define FRAME_SIZE 500
+
+typedef struct Buffer {
+    uint8_t *data;
+    int size, pos;
+} Buffer;
+
+static int read_buffer(void *opaque, uint8_t *buf, int buf_size)
+{
+    Buffer *b = opaque;
+
+    buf_size = FFMIN(buf_size, b->size - b->pos);
+    if (!buf_size)
+        return AVERROR_EOF;
+    memcpy(buf, b->data + b->pos, buf_size);
+    b->pos += buf_size;
+    return buf_size;
+}
+
+/* Mux NB_FRAMES frames from first_frame on for programs 1 to nb_programs.
+ * Program 1 and 3 share the first stream, program 2 has the second. */
+static int mux_part(uint8_t **data, int nb_programs, int first_frame)
+{
+    AVFormatContext *s = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    uint8_t payload[FRAME_SIZE] = { 0 };
+    int ret;
+
+    if (!pkt)
+        return AVERROR(ENOMEM);
+    ret = avformat_alloc_output_context2(&s, NULL, "mpegts", NULL);
+    if (ret < 0)
+        goto end;
+    ret = avio_open_dyn_buf(&s->pb);
+    if (ret < 0)
+        goto end;
+
+    for (int i = 0; i < nb_programs; i++) {
+        AVStream *st = i < 2 ? avformat_new_stream(s, NULL) : s->streams[0];
+        AVProgram *program = av_new_program(s, i + 1);
+        char name[16];
+
+        if (!st || !program) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
+        st->codecpar->codec_id   = AV_CODEC_ID_SMPTE_KLV;
+        st->time_base            = (AVRational){ 1, 25 };
+        av_program_add_stream_index(s, i + 1, st->index);
+        snprintf(name, sizeof(name), "program %d", i + 1);
+        av_dict_set(&program->metadata, "service_name", name, 0);
+    }
+
+    ret = avformat_write_header(s, NULL);
+    for (int j = 0; j < NB_FRAMES && ret >= 0; j++) {
+        for (int i = 0; i < s->nb_streams && ret >= 0; i++) {
+            pkt->data         = payload;
+            pkt->size         = sizeof(payload);
+            pkt->stream_index = i;
+            pkt->pts = pkt->dts = av_rescale_q(first_frame + j, (AVRational){ 1, 25 },
+                                               s->streams[i]->time_base);
+            ret = av_write_frame(s, pkt);
+        }
+    }
+    if (ret >= 0)
+        ret = av_write_trailer(s);
+
+end:
+    if (s && s->pb) {
+        int size = avio_close_dyn_buf(s->pb, data);
+        s->pb = NULL;
+        if (ret >= 0)
+            ret = size;
+        else
+            av_freep(data);
+    }
+    avformat_free_context(s);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+static AVProgram *find_program(AVFormatContext *s, int id)
+{
+    for (unsigned i = 0; i < s->nb_programs; i++)
+        if (s->programs[i]->id == id)
+            return s->programs[i];
+    return NULL;
+}
+
+int main(void)
+{
+    AVFormatContext *s = NULL;
+    AVIOContext *pb = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    Buffer b = { 0 };
+    uint8_t *data1 = NULL, *data2 = NULL, *buf = NULL;
+    int size1, size2, count[2][2] = { { 0 } }, ret;
+
+    size1 = mux_part(&data1, 2, 0);
+    size2 = mux_part(&data2, 3, NB_FRAMES);
+    b.data = av_malloc(FFMAX(size1, 0) + FFMAX(size2, 0));
+    buf    = av_malloc(4096);
+    if (size1 < 0 || size2 < 0 || !b.data || !buf || !pkt) {
+        printf("Could not create the transport stream\n");
+        ret = -1;
+        goto end;
+    }
+    memcpy(b.data, data1, size1);
+    memcpy(b.data + size1, data2, size2);
+    b.size = size1 + size2;
+
+    pb = avio_alloc_context(buf, 4096, 0, &b, read_buffer, NULL, NULL);
+    s  = avformat_alloc_context();
+    if (!pb || !s) {
+        if (!pb)
+            av_free(buf);
+        avformat_free_context(s);
+        s   = NULL;
+        ret = -1;
+        goto end;
+    }
+    s->pb = pb;
+    ret = avformat_open_input(&s, NULL, av_find_input_format("mpegts"), NULL);
+    if (ret < 0 || !find_program(s, 1)) {
+        printf("Could not open the transport stream\n");
+        ret = -1;
+        goto end;
+    }
+    find_program(s, 1)->discard = AVDISCARD_ALL;
+
+    while ((ret = av_read_frame(s, pkt)) >= 0) {
+        AVStream *st = s->streams[pkt->stream_index];
+        int second = pkt->pts >= av_rescale_q(NB_FRAMES, (AVRational){ 1, 25 }, st->time_base);
+        AVProgram *program2 = find_program(s, 2);
+
+        if (st->id == 0x100 || st->id == 0x101)
+            count[st->id - 0x100][second]++;
+        if (second && program2)
+            program2->discard = AVDISCARD_ALL;
+        av_packet_unref(pkt);
+    }
+    ret = ret == AVERROR_EOF ? 0 : ret;
+
+    for (int i = 0; i < 2; i++)
+        printf("pid 0x%x: %d packets in the first part, %d in the second\n",
+               0x100 + i, count[i][0], count[i][1]);
+
+end:
+    avformat_close_input(&s);
+    if (pb)
+        av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    av_packet_free(&pkt);
+    av_free(b.data);
+    av_free(data1);
+    av_free(data2);
+    return ret < 0;
+}
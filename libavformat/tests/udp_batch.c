@@ -0,0 +1,142 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Send datagrams of varying sizes over the loopback interface and check that
+ * each one is received whole and in order, with and without batched sending
+ * (sendmmsg, GSO) and receiving (recvmmsg, GRO). Where the kernel lacks one
+ * of them, the protocol falls back to plain sends and receives. With "rtp"
+ * as argument, send them through the RTP protocol, batched and paced.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavformat/avformat.h"
+#include "libavformat/url.h"
+
+#define NB_DATAGRAMS 64
+#define MAX_SIZE     1316
+
+/* runs of full size datagrams, each ended by a shorter one, and a few
+ * short ones in a row, which cannot be sent as one GSO buffer */
+static int datagram_size(int i)
+{
+    switch (i % 8) {
+    case 4:  return 700;
+    case 6:
+    case 7:  return 12 + i;
+    default: return MAX_SIZE;
+    }
+}
+
+/* the first bytes look like an RTP header, so the datagrams can be sent
+ * through the RTP protocol as well */
+static void fill_datagram(uint8_t *buf, int i, int size)
+{
+    buf[0] = 0x80;
+    buf[1] = 96;
+    buf[2] = i >> 8;
+    buf[3] = i;
+    for (int j = 4; j < size; j++)
+        buf[j] = i * 7 + j;
+}
+
+static int run(const char *name, const char *rx_opts, const char *tx_url)
+{
+    URLContext *rx = NULL, *tx = NULL;
+    uint8_t buf[MAX_SIZE + 1], ref[MAX_SIZE];
+    char url[256];
+    int nb_intact = 0, ret;
+
+    snprintf(url, sizeof(url), "udp://@:0?timeout=2000000&%s", rx_opts);
+    ret = ffurl_open_whitelist(&rx, url, AVIO_FLAG_READ, NULL, NULL,
+                               NULL, NULL, NULL);
+    if (ret < 0) {
+        printf("%s: could not open the receiver\n", name);
+        return ret;
+    }
+    snprintf(url, sizeof(url), tx_url, ff_udp_get_local_port(rx));
+    ret = ffurl_open_whitelist(&tx, url, AVIO_FLAG_WRITE, NULL, NULL,
+                               NULL, NULL, NULL);
+    if (ret < 0) {
+        printf("%s: could not open the sender\n", name);
+        goto end;
+    }
+
+    for (int i = 0; i < NB_DATAGRAMS && ret >= 0; i++) {
+        fill_datagram(buf, i, datagram_size(i));
+        ret = ffurl_write(tx, buf, datagram_size(i));
+    }
+    /* waits until the send queue is empty */
+    ffurl_closep(&tx);
+    if (ret < 0) {
+        printf("%s: sending failed\n", name);
+        goto end;
+    }
+
+    for (int i = 0; i < NB_DATAGRAMS; i++) {
+        ret = ffurl_read(rx, buf, sizeof(buf));
+        if (ret < 0) {
+            printf("%s: datagram %d not received\n", name, i);
+            break;
+        }
+        fill_datagram(ref, i, datagram_size(i));
+        if (ret != datagram_size(i) || memcmp(buf, ref, ret)) {
+            printf("%s: datagram %d has %d bytes instead of %d or differs\n",
+                   name, i, ret, datagram_size(i));
+            continue;
+        }
+        nb_intact++;
+    }
+    printf("%s: %d of %d datagrams intact\n", name, nb_intact, NB_DATAGRAMS);
+    ret = nb_intact == NB_DATAGRAMS ? 0 : AVERROR_INVALIDDATA;
+
+end:
+    ffurl_closep(&tx);
+    ffurl_closep(&rx);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+
+    avformat_network_init();
+
+    if (argc > 1 && !strcmp(argv[1], "rtp")) {
+        ret |= run("rtp",       "",
+                   "rtp://127.0.0.1:%d?batch_size=16&gso=1");
+        ret |= run("rtp paced", "batch_size=16",
+                   "rtp://127.0.0.1:%d?batch_size=16&bitrate=20000000");
+        goto end;
+    }
+
+    ret |= run("plain",   "",
+               "udp://127.0.0.1:%d");
+    ret |= run("mmsg",    "batch_size=16",
+               "udp://127.0.0.1:%d?batch_size=16");
+    ret |= run("gso",     "",
+               "udp://127.0.0.1:%d?batch_size=16&gso=1");
+    ret |= run("gso+gro", "batch_size=16&gro=1",
+               "udp://127.0.0.1:%d?batch_size=16&gso=1");
+
+end:
+    avformat_network_deinit();
+    return !!ret;
+}
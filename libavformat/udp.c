@@ -26,6 +26,9 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+#endif
 
 #include "avformat.h"
 #include "libavutil/avassert.h"
@@ -69,6 +72,10 @@
 #include "libavutil/thread.h"
 #endif
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -78,6 +85,10 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH 64
+/* largest payload of a UDP_SEGMENT send, limited by the IPv4 total length */
+#define UDP_GSO_MAX_SIZE (65535 - 20 - UDP_HEADER_SIZE)
+#define UDP_GSO_MAX_SEGMENTS 64
 
 typedef struct UDPQueuedPacketHeader {
     int pkt_size;
@@ -108,6 +119,11 @@ typedef struct UDPContext {
     int circular_buffer_error;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
+    int batch_size;
+    int gso;
+    int gro;
+    uint8_t *batch_buf;
+    int batch_buf_size;
     int close_req;
 #if HAVE_PTHREAD_CANCEL
     pthread_t circular_buffer_thread;
@@ -135,6 +151,9 @@ static const AVOption options[] = {
     { "buffer_size",    "System data size (in bytes)",                     OFFSET(buffer_size),    AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "bitrate",        "Bits to send per second",                         OFFSET(bitrate),        AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
     { "burst_bits",     "Max length of bursts in bits (when using bitrate)", OFFSET(burst_bits),   AV_OPT_TYPE_INT64,  { .i64 = 0  },     0, INT64_MAX, .flags = E },
+    { "batch_size",     "Max number of datagrams per system call of the circular buffer thread", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, UDP_MAX_BATCH, .flags = D|E },
+    { "gso",            "Use UDP segmentation offload for batched sending", OFFSET(gso),         AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       E },
+    { "gro",            "Use UDP receive offload in the circular buffer thread", OFFSET(gro),    AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       D },
     { "localport",      "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, D|E },
     { "local_port",     "Local port",                                      OFFSET(local_port),     AV_OPT_TYPE_INT,    { .i64 = -1 },    -1, INT_MAX, .flags = D|E },
     { "localaddr",      "Local address",                                   OFFSET(localaddr),      AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -526,6 +545,103 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/* Called with the mutex held. */
+static int circular_buffer_queue_rx(URLContext *h, UDPQueuedPacketHeader *pkt_header,
+                                    const uint8_t *data)
+{
+    UDPContext *s = h->priv_data;
+
+    if (ff_ip_check_source_lists(&pkt_header->addr, &s->filters))
+        return 0;
+
+    if (av_fifo_can_write(s->rx_fifo) < pkt_header->pkt_size + sizeof(*pkt_header)) {
+        /* No Space left */
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 0;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            return AVERROR(EIO);
+        }
+    }
+    av_fifo_write(s->rx_fifo, pkt_header, sizeof(*pkt_header));
+    av_fifo_write(s->rx_fifo, data, pkt_header->pkt_size);
+    pthread_cond_signal(&s->cond);
+    return 0;
+}
+
+#if HAVE_RECVMMSG
+/**
+ * Receive up to batch_size datagrams with a single system call and queue
+ * them, splitting buffers coalesced by UDP_GRO into the original datagrams.
+ * Called with the mutex held.
+ */
+static int circular_buffer_rx_batch(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    struct mmsghdr msgs[UDP_MAX_BATCH] = { 0 };
+    struct iovec iov[UDP_MAX_BATCH];
+    struct sockaddr_storage addrs[UDP_MAX_BATCH];
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control[UDP_MAX_BATCH];
+    int old_cancelstate, nb_msgs, ret;
+
+    for (int i = 0; i < s->batch_size; i++) {
+        iov[i].iov_base                = s->batch_buf + i * UDP_MAX_PKT_SIZE;
+        iov[i].iov_len                 = UDP_MAX_PKT_SIZE;
+        msgs[i].msg_hdr.msg_name       = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen    = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov        = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen     = 1;
+        msgs[i].msg_hdr.msg_control    = control[i].buf;
+        msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+    }
+
+    pthread_mutex_unlock(&s->mutex);
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+    nb_msgs = recvmmsg(s->udp_fd, msgs, s->batch_size, MSG_WAITFORONE, NULL);
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+    pthread_mutex_lock(&s->mutex);
+    if (nb_msgs < 0) {
+        ret = ff_neterrno();
+        return ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR) ? 0 : ret;
+    }
+
+    for (int i = 0; i < nb_msgs; i++) {
+        struct msghdr *msg = &msgs[i].msg_hdr;
+        const uint8_t *data = iov[i].iov_base;
+        int size = msgs[i].msg_len, seg_size = 0;
+        UDPQueuedPacketHeader pkt_header;
+
+#ifdef UDP_GRO
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+                memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(seg_size));
+        }
+#endif
+        if (seg_size <= 0)
+            seg_size = size;
+
+        pkt_header.addr     = addrs[i];
+        pkt_header.addr_len = msg->msg_namelen;
+        do {
+            pkt_header.pkt_size = FFMIN(size, seg_size);
+            ret = circular_buffer_queue_rx(h, &pkt_header, data);
+            if (ret < 0)
+                return ret;
+            data += pkt_header.pkt_size;
+            size -= pkt_header.pkt_size;
+        } while (size > 0);
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -543,6 +659,18 @@ static void *circular_buffer_task_rx( void *_URLContext)
     }
     while(1) {
         UDPQueuedPacketHeader pkt_header;
+        int ret;
+
+#if HAVE_RECVMMSG
+        if (s->batch_buf) {
+            ret = circular_buffer_rx_batch(h);
+            if (ret < 0) {
+                s->circular_buffer_error = ret;
+                goto end;
+            }
+            continue;
+        }
+#endif
         pkt_header.addr_len = sizeof(pkt_header.addr);
 
         pthread_mutex_unlock(&s->mutex);
@@ -550,7 +678,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancellation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        pkt_header.pkt_size = recvfrom(s->udp_fd, s->tmp + sizeof(pkt_header), sizeof(s->tmp) - sizeof(pkt_header), 0, (struct sockaddr *)&pkt_header.addr, &pkt_header.addr_len);
+        pkt_header.pkt_size = recvfrom(s->udp_fd, s->tmp, UDP_MAX_PKT_SIZE, 0, (struct sockaddr *)&pkt_header.addr, &pkt_header.addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
         if (pkt_header.pkt_size < 0) {
@@ -560,26 +688,11 @@ static void *circular_buffer_task_rx( void *_URLContext)
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&pkt_header.addr, &s->filters))
-            continue;
-        memcpy(s->tmp, &pkt_header, sizeof(pkt_header));
-
-        if (av_fifo_can_write(s->rx_fifo) < pkt_header.pkt_size + sizeof(pkt_header)) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
-            }
+        ret = circular_buffer_queue_rx(h, &pkt_header, s->tmp);
+        if (ret < 0) {
+            s->circular_buffer_error = ret;
+            goto end;
         }
-        av_fifo_write(s->rx_fifo, s->tmp, pkt_header.pkt_size + sizeof(pkt_header));
-        pthread_cond_signal(&s->cond);
     }
 
 end:
@@ -588,6 +701,109 @@ end:
     return NULL;
 }
 
+#if HAVE_SENDMMSG
+#ifdef UDP_SEGMENT
+/* Send size bytes as datagrams of seg_size bytes (the last one may be
+ * shorter) with a single UDP_SEGMENT send. */
+static int udp_send_gso(UDPContext *s, const uint8_t *buf, int size, int seg_size)
+{
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } control = { 0 };
+    struct iovec iov = { .iov_base = (void *)buf, .iov_len = size };
+    struct msghdr msg = {
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+        .msg_control    = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    uint16_t gso_size = seg_size;
+
+    if (!s->is_connected) {
+        msg.msg_name    = &s->dest_addr;
+        msg.msg_namelen = s->dest_addr_len;
+    }
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type  = UDP_SEGMENT;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(gso_size));
+    memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+    return sendmsg(s->udp_fd, &msg, 0) < 0 ? ff_neterrno() : 0;
+}
+#endif
+
+/* Send nb_pkts datagrams stored back to back in buf. */
+static int udp_send_batch(URLContext *h, const uint8_t *buf,
+                          const int *sizes, int nb_pkts)
+{
+    UDPContext *s = h->priv_data;
+    struct mmsghdr msgs[UDP_MAX_BATCH] = { 0 };
+    struct iovec iov[UDP_MAX_BATCH];
+    int i = 0, ret;
+
+    while (i < nb_pkts) {
+        int nb_msgs = nb_pkts - i;
+        const uint8_t *p = buf;
+
+#ifdef UDP_SEGMENT
+        if (s->gso) {
+            int n = 1, size = sizes[i];
+
+            /* only the last segment of a send may be shorter */
+            while (i + n < nb_pkts && n < UDP_GSO_MAX_SEGMENTS &&
+                   sizes[i + n] <= sizes[i] && size + sizes[i + n] <= UDP_GSO_MAX_SIZE) {
+                size += sizes[i + n];
+                if (sizes[i + n++] < sizes[i])
+                    break;
+            }
+            if (n > 1) {
+                ret = udp_send_gso(s, buf, size, sizes[i]);
+                if (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR))
+                    continue;
+                if (ret == AVERROR(EIO) || ret == AVERROR(EINVAL) ||
+                    ret == AVERROR(ENOPROTOOPT)) {
+                    av_log(h, AV_LOG_WARNING, "UDP segmentation offload failed, disabling it\n");
+                    s->gso = 0;
+                    continue;
+                }
+                if (ret < 0)
+                    return ret;
+                buf += size;
+                i   += n;
+                continue;
+            }
+            nb_msgs = 1;
+        }
+#endif
+
+        for (int j = 0; j < nb_msgs; j++) {
+            iov[j].iov_base = (void *)p;
+            iov[j].iov_len  = sizes[i + j];
+            p += sizes[i + j];
+            msgs[j].msg_hdr.msg_iov    = &iov[j];
+            msgs[j].msg_hdr.msg_iovlen = 1;
+            if (!s->is_connected) {
+                msgs[j].msg_hdr.msg_name    = &s->dest_addr;
+                msgs[j].msg_hdr.msg_namelen = s->dest_addr_len;
+            }
+        }
+        ret = sendmmsg(s->udp_fd, msgs, nb_msgs, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+            continue;
+        }
+        for (int j = 0; j < ret; j++)
+            buf += sizes[i + j];
+        i += ret;
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -611,6 +827,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
     for(;;) {
         int len;
         const uint8_t *p;
+        uint8_t *buf = s->batch_buf ? s->batch_buf : s->tmp;
         uint8_t tmp[4];
         int64_t timestamp;
 
@@ -629,8 +846,11 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len >= 0);
         av_assert0(len <= sizeof(s->tmp));
 
-        av_fifo_read(s->tx_fifo, s->tmp, len);
+        av_fifo_read(s->tx_fifo, buf, len);
 
+        /* udp_write() may be waiting for space in batch mode */
+        if (s->batch_buf)
+            pthread_cond_signal(&s->cond);
         pthread_mutex_unlock(&s->mutex);
 
         if (s->bitrate) {
@@ -653,7 +873,50 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
-        p = s->tmp;
+#if HAVE_SENDMMSG
+        if (s->batch_buf) {
+            int sizes[UDP_MAX_BATCH];
+            int size = sizes[0] = len, nb_pkts = 1, ret;
+
+            /* Add the following packets that are already due to the batch,
+             * pacing them exactly as if they were sent one by one. */
+            pthread_mutex_lock(&s->mutex);
+            while (nb_pkts < s->batch_size && av_fifo_can_read(s->tx_fifo) >= 4) {
+                av_fifo_peek(s->tx_fifo, tmp, 4, 0);
+                len = AV_RL32(tmp);
+                if (size + len > s->batch_buf_size)
+                    break;
+                if (s->bitrate) {
+                    timestamp = av_gettime_relative();
+                    if (timestamp < target_timestamp)
+                        break;
+                    if (timestamp - burst_interval > target_timestamp) {
+                        start_timestamp = timestamp - burst_interval;
+                        sent_bits = 0;
+                    }
+                    sent_bits += len * 8;
+                    target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
+                }
+                av_fifo_drain2(s->tx_fifo, 4);
+                av_fifo_read(s->tx_fifo, buf + size, len);
+                sizes[nb_pkts++] = len;
+                size += len;
+            }
+            pthread_cond_signal(&s->cond);
+            pthread_mutex_unlock(&s->mutex);
+
+            ret = udp_send_batch(h, buf, sizes, nb_pkts);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            len = 0;
+        }
+#endif
+
+        p = buf;
         while (len) {
             int ret;
             av_assert0(len > 0);
@@ -901,15 +1164,17 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and bitrate or batch_size and circular_buffer_size is set
     */
 
-    if (is_output && s->bitrate && !s->circular_buffer_size) {
+    if (is_output && (s->bitrate || s->batch_size > 1) && !s->circular_buffer_size) {
         /* Warn user in case of 'circular_buffer_size' is not set */
-        av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
+        av_log(h, AV_LOG_WARNING,"'%s' option was set but 'circular_buffer_size' is not, but required\n",
+               s->bitrate ? "bitrate" : "batch_size");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || (s->batch_size > 1 && HAVE_SENDMMSG)) && s->circular_buffer_size)) {
         /* start the task going */
         AVFifo *fifo = av_fifo_alloc2(s->circular_buffer_size, 1, 0);
         if (!fifo) {
@@ -920,6 +1185,37 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->tx_fifo = fifo;
         else
             s->rx_fifo = fifo;
+        if (!is_output && s->gro) {
+#if HAVE_RECVMMSG && defined(UDP_GRO)
+            tmp = 1;
+            if (setsockopt(udp_fd, IPPROTO_UDP, UDP_GRO, &tmp, sizeof(tmp)) < 0) {
+                ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(UDP_GRO)");
+                s->gro = 0;
+            }
+#else
+            av_log(h, AV_LOG_WARNING, "'gro' option is not supported on this build\n");
+            s->gro = 0;
+#endif
+        }
+        if (is_output && s->gso) {
+#if !HAVE_SENDMMSG || !defined(UDP_SEGMENT)
+            av_log(h, AV_LOG_WARNING, "'gso' option is not supported on this build\n");
+            s->gso = 0;
+#endif
+        }
+        if (s->batch_size > 1 || s->gro) {
+            if (is_output ? HAVE_SENDMMSG : HAVE_RECVMMSG) {
+                s->batch_buf_size = is_output ? FFMAX(s->batch_size * h->max_packet_size, (int)sizeof(s->tmp))
+                                              : s->batch_size * UDP_MAX_PKT_SIZE;
+                s->batch_buf = av_malloc(s->batch_buf_size);
+                if (!s->batch_buf) {
+                    ret = AVERROR(ENOMEM);
+                    goto fail;
+                }
+            } else {
+                av_log(h, AV_LOG_WARNING, "'batch_size' option is not supported on this build\n");
+            }
+        }
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -954,6 +1250,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         closesocket(udp_fd);
     av_fifo_freep2(&s->rx_fifo);
     av_fifo_freep2(&s->tx_fifo);
+    av_freep(&s->batch_buf);
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -1056,6 +1353,32 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return err;
         }
 
+        if (s->batch_buf && size + 4 <= s->circular_buffer_size) {
+            /* In batch mode the thread drains the fifo as fast as allowed,
+               so wait for space instead of dropping the packet. */
+            int nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+            while (av_fifo_can_write(s->tx_fifo) < size + 4) {
+                int64_t t;
+                struct timespec tv;
+                int err;
+
+                if (nonblock || s->circular_buffer_error < 0) {
+                    err = s->circular_buffer_error;
+                    pthread_mutex_unlock(&s->mutex);
+                    return err < 0 ? err : AVERROR(EAGAIN);
+                }
+                t  = av_gettime() + 100000;
+                tv = (struct timespec){ .tv_sec  =  t / 1000000,
+                                        .tv_nsec = (t % 1000000) * 1000 };
+                err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                if (err && err != ETIMEDOUT) {
+                    pthread_mutex_unlock(&s->mutex);
+                    return AVERROR(err);
+                }
+                nonblock = 1;
+            }
+        }
+
         if (av_fifo_can_write(s->tx_fifo) < size + 4) {
             /* What about a partial packet tx ? */
             pthread_mutex_unlock(&s->mutex);
@@ -1127,6 +1450,7 @@ static int udp_close(URLContext *h)
     closesocket(s->udp_fd);
     av_fifo_freep2(&s->rx_fifo);
     av_fifo_freep2(&s->tx_fifo);
+    av_freep(&s->batch_buf);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
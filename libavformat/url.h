@@ -26,6 +26,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -83,6 +84,16 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    /**
+     * Map size bytes of the resource starting at pos into memory.
+     * *buf is set to a new reference to a buffer containing the data, which
+     * starts at *data and is followed by padding zero bytes.
+     * Does not change the read position.
+     * @return 0 on success, AVERROR(ENOSYS) if the range cannot be mapped,
+     *         or another negative AVERROR code
+     */
+    int (*url_map)(URLContext *h, int64_t pos, int size, int padding,
+                   AVBufferRef **buf, uint8_t **data);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
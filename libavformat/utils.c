@@ -23,6 +23,7 @@
 #include <time.h>
 
 #include "config.h"
+#include "config_components.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -39,6 +40,8 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "demux.h"
+#include "http.h"
 #include "internal.h"
 #if CONFIG_NETWORK
 #include "network.h"
@@ -58,6 +61,7 @@
  * Return the number of bytes read or an error. */
 static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
 {
+    FFPacketPool *pool = ffiocontext(s)->packet_pool;
     int orig_size      = pkt->size;
     int ret;
 
@@ -75,7 +79,10 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
                 read_size = FFMIN(read_size, SANE_CHUNK_SIZE);
         }
 
-        ret = av_grow_packet(pkt, read_size);
+        if (pool && !pkt->buf && !pkt->size)
+            ret = ff_packet_pool_get(pool, pkt, read_size);
+        else
+            ret = av_grow_packet(pkt, read_size);
         if (ret < 0)
             break;
 
@@ -97,6 +104,8 @@ static int append_packet_chunked(AVIOContext *s, AVPacket *pkt, int size)
 
 int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
 {
+    int ret;
+
 #if FF_API_INIT_PACKET
 FF_DISABLE_DEPRECATION_WARNINGS
     av_init_packet(pkt);
@@ -108,6 +117,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     pkt->pos  = avio_tell(s);
 
+    ret = ffio_read_mapped(s, &pkt->buf, &pkt->data, size);
+    if (ret != AVERROR(ENOSYS)) {
+        if (ret > 0)
+            pkt->size = ret;
+        return ret;
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -566,6 +582,9 @@ int avformat_network_init(void)
         return ret;
     if ((ret = ff_tls_init()) < 0)
         return ret;
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_init();
+#endif
 #endif
     return 0;
 }
@@ -573,6 +592,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_uninit();
+#endif
     ff_network_close();
     ff_tls_deinit();
 #endif
@@ -0,0 +1,250 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Lowres decoding test: the key frames decoded with lowres 1, 2 and 3 must
+ * match the key frames decoded at full resolution without loop filter and
+ * box-filtered down, including their scaled cropping.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+static int decode_all(const char *filename, int lowres,
+                      AVFrame ***frames, int *nb_frames)
+{
+    AVFormatContext *fmt_ctx = NULL;
+    AVCodecContext *ctx = NULL;
+    const AVCodec *codec;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL;
+    int stream, ret;
+
+    ret = avformat_open_input(&fmt_ctx, filename, NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return ret;
+    }
+    ret = avformat_find_stream_info(fmt_ctx, NULL);
+    if (ret < 0)
+        goto end;
+    ret = stream = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (ret < 0)
+        goto end;
+
+    ctx   = avcodec_alloc_context3(codec);
+    pkt   = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!ctx || !pkt || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_to_context(ctx, fmt_ctx->streams[stream]->codecpar);
+    if (ret < 0)
+        goto end;
+    ctx->skip_frame     = AVDISCARD_NONKEY;
+    ctx->apply_cropping = 0;
+    if (lowres)
+        ctx->lowres = lowres;
+    else
+        ctx->skip_loop_filter = AVDISCARD_ALL;
+    ret = avcodec_open2(ctx, codec, NULL);
+    if (ret < 0)
+        goto end;
+
+    for (;;) {
+        ret = av_read_frame(fmt_ctx, pkt);
+        if (ret < 0 && ret != AVERROR_EOF)
+            goto end;
+        if (ret >= 0 && pkt->stream_index != stream) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        ret = avcodec_send_packet(ctx, ret >= 0 ? pkt : NULL);
+        av_packet_unref(pkt);
+        if (ret < 0)
+            goto end;
+
+        while ((ret = avcodec_receive_frame(ctx, frame)) >= 0) {
+            ret = av_dynarray_add_nofree(frames, nb_frames, frame);
+            if (ret < 0)
+                goto end;
+            frame = av_frame_alloc();
+            if (!frame) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+        }
+        if (ret == AVERROR_EOF) {
+            ret = 0;
+            break;
+        }
+        if (ret != AVERROR(EAGAIN))
+            goto end;
+    }
+
+end:
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&ctx);
+    avformat_close_input(&fmt_ctx);
+    return ret;
+}
+
+/**
+ * Compare the rows of lowres plane dst of the given parity (or all of them
+ * if step is 1) with the average of the corresponding pixels of src.
+ */
+static int compare_plane(const AVFrame *dst, const AVFrame *src, int p,
+                         int w, int h, int lowres, int step, int parity)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+    const int high_bd = desc->comp[0].depth > 8;
+    const int n  = 1 << lowres;
+    const int sh = p ? AV_CEIL_RSHIFT(h, desc->log2_chroma_h) : h;
+    const int sw = p ? AV_CEIL_RSHIFT(w, desc->log2_chroma_w) : w;
+    const int dh = AV_CEIL_RSHIFT(sh, lowres);
+    const int dw = AV_CEIL_RSHIFT(sw, lowres);
+
+    for (int y = parity; y < dh; y += step) {
+        /* first source row of the output row, in the field if step is 2 */
+        const int y0 = step == 1 ? y * n : 2 * ((y >> 1) * n) + parity;
+
+        for (int x = 0; x < dw; x++) {
+            unsigned sum = 0, count = 0, val;
+
+            for (int j = 0; j < n && y0 + step * j < sh; j++) {
+                const uint8_t *row = src->data[p] + (y0 + step * j) * src->linesize[p];
+
+                for (int i = 0; i < n && x * n + i < sw; i++) {
+                    sum += high_bd ? AV_RN16(row + 2 * (x * n + i)) : row[x * n + i];
+                    count++;
+                }
+            }
+            sum = (sum + count / 2) / count;
+            val = high_bd ? AV_RN16(dst->data[p] + y * dst->linesize[p] + 2 * x) :
+                            dst->data[p][y * dst->linesize[p] + x];
+            if (val != sum)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_frame(const AVFrame *dst, const AVFrame *src, int lowres,
+                         int step, int parity)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+
+    for (int p = 0; p < desc->nb_components; p++)
+        if (compare_plane(dst, src, p, src->width, src->height, lowres, step, parity) < 0)
+            return -1;
+    return 0;
+}
+
+static int check_lowres(const char *filename, int lowres, int fields,
+                        AVFrame **ref, int nb_ref)
+{
+    AVFrame **frames = NULL;
+    int nb_frames = 0, ret;
+
+    ret = decode_all(filename, lowres, &frames, &nb_frames);
+    if (ret < 0) {
+        fprintf(stderr, "lowres %d: decoding failed\n", lowres);
+        goto end;
+    }
+    ret = -1;
+    if (nb_frames != nb_ref) {
+        fprintf(stderr, "lowres %d: %d frames instead of %d\n", lowres, nb_frames, nb_ref);
+        goto end;
+    }
+
+    for (int i = 0; i < nb_frames; i++) {
+        const AVFrame *dst = frames[i], *src = ref[i];
+        const int crop_w = src->width  - src->crop_left - src->crop_right;
+        const int crop_h = src->height - src->crop_top  - src->crop_bottom;
+
+        if (dst->format != src->format ||
+            dst->width  != AV_CEIL_RSHIFT(src->width,  lowres) ||
+            dst->height != AV_CEIL_RSHIFT(src->height, lowres)) {
+            fprintf(stderr, "lowres %d, frame %d: %s %dx%d instead of %s %dx%d\n",
+                    lowres, i, av_get_pix_fmt_name(dst->format), dst->width, dst->height,
+                    av_get_pix_fmt_name(src->format), AV_CEIL_RSHIFT(src->width, lowres),
+                    AV_CEIL_RSHIFT(src->height, lowres));
+            goto end;
+        }
+        if (dst->crop_left != src->crop_left >> lowres ||
+            dst->crop_top  != src->crop_top  >> lowres ||
+            dst->width  - dst->crop_left - dst->crop_right  != AV_CEIL_RSHIFT(crop_w, lowres) ||
+            dst->height - dst->crop_top  - dst->crop_bottom != AV_CEIL_RSHIFT(crop_h, lowres)) {
+            fprintf(stderr, "lowres %d, frame %d: wrong cropping\n", lowres, i);
+            goto end;
+        }
+
+        /* The fields of field pictures are downscaled separately, and a
+         * second field which is not intra is not decoded in lowres mode,
+         * so only the rows of the first field can be compared. */
+        if (compare_frame(dst, src, lowres, 1, 0) < 0 &&
+            (!fields || !(src->flags & AV_FRAME_FLAG_INTERLACED) ||
+             compare_frame(dst, src, lowres, 2,
+                           !(src->flags & AV_FRAME_FLAG_TOP_FIELD_FIRST)) < 0)) {
+            fprintf(stderr, "lowres %d, frame %d: mismatch\n", lowres, i);
+            goto end;
+        }
+    }
+    ret = 0;
+
+end:
+    for (int i = 0; i < nb_frames; i++)
+        av_frame_free(&frames[i]);
+    av_free(frames);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVFrame **ref = NULL;
+    int nb_ref = 0, fields, ret;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input file> <allow field-wise downscaling>\n", argv[0]);
+        return 1;
+    }
+    fields = atoi(argv[2]);
+
+    ret = decode_all(argv[1], 0, &ref, &nb_ref);
+    if (ret < 0 || !nb_ref) {
+        fprintf(stderr, "Full resolution decoding failed\n");
+        ret = -1;
+    }
+    for (int lowres = 1; lowres <= 3 && ret >= 0; lowres++)
+        ret = check_lowres(argv[1], lowres, fields, ref, nb_ref);
+
+    for (int i = 0; i < nb_ref; i++)
+        av_frame_free(&ref[i]);
+    av_free(ref);
+    return ret < 0;
+}
@@ -450,6 +450,97 @@ lavf_image2pipe(){
     do_avconv_crc $file -auto_conversion_filters $DEC_OPTS -f image2pipe -i $target_path/$file
 }
 
+hls_io_queue(){
+    # the same output written inline and from the I/O thread, the playlist
+    # and segments must be identical
+    for mode in sync async; do
+        outdir="tests/data/hls-io-queue-$mode"
+        mkdir -p "$outdir"
+        opts=
+        test $mode = async && opts="-io_queue_size 2"
+        ffmpeg -auto_conversion_filters -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" \
+               -f hls -hls_time 3 -hls_list_size 0 -codec:a mp2fixed -flags +bitexact $opts \
+               -hls_segment_filename $target_path/$outdir/out%d.ts -y $target_path/$outdir/out.m3u8 || return
+    done
+    for file in $(ls tests/data/hls-io-queue-sync); do
+        test "$keep" -ge 1 || cleanfiles="$cleanfiles tests/data/hls-io-queue-sync/$file tests/data/hls-io-queue-async/$file"
+        echo $file $(do_md5sum tests/data/hls-io-queue-sync/$file | awk '{print $1}') \
+                   $(do_md5sum tests/data/hls-io-queue-async/$file | awk '{print $1}')
+    done
+}
+
+file_io(){
+    # a file written and read back with the given file protocol options
+    # must be identical to one written and read with the defaults; the
+    # container is nut unless its extension is given as first argument
+    ext=nut
+    case "$1" in -*) ;; *) ext=$1; shift ;; esac
+    outdir="tests/data/$test"
+    mkdir -p "$outdir"
+    for mode in default options; do
+        opts=
+        test $mode = options && opts="$*"
+        ffmpeg -f lavfi -i testsrc2=s=320x240:r=10:d=1 -pix_fmt yuv420p -c:v rawvideo -flags +bitexact -fflags +bitexact \
+               $opts -y $target_path/$outdir/$mode.$ext || return
+        ffmpeg $opts -i $target_path/$outdir/default.$ext -c copy -f framecrc -y $target_path/$outdir/$mode.framecrc || return
+        test "$keep" -ge 1 || cleanfiles="$cleanfiles $outdir/$mode.$ext $outdir/$mode.framecrc"
+        echo $mode $(do_md5sum $outdir/$mode.$ext | awk '{print $1}') \
+                   $(do_md5sum $outdir/$mode.framecrc | awk '{print $1}')
+    done
+}
+
+hls_prefetch(){
+    # the segments downloaded by the prefetch workers must demux the same as
+    # those opened inline, with one file per segment and with byte ranges
+    outdir="tests/data/hls-prefetch"
+    mkdir -p "$outdir"
+    ffmpeg -auto_conversion_filters -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" \
+           -f hls -hls_time 2 -hls_list_size 0 -codec:a mp2fixed -flags +bitexact \
+           -hls_segment_filename $target_path/$outdir/out%d.ts -y $target_path/$outdir/out.m3u8 || return
+    ffmpeg -auto_conversion_filters -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" \
+           -f hls -hls_time 2 -hls_list_size 0 -hls_flags single_file -codec:a mp2fixed -flags +bitexact \
+           -hls_segment_filename $target_path/$outdir/single.ts -y $target_path/$outdir/single.m3u8 || return
+    for file in $(ls $outdir); do
+        test "$keep" -ge 1 || cleanfiles="$cleanfiles $outdir/$file"
+    done
+    for playlist in out single; do
+        for n in 0 1 3; do
+            output="$outdir/$playlist-$n.framecrc"
+            ffmpeg -prefetch_segments $n -prefetch_buffer_size 65536 -i $target_path/$outdir/$playlist.m3u8 \
+                   -c copy -f framecrc -y $target_path/$output || return
+            test "$keep" -ge 1 || cleanfiles="$cleanfiles $output"
+            echo $playlist.m3u8 prefetch_segments=$n $(do_md5sum $output | awk '{print $1}')
+        done
+    done
+}
+
+image2_writer(){
+    nb_frames=13
+    outdir="tests/data/images/${test#image2-}"
+    file=${outdir}/$1
+    shift
+    mkdir -p "$outdir"
+    if [ "$keep" -lt 1 ]; then
+        for i in `seq $nb_frames`; do
+            cleanfiles="$cleanfiles $(printf "$file" $i)"
+        done
+    fi
+    run_avconv $DEC_OPTS -f image2 -c:v pgmyuv -i $raw_src -c:v pgmyuv -frames $nb_frames $* \
+               -y $target_path/$file || return
+    framecrc -f image2 -c:v pgmyuv -i $target_path/$file
+}
+
+image2_negative(){
+    outdir="tests/data/images/${test#image2-}"
+    mkdir -p "$outdir"
+    for i in `seq 13`; do
+        file=${outdir}/$((i - 7)).pgm
+        cp $(printf "tests/vsynth1/%02d.pgm" $i) $file || return
+        test "$keep" -ge 1 || cleanfiles="$cleanfiles $file"
+    done
+    framecrc -f image2 -start_number -6 -c:v pgmyuv "$@" -i $target_path/$outdir/%d.pgm
+}
+
 lavf_video(){
     t="${test#lavf-}"
     outdir="tests/data/lavf"
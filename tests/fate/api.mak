@@ -16,6 +16,21 @@ FATE_API_SAMPLES_LIBAVFORMAT-$(call DEMDEC, H264, H264) += fate-api-h264-slice
 fate-api-h264-slice: $(APITESTSDIR)/api-h264-slice-test$(EXESUF)
 fate-api-h264-slice: CMD = run $(APITESTSDIR)/api-h264-slice-test$(EXESUF) 2 $(TARGET_SAMPLES)/h264/crew_cif.nal
 
+# UNVERIFIED: these tests were written without access to the FATE samples
+# and have never been run, they may need adjusting before being relied on.
+FATE_API_LOWRES-$(call DEMDEC, H264, H264) += fate-api-lowres-h264-intra fate-api-lowres-h264-mbaff \
+                                              fate-api-lowres-h264-paff fate-api-lowres-h264-crop
+FATE_API_LOWRES-$(call DEMDEC, HEVC, HEVC) += fate-api-lowres-hevc fate-api-lowres-hevc-crop
+FATE_API_SAMPLES_LIBAVFORMAT-$(call ALLYES, H264_DECODER HEVC_DECODER) += $(FATE_API_LOWRES-yes)
+$(FATE_API_LOWRES-yes): $(APITESTSDIR)/api-lowres-test$(EXESUF)
+$(FATE_API_LOWRES-yes): CMP = null
+fate-api-lowres-h264-intra: CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/h264-conformance/CI_MW_D.264 0
+fate-api-lowres-h264-mbaff: CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/h264-conformance/CAMA1_Sony_C.jsv 0
+fate-api-lowres-h264-paff:  CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/h264-conformance/CVPA1_TOSHIBA_B.264 1
+fate-api-lowres-h264-crop:  CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/h264-conformance/CVFC1_Sony_C.jsv 0
+fate-api-lowres-hevc:       CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/hevc-conformance/AMP_A_Samsung_6.bit 0
+fate-api-lowres-hevc-crop:  CMD = run $(APITESTSDIR)/api-lowres-test$(EXESUF) $(TARGET_SAMPLES)/hevc-conformance/CONFWIN_A_Sony_1.bit 0
+
 FATE_API_LIBAVFORMAT-yes += $(if $(findstring fate-lavf-flv,$(FATE_LAVF_CONTAINER)),fate-api-seek)
 fate-api-seek: $(APITESTSDIR)/api-seek-test$(EXESUF) fate-lavf-flv
 fate-lavf-flv: KEEP_FILES ?= 1
@@ -285,3 +285,15 @@ FATE_SAMPLES_FFMPEG-$(call FRAMECRC, MOV, HEVC, HEVC_PARSER) += fate-ffmpeg-heif
 # binding the internal filtegraph with a caller defined filtergraph
 fate-ffmpeg-heif-merge-filtergraph: CMD = framecrc -i $(TARGET_SAMPLES)/heif-conformance/C007.heic -filter_complex "sws_flags=+accurate_rnd+bitexact\;[0:g:0]scale=w=1280:h=720[out]" -map "[out]"
 FATE_SAMPLES_FFMPEG-$(call FRAMECRC, MOV, HEVC, HEVC_PARSER SCALE_FILTER) += fate-ffmpeg-heif-merge-filtergraph
+
+# file protocol options which must not change what is written or read
+FATE_FILE_IO-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER RAWVIDEO_ENCODER NUT_MUXER NUT_DEMUXER FRAMECRC_MUXER FILE_PROTOCOL) += fate-file-io-uring fate-file-io-uring-direct
+fate-file-io-uring: CMD = file_io -io_uring 1 -io_depth 3
+fate-file-io-uring-direct: CMD = file_io -io_uring 1 -direct 1
+fate-file-io-uring-direct: REF = $(SRC_PATH)/tests/ref/fate/file-io-uring
+FATE_FILE_IO-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER RAWVIDEO_ENCODER AVI_MUXER AVI_DEMUXER FRAMECRC_MUXER FILE_PROTOCOL) += fate-file-io-mmap
+fate-file-io-mmap: CMD = file_io avi -mmap 1
+FATE_FILE_IO-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER RAWVIDEO_ENCODER MATROSKA_MUXER MATROSKA_DEMUXER FRAMECRC_MUXER FILE_PROTOCOL) += fate-file-io-mmap-mkv
+fate-file-io-mmap-mkv: CMD = file_io mkv -mmap 1
+FATE_FFMPEG += $(FATE_FILE_IO-yes)
+fate-file-io: $(FATE_FILE_IO-yes)
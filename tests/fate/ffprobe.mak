@@ -15,6 +15,12 @@ $(FFPROBE_OUTPUT_MODES_TESTS): $(FFPROBE_TEST_FILE)
 $(FFPROBE_OUTPUT_MODES_TESTS): CMD = run $(FFPROBE_COMMAND) -of $(@:fate-ffprobe_%=%)
 FFPROBE_TEST_FILE_TESTS-yes += $(FFPROBE_OUTPUT_MODES_TESTS)
 
+FFPROBE_TEST_FILE_TESTS-yes += fate-ffprobe_batch
+fate-ffprobe_batch: $(FFPROBE_TEST_FILE)
+fate-ffprobe_batch: CMD = printf "%s\n\n%s\n" $(TARGET_PATH)/$(FFPROBE_TEST_FILE) $(TARGET_PATH)/$(FFPROBE_TEST_FILE) | \
+	run ffprobe$(PROGSSUF)$(EXESUF) -bitexact -of compact -count_packets -batch_threads 2 -inputs_from - \
+	-show_entries stream=index,codec_name,codec_type,nb_read_packets:format=format_name,nb_streams
+
 FFPROBE_TEST_FILE_TESTS-$(HAVE_XMLLINT) += fate-ffprobe_xsd
 fate-ffprobe_xsd: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xsd: CMD = run $(FFPROBE_COMMAND) -noprivate -of xml=q=1:x=1 | \
@@ -211,6 +211,11 @@ FATE_H264-$(call FRAMEMD5, MOV, H264, SCALE_FILTER) += fate-h264-extradata-reloa
 
 FATE_H264-$(call FRAMECRC, MOV, H264) += fate-h264-interlace-crop
 
+# slice threads inside frame threads must match the single-threaded output
+FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER) += fate-h264-frame-slice-threads
+fate-h264-frame-slice-threads: CMD = threads=2 framecrc -frame_slice_threads 2 -i $(TARGET_SAMPLES)/h264-conformance/CAPAMA3_Sand_F.264
+fate-h264-frame-slice-threads: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-capama3_sand_f
+
 # this sample has invalid reference list modification, but decodes fine
 # by using a previous ref frame instead of a missing one
 FATE_H264-$(call FRAMECRC, MOV, H264, SCALE_FILTER) += fate-h264-invalid-ref-mod
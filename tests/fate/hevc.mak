@@ -221,6 +221,16 @@ FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER) +=         \
 
 FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER SETPTS_FILTER) += $(HEVC_TESTS_MULTIVIEW)
 
+# WPP slice threads inside frame threads must match the single-threaded output
+fate-hevc-frame-slice-threads: CMD = threads=2 framecrc -frame_slice_threads 2 -flags output_corrupt -i $(TARGET_SAMPLES)/hevc-conformance/WPP_A_ericsson_MAIN_2.bit -pix_fmt yuv420p
+fate-hevc-frame-slice-threads: REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-WPP_A_ericsson_MAIN_2
+FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER) += fate-hevc-frame-slice-threads
+
+# pipelined deblocking and SAO must match the in-place filtering
+fate-hevc-filter-pipeline: CMD = threads=2 framecrc -filter_pipeline 1 -flags output_corrupt -i $(TARGET_SAMPLES)/hevc-conformance/SAO_A_MediaTek_4.bit -pix_fmt yuv420p
+fate-hevc-filter-pipeline: REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-SAO_A_MediaTek_4
+FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER) += fate-hevc-filter-pipeline
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -fps_mode passthrough -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER LARGE_TESTS) += fate-hevc-paramchange-yuv420p-yuv420p10
 
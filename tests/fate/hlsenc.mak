@@ -126,6 +126,13 @@ FATE_HLSENC_PROBE-$(call FRAMECRC, HLS) += fate-hls-cmfa
 fate-hls-cmfa: tests/data/hls_cmfa.m3u8
 fate-hls-cmfa: CMD = framecrc -i $(TARGET_PATH)/tests/data/hls_cmfa.m3u8 -c copy
 
+FATE_HLSENC_IO-$(call ENCMUX, MP2FIXED, HLS MPEGTS, AEVALSRC_FILTER ARESAMPLE_FILTER LAVFI_INDEV FILE_PROTOCOL) += fate-hls-io-queue
+fate-hls-io-queue: CMD = hls_io_queue
+
+FATE_HLSENC_IO-$(call ENCMUX, MP2FIXED, HLS MPEGTS, AEVALSRC_FILTER ARESAMPLE_FILTER LAVFI_INDEV FILE_PROTOCOL HLS_DEMUXER MPEGTS_DEMUXER FRAMECRC_MUXER) += fate-hls-prefetch
+fate-hls-prefetch: CMD = hls_prefetch
+
+FATE_FFMPEG += $(FATE_HLSENC_IO-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_HLSENC-yes)
 FATE_SAMPLES_FFMPEG_FFPROBE += $(FATE_HLSENC_PROBE-yes)
-fate-hlsenc: $(FATE_HLSENC-yes) $(FATE_HLSENC_PROBE-yes)
+fate-hlsenc: $(FATE_HLSENC-yes) $(FATE_HLSENC_PROBE-yes) $(FATE_HLSENC_IO-yes)
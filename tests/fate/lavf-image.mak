@@ -100,3 +100,34 @@ fate-lavf-monow.xwd: CMD = lavf_image "-pix_fmt monow"
 
 FATE_AVCONV += $(FATE_LAVF_IMAGES)
 fate-lavf-images fate-lavf: $(FATE_LAVF_IMAGES)
+
+# same as fate-v410enc, with the images read ahead by worker threads
+FATE_IMAGE2-$(call ENCDEC, V410 PGMYUV, AVI IMAGE2, SCALE_FILTER) += fate-image2-prefetch
+fate-image2-prefetch: $(VREF)
+fate-image2-prefetch: CMD = md5 -f image2 -prefetch 4 -c:v pgmyuv -i $(TARGET_PATH)/tests/vsynth1/%02d.pgm -fflags +bitexact -c:v v410 -f avi -vf scale
+fate-image2-prefetch: REF = $(SRC_PATH)/tests/ref/fate/v410enc
+
+# sequences with negative image numbers, read with and without prefetching
+FATE_IMAGE2_NEGATIVE = fate-image2-negative fate-image2-negative-prefetch
+FATE_IMAGE2-$(call ALLYES, FILE_PROTOCOL IMAGE2_DEMUXER PGMYUV_DECODER \
+                           FRAMECRC_MUXER) += $(FATE_IMAGE2_NEGATIVE)
+$(FATE_IMAGE2_NEGATIVE): $(VREF)
+fate-image2-negative:          CMD = image2_negative
+fate-image2-negative-prefetch: CMD = image2_negative -prefetch 4
+fate-image2-negative-prefetch: REF = $(SRC_PATH)/tests/ref/fate/image2-negative
+
+# files written from the muxing thread and from writer threads must match
+FATE_IMAGE2_WRITER = fate-image2-writer fate-image2-writer-threads \
+                     fate-image2-writer-update fate-image2-writer-update-threads
+FATE_IMAGE2-$(call ALLYES, FILE_PROTOCOL PIPE_PROTOCOL IMAGE2_DEMUXER IMAGE2_MUXER \
+                           PGMYUV_DECODER PGMYUV_ENCODER FRAMECRC_MUXER) += $(FATE_IMAGE2_WRITER)
+$(FATE_IMAGE2_WRITER): $(VREF)
+fate-image2-writer:                CMD = image2_writer %02d.pgm
+fate-image2-writer-threads:        CMD = image2_writer %02d.pgm -writer_threads 4
+fate-image2-writer-threads:        REF = $(SRC_PATH)/tests/ref/fate/image2-writer
+fate-image2-writer-update:         CMD = image2_writer last.pgm -update 1
+fate-image2-writer-update-threads: CMD = image2_writer last.pgm -update 1 -writer_threads 4
+fate-image2-writer-update-threads: REF = $(SRC_PATH)/tests/ref/fate/image2-writer-update
+
+FATE_AVCONV += $(FATE_IMAGE2-yes)
+fate-image2: $(FATE_IMAGE2-yes)
@@ -2,6 +2,19 @@
 #fate-async: libavformat/tests/async$(EXESUF)
 #fate-async: CMD = run libavformat/tests/async
 
+FATE_LIBAVFORMAT-$(call ALLYES, CACHE_PROTOCOL FILE_PROTOCOL) += fate-cache
+fate-cache: libavformat/tests/cache$(EXESUF)
+fate-cache: CMD = run libavformat/tests/cache$(EXESUF) $(TARGET_PATH)/tests/data/fate/cache
+
+FATE_HTTP_POOL-$(CONFIG_HTTP_PROTOCOL) += fate-http-pool
+FATE_LIBAVFORMAT-$(HAVE_THREADS) += $(FATE_HTTP_POOL-yes)
+fate-http-pool: libavformat/tests/http_pool$(EXESUF)
+fate-http-pool: CMD = run libavformat/tests/http_pool$(EXESUF)
+
+FATE_LIBAVFORMAT-$(call ALLYES, MPEGTS_MUXER MPEGTS_DEMUXER) += fate-mpegts-discard
+fate-mpegts-discard: libavformat/tests/mpegts_discard$(EXESUF)
+fate-mpegts-discard: CMD = run libavformat/tests/mpegts_discard$(EXESUF)
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy$(EXESUF)
@@ -14,6 +27,14 @@ FATE_LIBAVFORMAT-$(CONFIG_SRTP) += fate-srtp
 fate-srtp: libavformat/tests/srtp$(EXESUF)
 fate-srtp: CMD = run libavformat/tests/srtp$(EXESUF)
 
+FATE_UDP_BATCH-$(CONFIG_UDP_PROTOCOL) += fate-udp-batch
+FATE_UDP_BATCH-$(CONFIG_RTP_PROTOCOL) += fate-rtp-batch
+FATE_LIBAVFORMAT-$(HAVE_THREADS) += $(FATE_UDP_BATCH-yes)
+fate-udp-batch: libavformat/tests/udp_batch$(EXESUF)
+fate-udp-batch: CMD = run libavformat/tests/udp_batch$(EXESUF)
+fate-rtp-batch: libavformat/tests/udp_batch$(EXESUF)
+fate-rtp-batch: CMD = run libavformat/tests/udp_batch$(EXESUF) rtp
+
 FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
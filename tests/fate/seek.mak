@@ -206,6 +206,40 @@ $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 $(subst fate-seek-,fate-,$(FATE_SAMPLES_SEEK) $(FATE_SEEK)): KEEP_FILES ?= 1
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+# loading the Cues lazily must give the same results
+FATE_SEEK_LAZY_CUES := $(if $(filter fate-seek-lavf-mkv, $(FATE_SEEK)), fate-seek-lavf-mkv-lazy-cues)
+fate-seek-lavf-mkv-lazy-cues: fate-lavf-mkv libavformat/tests/seek$(EXESUF)
+fate-seek-lavf-mkv-lazy-cues: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mkv -lazy_cues 1
+fate-seek-lavf-mkv-lazy-cues: REF = $(SRC_PATH)/tests/ref/seek/lavf-mkv
+
+# on a long file, whose Cues span several windows of the bisection
+tests/data/long_cues.mkv: TAG = GEN
+tests/data/long_cues.mkv: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+	-f lavfi -i testsrc=s=8x8:r=25:d=800 -pix_fmt gray -c:v rawvideo -flags +bitexact -fflags +bitexact \
+	-y $(TARGET_PATH)/tests/data/long_cues.mkv 2>/dev/null
+
+FATE_SEEK_LONG_CUES-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER FORMAT_FILTER RAWVIDEO_ENCODER \
+                                   MATROSKA_MUXER MATROSKA_DEMUXER) += fate-seek-mkv-long-cues fate-seek-mkv-long-cues-lazy
+$(FATE_SEEK_LONG_CUES-yes): tests/data/long_cues.mkv libavformat/tests/seek$(EXESUF)
+fate-seek-mkv-long-cues: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/long_cues.mkv -duration 800
+fate-seek-mkv-long-cues-lazy: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/long_cues.mkv -duration 800 -lazy_cues 1
+fate-seek-mkv-long-cues-lazy: REF = $(SRC_PATH)/tests/ref/seek/mkv-long-cues
+
+# so must reading the MXF partitions lazily
+FATE_SEEK_MXF_FAST_OPEN := $(if $(filter fate-seek-lavf-mxf, $(FATE_SEEK)), fate-seek-lavf-mxf-fast-open)
+fate-seek-lavf-mxf-fast-open: fate-lavf-mxf libavformat/tests/seek$(EXESUF)
+fate-seek-lavf-mxf-fast-open: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mxf -fast_open 1
+fate-seek-lavf-mxf-fast-open: REF = $(SRC_PATH)/tests/ref/seek/lavf-mxf
+
+# and allocating the packet payloads from pools, both for the packets read
+# directly and for those output by the parsers
+FATE_SEEK_PKTPOOL := $(addsuffix -pktpool, $(filter $(addprefix fate-seek-lavf-, avi flv mkv mov mpg nut ts wav), $(FATE_SEEK)))
+$(FATE_SEEK_PKTPOOL): fate-seek-%-pktpool: fate-% libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK_PKTPOOL): SRC = lavf/lavf.$(@:fate-seek-lavf-%-pktpool=%)
+$(FATE_SEEK_PKTPOOL): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC) -fflags +pktpool
+$(FATE_SEEK_PKTPOOL): REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%-pktpool=%)
+
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_LAZY_CUES) $(FATE_SEEK_LONG_CUES-yes) $(FATE_SEEK_MXF_FAST_OPEN) $(FATE_SEEK_PKTPOOL)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SEEK_LAZY_CUES) $(FATE_SEEK_LONG_CUES-yes) $(FATE_SEEK_MXF_FAST_OPEN) $(FATE_SEEK_PKTPOOL) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
@@ -0,0 +1,203 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Muxer throughput benchmark: mux synthetic packets into a discarded output
+ * and report the time spent per packet and the output rate.
+ *
+ * Each stream gets its packets in bursts of one second, so the interleaver
+ * has to reorder them, and sparse streams only get one packet every 4 s.
+ * Examples:
+ *   mux_bench -n 256 -s 64 -p 16          many sparse streams (interleaving)
+ *   mux_bench -f mpegts -p 500000         one 100 Mb/s stream (packetization)
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define FPS 25
+
+static int64_t output_size;
+
+static int discard_packet(void *opaque, const uint8_t *buf, int buf_size)
+{
+    output_size += buf_size;
+    return buf_size;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-f format] [-o muxer options] [-n streams] [-s sparse streams]\n"
+           "          [-p packet size] [-t seconds] [-r runs]\n"
+           "Defaults: -f framecrc -n 4 -s 0 -p 16 -t 200 -r 3\n", name);
+}
+
+static int run(const char *format, const char *options, int nb_streams,
+               int nb_sparse, int packet_size, int duration, int64_t *time)
+{
+    AVFormatContext *s = NULL;
+    AVDictionary *opts = NULL;
+    AVBufferRef *data = NULL;
+    AVPacket *pkt = NULL;
+    uint8_t *buf = NULL;
+    int64_t start;
+    int ret;
+
+    ret = avformat_alloc_output_context2(&s, NULL, format, NULL);
+    if (ret < 0)
+        return ret;
+
+    buf  = av_malloc(32768);
+    data = av_buffer_allocz(packet_size + AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt  = av_packet_alloc();
+    if (!buf || !data || !pkt ||
+        !(s->pb = avio_alloc_context(buf, 32768, 1, NULL, NULL, discard_packet, NULL))) {
+        av_free(buf);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* a recognizable start code for the muxers which look for one */
+    data->data[2] = 1;
+    data->data[3] = 0xb3;
+
+    for (int i = 0; i < nb_streams; i++) {
+        AVStream *st = avformat_new_stream(s, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if (i < nb_streams - nb_sparse) {
+            st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+            st->codecpar->codec_id   = AV_CODEC_ID_MPEG2VIDEO;
+            st->codecpar->width      = 1920;
+            st->codecpar->height     = 1080;
+        } else {
+            st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
+            st->codecpar->codec_id   = AV_CODEC_ID_BIN_DATA;
+        }
+        st->time_base = (AVRational){ 1, FPS };
+    }
+
+    if (options && (ret = av_dict_parse_string(&opts, options, "=", ":", 0)) < 0)
+        goto end;
+    ret = avformat_write_header(s, &opts);
+    if (ret < 0)
+        goto end;
+
+    start = av_gettime_relative();
+    for (int t = 0; t < duration && ret >= 0; t++) {
+        for (int i = 0; i < nb_streams && ret >= 0; i++) {
+            const int sparse = i >= nb_streams - nb_sparse;
+
+            if (sparse && t % 4)
+                continue;
+            for (int j = 0; j < (sparse ? 1 : FPS) && ret >= 0; j++) {
+                pkt->buf = av_buffer_ref(data);
+                if (!pkt->buf) {
+                    ret = AVERROR(ENOMEM);
+                    break;
+                }
+                pkt->data         = data->data;
+                pkt->size         = packet_size;
+                pkt->stream_index = i;
+                pkt->pts = pkt->dts = av_rescale_q(t * FPS + j, (AVRational){ 1, FPS },
+                                                   s->streams[i]->time_base);
+                pkt->duration     = av_rescale_q(1, (AVRational){ 1, FPS },
+                                                 s->streams[i]->time_base);
+                pkt->flags        = AV_PKT_FLAG_KEY;
+                ret = av_interleaved_write_frame(s, pkt);
+            }
+        }
+    }
+    if (ret >= 0)
+        ret = av_write_trailer(s);
+    *time = av_gettime_relative() - start;
+
+end:
+    av_dict_free(&opts);
+    av_packet_free(&pkt);
+    av_buffer_unref(&data);
+    if (s && s->pb)
+        av_freep(&s->pb->buffer);
+    if (s)
+        avio_context_free(&s->pb);
+    avformat_free_context(s);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *format = "framecrc", *options = NULL;
+    int nb_streams = 4, nb_sparse = 0, packet_size = 16, duration = 200, nb_runs = 3;
+    int64_t nb_packets, best = INT64_MAX;
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "hf:o:n:s:p:t:r:")) != -1) {
+        switch (opt) {
+        case 'f': format      = optarg;       break;
+        case 'o': options     = optarg;       break;
+        case 'n': nb_streams  = atoi(optarg); break;
+        case 's': nb_sparse   = atoi(optarg); break;
+        case 'p': packet_size = atoi(optarg); break;
+        case 't': duration    = atoi(optarg); break;
+        case 'r': nb_runs     = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt != 'h';
+        }
+    }
+    if (nb_streams < 1 || nb_sparse < 0 || nb_sparse > nb_streams ||
+        packet_size < 4 || duration < 1 || nb_runs < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (int i = 0; i < nb_runs; i++) {
+        int64_t time;
+
+        output_size = 0;
+        ret = run(format, options, nb_streams, nb_sparse, packet_size, duration, &time);
+        if (ret < 0) {
+            fprintf(stderr, "Muxing failed: %s\n", av_err2str(ret));
+            return 1;
+        }
+        best = FFMIN(best, time);
+    }
+
+    nb_packets = (int64_t)(nb_streams - nb_sparse) * duration * FPS +
+                 (int64_t)nb_sparse * ((duration + 3) / 4);
+    printf("%s: %d streams (%d sparse), %"PRId64" packets of %d bytes, "
+           "best of %d: %.0f ns/packet, %.1f MB/s output\n",
+           format, nb_streams, nb_sparse, nb_packets, packet_size, nb_runs,
+           best * 1000.0 / nb_packets, output_size / (double)best);
+    return 0;
+}